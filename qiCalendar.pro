@@ -5,6 +5,7 @@
 #-------------------------------------------------
 
 QT       -= gui
+QT       += concurrent
 
 TARGET = qiCalendar
 TEMPLATE = lib
@@ -27,7 +28,21 @@ SOURCES += \
     src/qicalcalendar.cpp \
     src/qicaltimezone.cpp \
     src/qicalevent.cpp \
-    src/qicalrule.cpp
+    src/qicalrule.cpp \
+    src/qicalconflicts.cpp \
+    src/qicalalarmscheduler.cpp \
+    src/qicalrecurrence.cpp \
+    src/qicaloccurrencecache.cpp \
+    src/qicalcivil.cpp \
+    src/qicalruleplan.cpp \
+    src/qicalzonetable.cpp \
+    src/qicalzoneregistry.cpp \
+    src/qicalwriter.cpp \
+    src/qicalsnapshot.cpp \
+    src/qicaljcalwriter.cpp \
+    src/qicaldiff.cpp \
+    src/qicaldecompressor.cpp \
+    src/qicalbatchparser.cpp
 
 HEADERS += \
         src/qicalendar.h \
@@ -35,7 +50,30 @@ HEADERS += \
     src/qicalcalendar.h \
     src/qicaltimezone.h \
     src/qicalevent.h \
-    src/qicalrule.h
+    src/qicalrule.h \
+    src/qicalconflicts.h \
+    src/qicalalarmscheduler.h \
+    src/qicalrecurrence.h \
+    src/qicaloccurrencecache.h \
+    src/qicalcivil.h \
+    src/qicalruleplan.h \
+    src/qicalzonetable.h \
+    src/qicalzoneregistry.h \
+    src/qicalwriter.h \
+    src/qicalsnapshot.h \
+    src/qicaljcalwriter.h \
+    src/qicaldiff.h \
+    src/qicaldecompressor.h \
+    src/qicalbatchparser.h \
+    src/qicalutil_p.h
+
+LIBS += -lz
+
+# qmake CONFIG+=zstd enables zstd-compressed input
+zstd {
+    DEFINES += QICAL_WITH_ZSTD
+    LIBS += -lzstd
+}
 
 unix {
     target.path = /usr/lib
@@ -0,0 +1,114 @@
+#include "qicalalarmscheduler.h"
+#include "qicalcalendar.h"
+
+QiCalAlarmScheduler::QiCalAlarmScheduler(QiCalCalendar *calendar, const QDateTime &from) :
+    m_calendar(calendar)
+{
+    reset(from);
+}
+
+void QiCalAlarmScheduler::reset(const QDateTime &from)
+{
+    m_sources.clear();
+    m_queue = std::priority_queue<Entry, std::vector<Entry>, Later>();
+
+    if (m_calendar == nullptr)
+    {
+        return;
+    }
+
+    const qint64 fromMs = from.toMSecsSinceEpoch();
+
+    for (QiCalEvent* event : m_calendar->events())
+    {
+        for (QiCalAlarm* alarm : event->alarms())
+        {
+            if (!alarm->isTriggerValid())
+            {
+                continue;
+            }
+
+            const int source = int(m_sources.size());
+
+            if (alarm->isTriggerAbsolute())
+            {
+                qint64 fire = alarm->triggerTime().toMSecsSinceEpoch();
+                if (fire >= fromMs)
+                {
+                    m_sources.push_back({ event, alarm, 0, QSharedPointer<QiCalRecurrence>() });
+                    m_queue.push({ fire, event->dtStart().toMSecsSinceEpoch(), source });
+                }
+                continue;
+            }
+
+            qint64 lead = alarm->triggerOffset() * 1000;
+            if (alarm->triggerRelated() == QiCalAlarm::REL_END && event->dtEnd().isValid())
+            {
+                lead += event->dtStart().msecsTo(event->dtEnd());
+            }
+
+            if (event->rule() == nullptr)
+            {
+                qint64 start = event->dtStart().toMSecsSinceEpoch();
+                if (start + lead >= fromMs)
+                {
+                    m_sources.push_back({ event, alarm, lead, QSharedPointer<QiCalRecurrence>() });
+                    m_queue.push({ start + lead, start, source });
+                }
+                continue;
+            }
+
+            QSharedPointer<QiCalRecurrence> recurrence(new QiCalRecurrence(event->rule()));
+            recurrence->reset(from.addMSecs(-lead));
+            m_sources.push_back({ event, alarm, lead, recurrence });
+            advance(source);
+        }
+    }
+}
+
+bool QiCalAlarmScheduler::isEmpty() const
+{
+    return m_queue.empty();
+}
+
+QDateTime QiCalAlarmScheduler::nextFireTime(const QDateTime &limit) const
+{
+    if (m_queue.empty() || (limit.isValid() && m_queue.top().fire > limit.toMSecsSinceEpoch()))
+    {
+        return QDateTime();
+    }
+
+    return QDateTime::fromMSecsSinceEpoch(m_queue.top().fire);
+}
+
+QList<QiCalAlarmFire> QiCalAlarmScheduler::takeDue(const QDateTime &now)
+{
+    QList<QiCalAlarmFire> ret;
+    const qint64 nowMs = now.toMSecsSinceEpoch();
+
+    while (!m_queue.empty() && m_queue.top().fire <= nowMs)
+    {
+        const Entry top = m_queue.top();
+        m_queue.pop();
+
+        const Source& source = m_sources[top.source];
+        ret.push_back({ QDateTime::fromMSecsSinceEpoch(top.fire), QDateTime::fromMSecsSinceEpoch(top.start), source.event, source.alarm });
+
+        advance(top.source);
+    }
+
+    return ret;
+}
+
+void QiCalAlarmScheduler::advance(int source)
+{
+    const Source& src = m_sources[source];
+
+    if (src.recurrence.isNull() || !src.recurrence->hasNext())
+    {
+        return;
+    }
+
+    const qint64 start = src.recurrence->next().toMSecsSinceEpoch();
+    m_queue.push({ start + src.lead, start, source });
+}
@@ -0,0 +1,67 @@
+#ifndef QICALALARMSCHEDULER_H
+#define QICALALARMSCHEDULER_H
+
+#include <QDateTime>
+#include <QList>
+#include <QSharedPointer>
+
+#include <queue>
+#include <vector>
+
+#include "qicalevent.h"
+#include "qicalrecurrence.h"
+#include "qicalendar_global.h"
+
+class QiCalCalendar;
+
+struct QiCalAlarmFire
+{
+    QDateTime fireTime;
+    QDateTime occurrenceStart;
+    QiCalEvent* event;
+    QiCalAlarm* alarm;
+};
+
+class QICALENDARSHARED_EXPORT QiCalAlarmScheduler
+{
+public:
+    QiCalAlarmScheduler(QiCalCalendar* calendar, const QDateTime& from);
+
+    void reset(const QDateTime& from);
+
+    bool isEmpty() const;
+    QDateTime nextFireTime(const QDateTime& limit = QDateTime()) const;
+    QList<QiCalAlarmFire> takeDue(const QDateTime& now);
+
+private:
+    struct Source
+    {
+        QiCalEvent* event;
+        QiCalAlarm* alarm;
+        qint64 lead;
+        QSharedPointer<QiCalRecurrence> recurrence;
+    };
+
+    struct Entry
+    {
+        qint64 fire;
+        qint64 start;
+        int source;
+    };
+
+    struct Later
+    {
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            return a.fire > b.fire;
+        }
+    };
+
+    void advance(int source);
+
+    QiCalCalendar* m_calendar;
+    std::vector<Source> m_sources;
+    std::priority_queue<Entry, std::vector<Entry>, Later> m_queue;
+};
+
+#endif // QICALALARMSCHEDULER_H
@@ -0,0 +1,167 @@
+#include "qicalbatchparser.h"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFutureSynchronizer>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+#include <QtConcurrent>
+
+QiCalBatchParser::QiCalBatchParser() :
+    m_maxPending(2 * QThread::idealThreadCount())
+{
+}
+
+QiCalBatchParser::~QiCalBatchParser()
+{
+    m_pool.waitForDone();
+    qDeleteAll(m_parsers);
+}
+
+int QiCalBatchParser::maxThreads() const
+{
+    return m_pool.maxThreadCount();
+}
+
+void QiCalBatchParser::setMaxThreads(int threads)
+{
+    m_pool.setMaxThreadCount(threads);
+}
+
+int QiCalBatchParser::maxPending() const
+{
+    return m_maxPending;
+}
+
+void QiCalBatchParser::setMaxPending(int pending)
+{
+    m_maxPending = pending;
+}
+
+QFuture<QiCalBatchResult> QiCalBatchParser::parseFile(const QString &path)
+{
+    QThread* owner = QThread::currentThread();
+
+    return QtConcurrent::run(&m_pool, [this, path, owner]() {
+        return parseOne(path, owner);
+    });
+}
+
+int QiCalBatchParser::parse(const QStringList &paths, const Callback &callback)
+{
+    QThread* owner = QThread::currentThread();
+    const int window = qMax(1, m_maxPending);
+
+    QMutex mutex;
+    QWaitCondition ready;
+    QQueue<QiCalBatchResult> done;
+    QFutureSynchronizer<void> workers;
+    int next = 0;
+    int running = 0;
+    int parsed = 0;
+
+    // at most 'window' files are being parsed or waiting for the callback, so memory stays bounded
+    // however far the callback falls behind
+    QMutexLocker locker(&mutex);
+    for (int delivered = 0; delivered < paths.size(); delivered++)
+    {
+        while (next < paths.size() && running + done.size() < window)
+        {
+            const QString path = paths.at(next++);
+            running++;
+            workers.addFuture(QtConcurrent::run(&m_pool, [this, path, owner, &mutex, &ready, &done, &running]() {
+                const QiCalBatchResult result = parseOne(path, owner);
+
+                QMutexLocker workerLocker(&mutex);
+                running--;
+                done.enqueue(result);
+                ready.wakeOne();
+            }));
+        }
+
+        while (done.isEmpty())
+        {
+            ready.wait(&mutex);
+        }
+
+        const QiCalBatchResult result = done.dequeue();
+        locker.unlock();
+
+        if (result.calendar != nullptr)
+        {
+            parsed++;
+        }
+        callback(result);
+
+        locker.relock();
+    }
+    locker.unlock();
+
+    workers.waitForFinished();
+
+    return parsed;
+}
+
+int QiCalBatchParser::parseDirectory(const QString &directory, const Callback &callback, bool recursive)
+{
+    return parse(files(directory, recursive), callback);
+}
+
+QStringList QiCalBatchParser::files(const QString &directory, bool recursive)
+{
+    QStringList result;
+    QDirIterator it(directory, { "*.ics", "*.ics.gz", "*.ics.zst" }, QDir::Files | QDir::Readable,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+
+    while (it.hasNext())
+    {
+        result.push_back(it.next());
+    }
+    result.sort();
+
+    return result;
+}
+
+QiCalBatchResult QiCalBatchParser::parseOne(const QString &path, QThread *owner)
+{
+    QiCalBatchResult result;
+    result.path = path;
+    result.calendar = nullptr;
+
+    QiCalendarParser* parser = acquireParser();
+    if (parser->parseFile(path))
+    {
+        result.calendar = parser->takeCalendar();
+        result.calendar->moveToThread(owner);
+    }
+    else
+    {
+        result.error = QFileInfo(path).isReadable() ? QString("%1 is not a valid iCalendar file").arg(path)
+                                                    : QString("Cannot open %1").arg(path);
+    }
+    releaseParser(parser);
+
+    return result;
+}
+
+QiCalendarParser *QiCalBatchParser::acquireParser()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_idle.isEmpty())
+    {
+        return m_idle.takeLast();
+    }
+
+    QiCalendarParser* parser = new QiCalendarParser();
+    m_parsers.push_back(parser);
+
+    return parser;
+}
+
+void QiCalBatchParser::releaseParser(QiCalendarParser *parser)
+{
+    QMutexLocker locker(&m_mutex);
+    m_idle.push_back(parser);
+}
@@ -0,0 +1,58 @@
+#ifndef QICALBATCHPARSER_H
+#define QICALBATCHPARSER_H
+
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
+
+#include "qicalendar.h"
+#include "qicalendar_global.h"
+
+struct QiCalBatchResult
+{
+    QString path;
+    QiCalCalendar* calendar;
+    QString error;
+};
+
+// Parses many calendar files on a bounded thread pool, reusing one QiCalendarParser per worker.
+class QICALENDARSHARED_EXPORT QiCalBatchParser
+{
+public:
+    typedef std::function<void(const QiCalBatchResult& result)> Callback;
+
+    QiCalBatchParser();
+    ~QiCalBatchParser();
+
+    int maxThreads() const;
+    void setMaxThreads(int threads);
+
+    int maxPending() const;
+    void setMaxPending(int pending);
+
+    QFuture<QiCalBatchResult> parseFile(const QString& path);
+    int parse(const QStringList& paths, const Callback& callback);
+    int parseDirectory(const QString& directory, const Callback& callback, bool recursive = true);
+
+    static QStringList files(const QString& directory, bool recursive = true);
+
+private:
+    Q_DISABLE_COPY(QiCalBatchParser)
+
+    QiCalBatchResult parseOne(const QString& path, QThread* owner);
+    QiCalendarParser* acquireParser();
+    void releaseParser(QiCalendarParser* parser);
+
+    QThreadPool m_pool;
+    int m_maxPending;
+    QMutex m_mutex;
+    QList<QiCalendarParser*> m_parsers;
+    QList<QiCalendarParser*> m_idle;
+};
+
+#endif // QICALBATCHPARSER_H
@@ -82,6 +82,11 @@ void QiCalCalendar::addEvent(QiCalEvent *event)
 
 void QiCalCalendar::removeEvent(QiCalEvent *event)
 {
+    if (event->rule() != nullptr)
+    {
+        m_rules.removeOne(event->rule());
+    }
+
     m_events.removeOne(event);
     delete event;
     emit eventsChanged();
@@ -95,6 +100,7 @@ void QiCalCalendar::clearEvents()
     }
 
     m_events.clear();
+    m_rules.clear();
     emit eventsChanged();
 }
 
@@ -112,3 +118,8 @@ void QiCalCalendar::addRule(QiCalRule *rule)
 {
     m_rules.push_back(rule);
 }
+
+void QiCalCalendar::removeRule(QiCalRule *rule)
+{
+    m_rules.removeOne(rule);
+}
@@ -42,6 +42,7 @@ public:
     QList<QiCalRule *> rules() const;
     void setRules(const QList<QiCalRule *> &rules);
     void addRule(QiCalRule* rule);
+    void removeRule(QiCalRule* rule);
 
 signals:
     void prodIdChanged();
@@ -0,0 +1,314 @@
+#include "qicalcivil.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define QICAL_CIVIL_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+const int ISO_BLOCK = 256;
+const qint32 DAYS_PER_ERA = 146097;
+
+void fromJulianDayScalar(qint32 jd, qint32* year, qint32* month, qint32* day, qint32* dayOfWeek)
+{
+    const qint32 z = jd - QiCalCivil::MIN_JULIAN_DAY;
+    const qint32 era = z / DAYS_PER_ERA;
+    const qint32 doe = z - era * DAYS_PER_ERA;
+    const qint32 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const qint32 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const qint32 mp = (5 * doy + 2) / 153;
+    const qint32 wrap = mp / 10;
+
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp + 3 - 12 * wrap;
+    *year = yoe + era * 400 + wrap;
+    *dayOfWeek = jd % 7 + 1;
+}
+
+qint32 toJulianDayScalar(qint32 year, qint32 month, qint32 day)
+{
+    const qint32 wrap = (14 - month) / 12;
+    const qint32 y = year - wrap;
+    const qint32 mp = month + 12 * wrap - 3;
+    const qint32 era = y / 400;
+    const qint32 yoe = y - era * 400;
+    const qint32 doy = (153 * mp + 2) / 5 + day - 1;
+    const qint32 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * DAYS_PER_ERA + doe + QiCalCivil::MIN_JULIAN_DAY;
+}
+
+void fromJulianDaysScalar(const qint32* jd, int count, qint32* year, qint32* month, qint32* day, qint32* dayOfWeek)
+{
+    for (int i = 0; i < count; i++)
+    {
+        fromJulianDayScalar(jd[i], year + i, month + i, day + i, dayOfWeek + i);
+    }
+}
+
+void toJulianDaysScalar(const qint32* year, const qint32* month, const qint32* day, int count, qint32* jd)
+{
+    for (int i = 0; i < count; i++)
+    {
+        jd[i] = toJulianDayScalar(year[i], month[i], day[i]);
+    }
+}
+
+#ifdef QICAL_CIVIL_X86
+
+// All intermediate values stay far below 2^53, so double lanes give exact
+// integer arithmetic and truncated division matches the scalar code.
+
+__attribute__((target("sse4.1")))
+inline __m128d quot128(__m128d a, double b)
+{
+    return _mm_round_pd(_mm_div_pd(a, _mm_set1_pd(b)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("sse4.1")))
+inline __m128d mul128(__m128d a, double b)
+{
+    return _mm_mul_pd(a, _mm_set1_pd(b));
+}
+
+__attribute__((target("sse4.1")))
+void fromJulianDaysSse41(const qint32* jd, int count, qint32* year, qint32* month, qint32* day, qint32* dayOfWeek)
+{
+    int i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        const __m128d j = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(jd + i)));
+        const __m128d z = _mm_sub_pd(j, _mm_set1_pd(QiCalCivil::MIN_JULIAN_DAY));
+        const __m128d era = quot128(z, DAYS_PER_ERA);
+        const __m128d doe = _mm_sub_pd(z, mul128(era, DAYS_PER_ERA));
+        const __m128d yoe = quot128(_mm_add_pd(_mm_sub_pd(doe, quot128(doe, 1460)), _mm_sub_pd(quot128(doe, 36524), quot128(doe, 146096))), 365);
+        const __m128d doy = _mm_sub_pd(doe, _mm_sub_pd(_mm_add_pd(mul128(yoe, 365), quot128(yoe, 4)), quot128(yoe, 100)));
+        const __m128d mp = quot128(_mm_add_pd(mul128(doy, 5), _mm_set1_pd(2)), 153);
+        const __m128d wrap = quot128(mp, 10);
+        const __m128d d = _mm_add_pd(_mm_sub_pd(doy, quot128(_mm_add_pd(mul128(mp, 153), _mm_set1_pd(2)), 5)), _mm_set1_pd(1));
+        const __m128d m = _mm_sub_pd(_mm_add_pd(mp, _mm_set1_pd(3)), mul128(wrap, 12));
+        const __m128d y = _mm_add_pd(_mm_add_pd(yoe, mul128(era, 400)), wrap);
+        const __m128d dow = _mm_add_pd(_mm_sub_pd(j, mul128(quot128(j, 7), 7)), _mm_set1_pd(1));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(year + i), _mm_cvttpd_epi32(y));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(month + i), _mm_cvttpd_epi32(m));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(day + i), _mm_cvttpd_epi32(d));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dayOfWeek + i), _mm_cvttpd_epi32(dow));
+    }
+
+    fromJulianDaysScalar(jd + i, count - i, year + i, month + i, day + i, dayOfWeek + i);
+}
+
+__attribute__((target("sse4.1")))
+void toJulianDaysSse41(const qint32* year, const qint32* month, const qint32* day, int count, qint32* jd)
+{
+    int i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        const __m128d m = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(month + i)));
+        const __m128d wrap = quot128(_mm_sub_pd(_mm_set1_pd(14), m), 12);
+        const __m128d y = _mm_sub_pd(_mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(year + i))), wrap);
+        const __m128d mp = _mm_sub_pd(_mm_add_pd(m, mul128(wrap, 12)), _mm_set1_pd(3));
+        const __m128d era = quot128(y, 400);
+        const __m128d yoe = _mm_sub_pd(y, mul128(era, 400));
+        const __m128d d = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(day + i)));
+        const __m128d doy = _mm_add_pd(quot128(_mm_add_pd(mul128(mp, 153), _mm_set1_pd(2)), 5), _mm_sub_pd(d, _mm_set1_pd(1)));
+        const __m128d doe = _mm_add_pd(_mm_sub_pd(_mm_add_pd(mul128(yoe, 365), quot128(yoe, 4)), quot128(yoe, 100)), doy);
+        const __m128d j = _mm_add_pd(_mm_add_pd(mul128(era, DAYS_PER_ERA), doe), _mm_set1_pd(QiCalCivil::MIN_JULIAN_DAY));
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(jd + i), _mm_cvttpd_epi32(j));
+    }
+
+    toJulianDaysScalar(year + i, month + i, day + i, count - i, jd + i);
+}
+
+__attribute__((target("avx2")))
+inline __m256d quot256(__m256d a, double b)
+{
+    return _mm256_round_pd(_mm256_div_pd(a, _mm256_set1_pd(b)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+__attribute__((target("avx2")))
+inline __m256d mul256(__m256d a, double b)
+{
+    return _mm256_mul_pd(a, _mm256_set1_pd(b));
+}
+
+__attribute__((target("avx2")))
+void fromJulianDaysAvx2(const qint32* jd, int count, qint32* year, qint32* month, qint32* day, qint32* dayOfWeek)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m256d j = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(jd + i)));
+        const __m256d z = _mm256_sub_pd(j, _mm256_set1_pd(QiCalCivil::MIN_JULIAN_DAY));
+        const __m256d era = quot256(z, DAYS_PER_ERA);
+        const __m256d doe = _mm256_sub_pd(z, mul256(era, DAYS_PER_ERA));
+        const __m256d yoe = quot256(_mm256_add_pd(_mm256_sub_pd(doe, quot256(doe, 1460)), _mm256_sub_pd(quot256(doe, 36524), quot256(doe, 146096))), 365);
+        const __m256d doy = _mm256_sub_pd(doe, _mm256_sub_pd(_mm256_add_pd(mul256(yoe, 365), quot256(yoe, 4)), quot256(yoe, 100)));
+        const __m256d mp = quot256(_mm256_add_pd(mul256(doy, 5), _mm256_set1_pd(2)), 153);
+        const __m256d wrap = quot256(mp, 10);
+        const __m256d d = _mm256_add_pd(_mm256_sub_pd(doy, quot256(_mm256_add_pd(mul256(mp, 153), _mm256_set1_pd(2)), 5)), _mm256_set1_pd(1));
+        const __m256d m = _mm256_sub_pd(_mm256_add_pd(mp, _mm256_set1_pd(3)), mul256(wrap, 12));
+        const __m256d y = _mm256_add_pd(_mm256_add_pd(yoe, mul256(era, 400)), wrap);
+        const __m256d dow = _mm256_add_pd(_mm256_sub_pd(j, mul256(quot256(j, 7), 7)), _mm256_set1_pd(1));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(year + i), _mm256_cvttpd_epi32(y));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(month + i), _mm256_cvttpd_epi32(m));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(day + i), _mm256_cvttpd_epi32(d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dayOfWeek + i), _mm256_cvttpd_epi32(dow));
+    }
+
+    fromJulianDaysScalar(jd + i, count - i, year + i, month + i, day + i, dayOfWeek + i);
+}
+
+__attribute__((target("avx2")))
+void toJulianDaysAvx2(const qint32* year, const qint32* month, const qint32* day, int count, qint32* jd)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m256d m = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(month + i)));
+        const __m256d wrap = quot256(_mm256_sub_pd(_mm256_set1_pd(14), m), 12);
+        const __m256d y = _mm256_sub_pd(_mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(year + i))), wrap);
+        const __m256d mp = _mm256_sub_pd(_mm256_add_pd(m, mul256(wrap, 12)), _mm256_set1_pd(3));
+        const __m256d era = quot256(y, 400);
+        const __m256d yoe = _mm256_sub_pd(y, mul256(era, 400));
+        const __m256d d = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(day + i)));
+        const __m256d doy = _mm256_add_pd(quot256(_mm256_add_pd(mul256(mp, 153), _mm256_set1_pd(2)), 5), _mm256_sub_pd(d, _mm256_set1_pd(1)));
+        const __m256d doe = _mm256_add_pd(_mm256_sub_pd(_mm256_add_pd(mul256(yoe, 365), quot256(yoe, 4)), quot256(yoe, 100)), doy);
+        const __m256d j = _mm256_add_pd(_mm256_add_pd(mul256(era, DAYS_PER_ERA), doe), _mm256_set1_pd(QiCalCivil::MIN_JULIAN_DAY));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(jd + i), _mm256_cvttpd_epi32(j));
+    }
+
+    toJulianDaysScalar(year + i, month + i, day + i, count - i, jd + i);
+}
+
+#endif
+
+QiCalCivil::Isa detectIsa()
+{
+#ifdef QICAL_CIVIL_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return QiCalCivil::ISA_AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return QiCalCivil::ISA_SSE41;
+    }
+#endif
+
+    return QiCalCivil::ISA_SCALAR;
+}
+
+std::atomic<int> g_isa(-1);
+
+}
+
+void QiCalCivil::fromJulianDays(const qint32 *jd, int count, qint32 *year, qint32 *month, qint32 *day, qint32 *dayOfWeek)
+{
+    switch (isa()) {
+#ifdef QICAL_CIVIL_X86
+    case ISA_AVX2:
+        fromJulianDaysAvx2(jd, count, year, month, day, dayOfWeek);
+        break;
+    case ISA_SSE41:
+        fromJulianDaysSse41(jd, count, year, month, day, dayOfWeek);
+        break;
+#endif
+    default:
+        fromJulianDaysScalar(jd, count, year, month, day, dayOfWeek);
+        break;
+    }
+}
+
+void QiCalCivil::toJulianDays(const qint32 *year, const qint32 *month, const qint32 *day, int count, qint32 *jd)
+{
+    switch (isa()) {
+#ifdef QICAL_CIVIL_X86
+    case ISA_AVX2:
+        toJulianDaysAvx2(year, month, day, count, jd);
+        break;
+    case ISA_SSE41:
+        toJulianDaysSse41(year, month, day, count, jd);
+        break;
+#endif
+    default:
+        toJulianDaysScalar(year, month, day, count, jd);
+        break;
+    }
+}
+
+void QiCalCivil::isoWeeks(const qint32 *jd, int count, qint32 *week, qint32 *weekYear)
+{
+    qint32 thursday[ISO_BLOCK];
+    qint32 month[ISO_BLOCK];
+    qint32 day[ISO_BLOCK];
+    qint32 dayOfWeek[ISO_BLOCK];
+    qint32 jan1[ISO_BLOCK];
+
+    for (int offset = 0; offset < count; offset += ISO_BLOCK)
+    {
+        const int size = std::min(ISO_BLOCK, count - offset);
+
+        for (int i = 0; i < size; i++)
+        {
+            thursday[i] = jd[offset + i] - jd[offset + i] % 7 + 3;
+        }
+
+        fromJulianDays(thursday, size, weekYear + offset, month, day, dayOfWeek);
+        std::fill(month, month + size, 1);
+        std::fill(day, day + size, 1);
+        toJulianDays(weekYear + offset, month, day, size, jan1);
+
+        for (int i = 0; i < size; i++)
+        {
+            week[offset + i] = (thursday[i] - jan1[i]) / 7 + 1;
+        }
+    }
+}
+
+int QiCalCivil::daysInMonth(int year, int month)
+{
+    static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+    {
+        return 29;
+    }
+
+    return days[month - 1];
+}
+
+QiCalCivil::Isa QiCalCivil::isa()
+{
+    int current = g_isa.load(std::memory_order_relaxed);
+
+    if (current < 0)
+    {
+        current = detectIsa();
+        g_isa.store(current, std::memory_order_relaxed);
+    }
+
+    return Isa(current);
+}
+
+QiCalCivil::Isa QiCalCivil::supportedIsa()
+{
+    return detectIsa();
+}
+
+void QiCalCivil::setIsa(Isa isa)
+{
+    g_isa.store(std::min(isa, supportedIsa()), std::memory_order_relaxed);
+}
@@ -0,0 +1,33 @@
+#ifndef QICALCIVIL_H
+#define QICALCIVIL_H
+
+#include <QtGlobal>
+
+#include "qicalendar_global.h"
+
+// Batch conversions between Julian day numbers and proleptic Gregorian dates.
+// Days must lie within 0000-03-01 (JD 1721120) and the int32 range.
+class QICALENDARSHARED_EXPORT QiCalCivil
+{
+public:
+    enum Isa
+    {
+        ISA_SCALAR = 0,
+        ISA_SSE41,
+        ISA_AVX2
+    };
+
+    static void fromJulianDays(const qint32* jd, int count, qint32* year, qint32* month, qint32* day, qint32* dayOfWeek);
+    static void toJulianDays(const qint32* year, const qint32* month, const qint32* day, int count, qint32* jd);
+    static void isoWeeks(const qint32* jd, int count, qint32* week, qint32* weekYear);
+
+    static int daysInMonth(int year, int month);
+
+    static Isa isa();
+    static Isa supportedIsa();
+    static void setIsa(Isa isa);
+
+    static const qint32 MIN_JULIAN_DAY = 1721120;
+};
+
+#endif // QICALCIVIL_H
@@ -0,0 +1,150 @@
+#include "qicalconflicts.h"
+
+#include <algorithm>
+#include <vector>
+
+QiCalConflictDetector::QiCalConflictDetector() :
+    m_includeTentative(true)
+{
+}
+
+bool QiCalConflictDetector::includeTentative() const
+{
+    return m_includeTentative;
+}
+
+void QiCalConflictDetector::setIncludeTentative(bool includeTentative)
+{
+    m_includeTentative = includeTentative;
+}
+
+QList<QiCalConflict> QiCalConflictDetector::conflicts(const QList<QiCalEvent *> &events) const
+{
+    QList<QiCalConflict> ret;
+    QVector<Interval> intervals = sortedIntervals(events);
+
+    const auto endsLater = [](const Interval* a, const Interval* b) {
+        return a->end > b->end;
+    };
+
+    // min-heap by end time, holds every interval still open at the sweep position
+    std::vector<const Interval*> active;
+    // zero-duration events at the sweep position; they occupy only their start instant
+    std::vector<const Interval*> instants;
+
+    for (const Interval& cur : intervals)
+    {
+        while (!active.empty() && active.front()->end <= cur.start)
+        {
+            std::pop_heap(active.begin(), active.end(), endsLater);
+            active.pop_back();
+        }
+
+        if (!instants.empty() && instants.front()->start != cur.start)
+        {
+            instants.clear();
+        }
+
+        for (const Interval* open : active)
+        {
+            ret.push_back({ open->event, cur.event });
+        }
+
+        for (const Interval* instant : instants)
+        {
+            ret.push_back({ instant->event, cur.event });
+        }
+
+        if (cur.end > cur.start)
+        {
+            active.push_back(&cur);
+            std::push_heap(active.begin(), active.end(), endsLater);
+        }
+        else
+        {
+            instants.push_back(&cur);
+        }
+    }
+
+    return ret;
+}
+
+QList<QList<QiCalEvent *> > QiCalConflictDetector::clusters(const QList<QiCalEvent *> &events) const
+{
+    QList<QList<QiCalEvent*> > ret;
+    QVector<Interval> intervals = sortedIntervals(events);
+
+    QList<QiCalEvent*> cluster;
+    qint64 clusterEnd = 0;
+    qint64 lastInstant = 0;
+    bool hasInstant = false;
+
+    for (const Interval& cur : intervals)
+    {
+        // an instant still joins events starting at the same moment, as in conflicts()
+        if (!cluster.isEmpty() && cur.start >= clusterEnd && !(hasInstant && cur.start == lastInstant))
+        {
+            if (cluster.count() > 1)
+            {
+                ret.push_back(cluster);
+            }
+            cluster.clear();
+            hasInstant = false;
+        }
+
+        clusterEnd = cluster.isEmpty() ? cur.end : std::max(clusterEnd, cur.end);
+        cluster.push_back(cur.event);
+
+        if (cur.end == cur.start)
+        {
+            lastInstant = cur.start;
+            hasInstant = true;
+        }
+    }
+
+    if (cluster.count() > 1)
+    {
+        ret.push_back(cluster);
+    }
+
+    return ret;
+}
+
+bool QiCalConflictDetector::isBlocking(const QiCalEvent *event) const
+{
+    if (event == nullptr || !event->dtStart().isValid())
+    {
+        return false;
+    }
+
+    if (event->transp() == QiCalEvent::TRANS_TRANSPARENT || event->status() == QiCalEvent::STAT_CANCELLED)
+    {
+        return false;
+    }
+
+    return m_includeTentative || event->status() != QiCalEvent::STAT_TENTATIVE;
+}
+
+QVector<QiCalConflictDetector::Interval> QiCalConflictDetector::sortedIntervals(const QList<QiCalEvent *> &events) const
+{
+    QVector<Interval> intervals;
+    intervals.reserve(events.count());
+
+    for (QiCalEvent* ev : events)
+    {
+        if (!isBlocking(ev))
+        {
+            continue;
+        }
+
+        qint64 start = ev->dtStart().toMSecsSinceEpoch();
+        qint64 end = ev->dtEnd().isValid() ? ev->dtEnd().toMSecsSinceEpoch() : start;
+        intervals.push_back({ start, std::max(start, end), ev });
+    }
+
+    std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) {
+        return a.start < b.start || (a.start == b.start && a.end < b.end);
+    });
+
+    return intervals;
+}
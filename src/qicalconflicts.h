@@ -0,0 +1,42 @@
+#ifndef QICALCONFLICTS_H
+#define QICALCONFLICTS_H
+
+#include <QList>
+#include <QVector>
+
+#include "qicalevent.h"
+#include "qicalendar_global.h"
+
+struct QiCalConflict
+{
+    QiCalEvent* first;
+    QiCalEvent* second;
+};
+
+class QICALENDARSHARED_EXPORT QiCalConflictDetector
+{
+public:
+    QiCalConflictDetector();
+
+    bool includeTentative() const;
+    void setIncludeTentative(bool includeTentative);
+
+    QList<QiCalConflict> conflicts(const QList<QiCalEvent*>& events) const;
+    QList<QList<QiCalEvent*> > clusters(const QList<QiCalEvent*>& events) const;
+
+    bool isBlocking(const QiCalEvent* event) const;
+
+private:
+    struct Interval
+    {
+        qint64 start;
+        qint64 end;
+        QiCalEvent* event;
+    };
+
+    QVector<Interval> sortedIntervals(const QList<QiCalEvent*>& events) const;
+
+    bool m_includeTentative;
+};
+
+#endif // QICALCONFLICTS_H
@@ -0,0 +1,280 @@
+#include "qicaldecompressor.h"
+
+#include <zlib.h>
+#ifdef QICAL_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+const char GZIP_MAGIC[] = { '\x1f', '\x8b' };
+const char ZSTD_MAGIC[] = { '\x28', '\xb5', '\x2f', '\xfd' };
+
+}
+
+QiCalDecompressor::QiCalDecompressor(QIODevice *source, QObject *parent) :
+    QIODevice(parent),
+    m_source(source),
+    m_format(detect(source)),
+    m_inputPos(0),
+    m_streamEnd(false),
+    m_finished(false),
+    m_error(false),
+    m_zlib(nullptr),
+    m_zstd(nullptr)
+{
+}
+
+QiCalDecompressor::~QiCalDecompressor()
+{
+    release();
+}
+
+QiCalDecompressor::Format QiCalDecompressor::format() const
+{
+    return m_format;
+}
+
+bool QiCalDecompressor::hasError() const
+{
+    return m_error;
+}
+
+bool QiCalDecompressor::open(OpenMode mode)
+{
+    if ((mode & WriteOnly) != 0)
+    {
+        setErrorString("QiCalDecompressor is read-only");
+        return false;
+    }
+
+    if (m_source == nullptr || !m_source->isReadable())
+    {
+        setErrorString("Source device is not readable");
+        return false;
+    }
+
+    release();
+    m_input.resize(0);
+    m_inputPos = 0;
+    m_streamEnd = false;
+    m_finished = false;
+    m_error = false;
+
+    if (m_format == FMT_GZIP)
+    {
+        m_zlib = new z_stream_s;
+        std::memset(m_zlib, 0, sizeof(z_stream_s));
+
+        // 16 selects the gzip wrapper
+        if (inflateInit2(m_zlib, 16 + MAX_WBITS) != Z_OK)
+        {
+            delete m_zlib;
+            m_zlib = nullptr;
+            setErrorString("Cannot initialize zlib");
+            return false;
+        }
+    }
+    else if (m_format == FMT_ZSTD)
+    {
+#ifdef QICAL_WITH_ZSTD
+        m_zstd = ZSTD_createDStream();
+        if (m_zstd == nullptr)
+        {
+            setErrorString("Cannot initialize zstd");
+            return false;
+        }
+#else
+        setErrorString("zstd input is not supported by this build");
+        return false;
+#endif
+    }
+
+    return QIODevice::open(mode);
+}
+
+void QiCalDecompressor::close()
+{
+    release();
+    QIODevice::close();
+}
+
+bool QiCalDecompressor::isSequential() const
+{
+    return true;
+}
+
+bool QiCalDecompressor::atEnd() const
+{
+    return m_finished && QIODevice::atEnd();
+}
+
+QiCalDecompressor::Format QiCalDecompressor::detect(QIODevice *source)
+{
+    if (source == nullptr || !source->isReadable())
+    {
+        return FMT_PLAIN;
+    }
+
+    const QByteArray magic = source->peek(sizeof(ZSTD_MAGIC));
+
+    if (magic.startsWith(QByteArray(GZIP_MAGIC, sizeof(GZIP_MAGIC))))
+    {
+        return FMT_GZIP;
+    }
+
+    if (magic.startsWith(QByteArray(ZSTD_MAGIC, sizeof(ZSTD_MAGIC))))
+    {
+        return FMT_ZSTD;
+    }
+
+    return FMT_PLAIN;
+}
+
+bool QiCalDecompressor::isSupported(Format format)
+{
+#ifdef QICAL_WITH_ZSTD
+    return format == FMT_PLAIN || format == FMT_GZIP || format == FMT_ZSTD;
+#else
+    return format == FMT_PLAIN || format == FMT_GZIP;
+#endif
+}
+
+qint64 QiCalDecompressor::readData(char *data, qint64 maxSize)
+{
+    if (m_format == FMT_PLAIN)
+    {
+        const qint64 read = m_source->read(data, maxSize);
+        m_finished = read <= 0 && m_source->atEnd();
+        return read;
+    }
+
+    qint64 produced = 0;
+    while (produced == 0 && !m_finished)
+    {
+        const bool more = fill();
+        if (!more && m_streamEnd)
+        {
+            m_finished = true;
+            break;
+        }
+
+        const int available = m_input.size() - m_inputPos;
+
+        if (m_zlib != nullptr)
+        {
+            // gzip files may hold several members back to back
+            if (m_streamEnd)
+            {
+                inflateReset(m_zlib);
+                m_streamEnd = false;
+            }
+
+            const uInt room = uInt(qMin<qint64>(maxSize, std::numeric_limits<uInt>::max()));
+            m_zlib->next_in = reinterpret_cast<Bytef*>(m_input.data() + m_inputPos);
+            m_zlib->avail_in = uInt(available);
+            m_zlib->next_out = reinterpret_cast<Bytef*>(data);
+            m_zlib->avail_out = room;
+
+            const int result = inflate(m_zlib, Z_NO_FLUSH);
+            m_inputPos += available - int(m_zlib->avail_in);
+            produced = room - m_zlib->avail_out;
+
+            if (result == Z_STREAM_END)
+            {
+                m_streamEnd = true;
+            }
+            else if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                setErrorString(QString("Corrupt gzip data: ") + (m_zlib->msg != nullptr ? m_zlib->msg : "inflate failed"));
+                m_finished = true;
+                m_error = true;
+                return produced > 0 ? produced : -1;
+            }
+        }
+#ifdef QICAL_WITH_ZSTD
+        else if (m_zstd != nullptr)
+        {
+            ZSTD_inBuffer in = { m_input.constData() + m_inputPos, size_t(available), 0 };
+            ZSTD_outBuffer out = { data, size_t(maxSize), 0 };
+
+            const size_t result = ZSTD_decompressStream(m_zstd, &out, &in);
+            m_inputPos += int(in.pos);
+            produced = qint64(out.pos);
+
+            if (ZSTD_isError(result))
+            {
+                setErrorString(QString("Corrupt zstd data: ") + ZSTD_getErrorName(result));
+                m_finished = true;
+                m_error = true;
+                return produced > 0 ? produced : -1;
+            }
+
+            m_streamEnd = result == 0;
+        }
+#endif
+        else
+        {
+            return -1;
+        }
+
+        if (!more && produced == 0)
+        {
+            m_finished = true;
+            if (!m_streamEnd)
+            {
+                setErrorString("Unexpected end of compressed data");
+                m_error = true;
+                return -1;
+            }
+        }
+    }
+
+    return produced;
+}
+
+qint64 QiCalDecompressor::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+
+    return -1;
+}
+
+bool QiCalDecompressor::fill()
+{
+    if (m_inputPos < m_input.size())
+    {
+        return true;
+    }
+
+    // resize() keeps the capacity, so the block is allocated once
+    m_input.resize(BLOCK_SIZE);
+    const qint64 read = m_source->read(m_input.data(), BLOCK_SIZE);
+    m_input.resize(read > 0 ? int(read) : 0);
+    m_inputPos = 0;
+
+    return read > 0;
+}
+
+void QiCalDecompressor::release()
+{
+    if (m_zlib != nullptr)
+    {
+        inflateEnd(m_zlib);
+        delete m_zlib;
+        m_zlib = nullptr;
+    }
+
+#ifdef QICAL_WITH_ZSTD
+    if (m_zstd != nullptr)
+    {
+        ZSTD_freeDStream(m_zstd);
+        m_zstd = nullptr;
+    }
+#endif
+}
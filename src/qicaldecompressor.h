@@ -0,0 +1,60 @@
+#ifndef QICALDECOMPRESSOR_H
+#define QICALDECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include "qicalendar_global.h"
+
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+
+// Sequential read-only device inflating gzip or zstd data from another device one block at a time.
+class QICALENDARSHARED_EXPORT QiCalDecompressor : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Format
+    {
+        FMT_PLAIN = 0,
+        FMT_GZIP,
+        FMT_ZSTD
+    };
+    Q_ENUM(Format)
+
+    explicit QiCalDecompressor(QIODevice* source, QObject *parent = nullptr);
+    ~QiCalDecompressor() override;
+
+    Format format() const;
+    bool hasError() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    bool atEnd() const override;
+
+    static Format detect(QIODevice* source);
+    static bool isSupported(Format format);
+
+    static const int BLOCK_SIZE = 64 * 1024;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    bool fill();
+    void release();
+
+    QIODevice* m_source;
+    Format m_format;
+    QByteArray m_input;
+    int m_inputPos;
+    bool m_streamEnd;
+    bool m_finished;
+    bool m_error;
+    z_stream_s* m_zlib;
+    ZSTD_DCtx_s* m_zstd;
+};
+
+#endif // QICALDECOMPRESSOR_H
@@ -0,0 +1,182 @@
+#include "qicaldiff.h"
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+namespace
+{
+
+QString dateTimeKey(const QDateTime& dateTime)
+{
+    if (!dateTime.isValid())
+    {
+        return QString();
+    }
+
+    return QString("%1/%2/%3").arg(dateTime.toMSecsSinceEpoch()).arg(dateTime.offsetFromUtc()).arg(int(dateTime.timeSpec()));
+}
+
+QString dateListKey(const QVector<qint64>& dates)
+{
+    QStringList items;
+    for (qint64 date : dates)
+    {
+        items << QString::number(date);
+    }
+
+    return items.join(',');
+}
+
+void addRuleFields(QStringList& fields, const QiCalRule* rule)
+{
+    if (rule == nullptr)
+    {
+        fields << QString();
+        return;
+    }
+
+    fields << QString::number(int(rule->freq()))
+           << dateTimeKey(rule->until())
+           << QString::number(rule->count())
+           << QString::number(rule->interval())
+           << rule->secondList()
+           << rule->minuteList()
+           << rule->hourList()
+           << rule->dayList()
+           << rule->monthDayList()
+           << rule->yearDayList()
+           << rule->weekList()
+           << rule->monthList()
+           << rule->setposList()
+           << rule->wkst();
+}
+
+}
+
+QiCalDiffer::QiCalDiffer() :
+    m_compareContent(false)
+{
+}
+
+bool QiCalDiffer::compareContent() const
+{
+    return m_compareContent;
+}
+
+void QiCalDiffer::setCompareContent(bool compareContent)
+{
+    m_compareContent = compareContent;
+}
+
+QiCalDiff QiCalDiffer::diff(const QiCalCalendar *before, const QiCalCalendar *after) const
+{
+    return diff(before != nullptr ? before->events() : QList<QiCalEvent*>(),
+                after != nullptr ? after->events() : QList<QiCalEvent*>());
+}
+
+QiCalDiff QiCalDiffer::diff(const QList<QiCalEvent *> &before, const QList<QiCalEvent *> &after) const
+{
+    QiCalDiff result;
+
+    // inserted back to front so that take() pairs events sharing a key in document order
+    QMultiHash<QString, QiCalEvent*> index;
+    index.reserve(before.size());
+    for (int i = before.size() - 1; i >= 0; i--)
+    {
+        index.insert(key(before.at(i)), before.at(i));
+    }
+
+    QSet<const QiCalEvent*> matched;
+    matched.reserve(before.size());
+
+    for (QiCalEvent* event : after)
+    {
+        QiCalEvent* previous = index.take(key(event));
+        if (previous == nullptr)
+        {
+            result.added.push_back(event);
+            continue;
+        }
+
+        matched.insert(previous);
+        if (isModified(previous, event))
+        {
+            result.modified.push_back({ previous, event });
+        }
+    }
+
+    for (QiCalEvent* event : before)
+    {
+        if (!matched.contains(event))
+        {
+            result.removed.push_back(event);
+        }
+    }
+
+    return result;
+}
+
+bool QiCalDiffer::isModified(const QiCalEvent *before, const QiCalEvent *after) const
+{
+    if (before->sequence() != after->sequence())
+    {
+        return true;
+    }
+
+    if (!m_compareContent && before->lastModified().isValid() && after->lastModified().isValid())
+    {
+        return before->lastModified() != after->lastModified();
+    }
+
+    return fingerprint(before) != fingerprint(after);
+}
+
+QString QiCalDiffer::key(const QiCalEvent *event)
+{
+    if (event->masterEvent() == nullptr)
+    {
+        return event->uid();
+    }
+
+    return event->uid() + '|' + QString::number(event->dtStart().toMSecsSinceEpoch());
+}
+
+QByteArray QiCalDiffer::fingerprint(const QiCalEvent *event)
+{
+    QStringList fields;
+    fields << event->uid()
+           << dateTimeKey(event->dtStart())
+           << dateTimeKey(event->dtEnd())
+           << QString::number(int(event->isAllDay()))
+           << (event->zone().isNull() ? QString() : event->zone()->tzId())
+           << event->summary()
+           << event->description()
+           << event->location()
+           << QString::number(int(event->status()))
+           << QString::number(int(event->transp()))
+           << dateListKey(event->exDates())
+           << dateListKey(event->rDates());
+    addRuleFields(fields, event->rule());
+
+    fields << QString::number(event->alarms().size());
+    for (const QiCalAlarm* alarm : event->alarms())
+    {
+        fields << QString::number(int(alarm->action()))
+               << QString::number(int(alarm->triggerRelated()))
+               << alarm->trigger()
+               << alarm->description();
+    }
+
+    // length-prefixed, so text moving from one field into the next still changes the hash
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QString& field : fields)
+    {
+        const QByteArray bytes = field.toUtf8();
+        hash.addData(QByteArray::number(bytes.size()) + ':');
+        hash.addData(bytes);
+    }
+
+    return hash.result();
+}
@@ -0,0 +1,44 @@
+#ifndef QICALDIFF_H
+#define QICALDIFF_H
+
+#include <QByteArray>
+#include <QList>
+
+#include "qicalcalendar.h"
+#include "qicalendar_global.h"
+
+struct QiCalEventChange
+{
+    QiCalEvent* before;
+    QiCalEvent* after;
+};
+
+struct QiCalDiff
+{
+    QList<QiCalEvent*> added;
+    QList<QiCalEvent*> removed;
+    QList<QiCalEventChange> modified;
+};
+
+// Compares two versions of a calendar through a UID index, using SEQUENCE and LAST-MODIFIED before falling back to content hashes.
+class QICALENDARSHARED_EXPORT QiCalDiffer
+{
+public:
+    QiCalDiffer();
+
+    bool compareContent() const;
+    void setCompareContent(bool compareContent);
+
+    QiCalDiff diff(const QiCalCalendar* before, const QiCalCalendar* after) const;
+    QiCalDiff diff(const QList<QiCalEvent*>& before, const QList<QiCalEvent*>& after) const;
+
+    bool isModified(const QiCalEvent* before, const QiCalEvent* after) const;
+
+    static QString key(const QiCalEvent* event);
+    static QByteArray fingerprint(const QiCalEvent* event);
+
+private:
+    bool m_compareContent;
+};
+
+#endif // QICALDIFF_H
@@ -1,8 +1,18 @@
 #include "qicalendar.h"
+#include "qicalrecurrence.h"
+#include "qicalruleplan.h"
+#include "qicalzoneregistry.h"
+#include "qicalsnapshot.h"
+#include "qicaldecompressor.h"
 
 #include <QVariant>
 #include <QString>
 #include <QFile>
+#include <QSet>
+#include <QPair>
+#include <QCryptographicHash>
+#include <QVector>
+#include <QTimeZone>
 #include <QDebug>
 #include <algorithm>
 #include <QtAlgorithms>
@@ -10,177 +20,225 @@
 #include <future>
 #include <tuple>
 
-using namespace std::placeholders;
-
-QiCalendarParser::QiCalendarParser() :
-    m_calendar(nullptr)
-{
-    m_states = {
-        {CAL_ROOT, {
-             {"VCALENDAR", [&](){
-                  m_calendar = new QiCalCalendar();
-                  m_state.push(QiCalendarParser::CAL_CALENDAR);}}
-         }
-        },
-        {CAL_CALENDAR, {
-             {"VTIMEZONE", [&](){
-                  m_calendar->addTimeZone(new QiCalTimeZone());
-                  m_state.push(QiCalendarParser::CAL_TIMEZONE);}},
-             {"VEVENT", [&](){
-                  m_calendar->addEvent(new QiCalEvent());
-                  m_state.push(QiCalendarParser::CAL_EVENT);}}
-         }
-        },
-        {CAL_TIMEZONE, {
-             {"STANDARD", [&](){
-                  m_calendar->timeZones().last()->setStandard(new QiCalTzInfo());
-                  m_state.push(QiCalendarParser::CAL_TZINFO_STD);}},
-             {"DAYLIGHT", [&](){
-                  m_calendar->timeZones().last()->setDayLight(new QiCalTzInfo());
-                  m_state.push(QiCalendarParser::CAL_TZINFO_DAYLIGHT);}}
-         }
-        },
-        {CAL_EVENT, {
-             {"VALARM", [&](){
-                  m_calendar->events().last()->addAlarm(new QiCalAlarm());
-                  m_state.push(QiCalendarParser::CAL_ALARM);}}
-         }
-        },
-    };
+namespace
+{
 
-    m_stateMap = {
-        {"VCALENDAR", CAL_CALENDAR},
-        {"VTIMEZONE", CAL_TIMEZONE},
-        {"STANDARD", CAL_TZINFO_STD},
-        {"DAYLIGHT", CAL_TZINFO_DAYLIGHT},
-        {"VEVENT", CAL_EVENT},
-        {"VALARM", CAL_ALARM}
-    };
+const int PARALLEL_MIN_RULES = 64;
+const int MAX_RULE_PLANS = 1024;
 
-    m_keyWords = {
-        { CAL_ROOT, {
-              {"BEGIN", VCAL_BEGIN},
-              {"END", VCAL_END}
-          }
-        },
-        { CAL_CALENDAR , {
-              {"BEGIN", VCAL_BEGIN},
-              {"PRODID", VCAL_STRING("prodId")},
-              {"VERSION", VCAL_STRING("version")},
-              {"METHOD", VCAL_STRING("method")},
-              {"END", VCAL_END}
-          }
-        },
-        { CAL_TIMEZONE, {
-              {"BEGIN", VCAL_BEGIN},
-              {"TZID", VCAL_STRING("tzId")},
-              {"END", VCAL_END}
-          }
-        },
-        { CAL_TZINFO_STD, {
-              {"TZOFFSETFROM", VCAL_INTEGER("offsetFrom")},
-              {"TZOFFSETTO", VCAL_INTEGER("offsetTo")},
-              {"TZNAME", VCAL_STRING("tzName")},
-              {"DTSTART", VCAL_DATETIME("dtStart")},
-              {"RRULE", VCAL_TZRULE},
-              {"END", VCAL_END}
-          }
-        },
-        { CAL_TZINFO_DAYLIGHT, {
-              {"TZOFFSETFROM", VCAL_INTEGER("offsetFrom")},
-              {"TZOFFSETTO", VCAL_INTEGER("offsetTo")},
-              {"TZNAME", VCAL_STRING("tzName")},
-              {"DTSTART", VCAL_DATETIME("dtStart")},
-              {"RRULE", VCAL_TZRULE},
-              {"END", VCAL_END}
-          }
-        },
-        { CAL_EVENT, {
-              {"BEGIN", VCAL_BEGIN},
-              {"DTSTART", VCAL_DATETIME("dtStart")},
-              {"DTEND", VCAL_DATETIME("dtEnd")},
-              {"DTSTAMP", VCAL_DATETIME("dtStamp")},
-              {"UID", VCAL_STRING("uid")},
-              {"CREATED", VCAL_DATETIME("created")},
-              {"DESCRIPTION", VCAL_STRING("description")},
-              {"SUMMARY", VCAL_STRING("summary")},
-              {"LAST-MODIFIED", VCAL_DATETIME("lastModified")},
-              {"STATUS", VCAL_EVTSTATUS},
-              {"TRANSP", VCAL_EVTTRANSP},
-              {"RRULE", VCAL_TZRULE},
-              {"END", VCAL_END}
-          }
-
-        },
-        { CAL_ALARM, {
-              {"DESCRIPTION", VCAL_STRING("description")},
-              {"ACTION", VCAL_ALARMACTION},
-              {"TRIGGER", VCAL_STRING("trigger")},
-              {"END", VCAL_END}
-          }
+// position of the first separator that is not inside a DQUOTE'd parameter value (RFC 5545 3.1)
+int unquotedIndexOf(const QString& text, QChar separator, int from = 0)
+{
+    bool quoted = false;
+    for (int i = from; i < text.size(); i++)
+    {
+        const QChar c = text.at(i);
+        if (c == '"')
+        {
+            quoted = !quoted;
         }
-    };
+        else if (c == separator && !quoted)
+        {
+            return i;
+        }
+    }
 
-    m_rRules = {
-        { "FREQ", [&](const QString& value){
-              QHash<QString, QiCalRule::Freq> freqs = {
-                  {"SECONDLY", QiCalRule::RR_SECONDLY},
-                  {"MINUTELY", QiCalRule::RR_MINUTELY},
-                  {"HOURLY", QiCalRule::RR_HOURLY},
-                  {"DAILY", QiCalRule::RR_DAILY},
-                  {"WEEKLY", QiCalRule::RR_WEEKLY},
-                  {"MONTHLY", QiCalRule::RR_MONTHLY},
-                  {"YEARLY", QiCalRule::RR_YEARLY}
-              };
-
-              setObjectValue("freq", freqs[value]);
-          }
-        },
-        { "BYMONTH", VCAL_INTEGER("monthList")},
-        { "BYDAY", VCAL_STRING("dayList")},
-        { "BYHOUR", VCAL_STRING("hourList")},
-        { "BYMINUTE", VCAL_STRING("minuteList")},
-        { "BYMONTHDAY", VCAL_STRING("monthDayList")},
-        { "BYSECOND", VCAL_STRING("secondList")},
-        { "BYSETPOS", VCAL_STRING("setposList")},
-        { "WKST", VCAL_STRING("wkst")},
-        { "INTERVAL", VCAL_INTEGER("interval")},
-        { "COUNT", VCAL_INTEGER("count")},
-        { "UNTIL", VCAL_DATETIME("until")}
-    };
+    return -1;
+}
 
-    m_alActions = {
-        { "AUDIO", QiCalAlarm::ACT_AUDIO },
-        { "DISPLAY", QiCalAlarm::ACT_DISPLAY },
-        { "EMAIL", QiCalAlarm::ACT_EMAIL }
-    };
+struct RuleOccurrence
+{
+    qint64 start;
+    QiCalRule* rule;
+    int order;
 
-    m_evtStatuses = {
-        { "TENTATIVE", QiCalEvent::STAT_TENTATIVE },
-        { "CONFIRMED", QiCalEvent::STAT_CONFIRMED },
-        { "CANCELLED", QiCalEvent::STAT_CANCELLED }
-    };
+    // ties keep calendar order, so the result does not depend on how rules were split across workers
+    bool operator <(const RuleOccurrence& other) const
+    {
+        return start < other.start || (start == other.start && order < other.order);
+    }
+};
 
-    m_evtTransps = {
-        { "OPAQUE", QiCalEvent::TRANS_OPAQUE },
-        { "TRANSPARENT", QiCalEvent::TRANS_TRANSPARENT }
-    };
+}
 
-    m_weekDays = {
-        { Qt::Monday, "MO" },
-        { Qt::Tuesday, "TU" },
-        { Qt::Wednesday, "WE" },
-        { Qt::Thursday, "TH" },
-        { Qt::Friday, "FR" },
-        { Qt::Saturday, "SA" },
-        { Qt::Sunday, "SU" }
-    };
+QiCalendarParser::QiCalendarParser() :
+    m_grammar(&grammar()),
+    m_calendar(nullptr),
+    m_expansionThreads(1)
+{
+}
 
-    m_wkst = {
-        { "SA", {"SA", "SU", "MO", "TU", "WE", "TH", "FR"} },
-        { "SU", {"SU", "MO", "TU", "WE", "TH", "FR", "SA"} },
-        { "MO", {"MO", "TU", "WE", "TH", "FR", "SA", "SU"} }
-    };
+const QiCalendarParser::Grammar &QiCalendarParser::grammar()
+{
+    // built once and only read afterwards, so any number of parsers can share it across threads
+    static const Grammar shared = []() {
+        Grammar grammar;
+
+        grammar.states = {
+            {CAL_ROOT, {
+                 {"VCALENDAR", [](QiCalendarParser* parser){
+                      if (parser->m_calendar == nullptr)
+                      {
+                          parser->m_calendar = new QiCalCalendar();
+                      }
+                      parser->m_state.push(QiCalendarParser::CAL_CALENDAR);}}
+             }
+            },
+            {CAL_CALENDAR, {
+                 {"VTIMEZONE", [](QiCalendarParser* parser){
+                      parser->m_calendar->addTimeZone(new QiCalTimeZone());
+                      parser->m_state.push(QiCalendarParser::CAL_TIMEZONE);}},
+                 {"VEVENT", [](QiCalendarParser* parser){
+                      parser->m_calendar->addEvent(new QiCalEvent());
+                      parser->m_state.push(QiCalendarParser::CAL_EVENT);}}
+             }
+            },
+            {CAL_TIMEZONE, {
+                 {"STANDARD", [](QiCalendarParser* parser){
+                      parser->m_calendar->timeZones().last()->setStandard(new QiCalTzInfo());
+                      parser->m_state.push(QiCalendarParser::CAL_TZINFO_STD);}},
+                 {"DAYLIGHT", [](QiCalendarParser* parser){
+                      parser->m_calendar->timeZones().last()->setDayLight(new QiCalTzInfo());
+                      parser->m_state.push(QiCalendarParser::CAL_TZINFO_DAYLIGHT);}}
+             }
+            },
+            {CAL_EVENT, {
+                 {"VALARM", [](QiCalendarParser* parser){
+                      parser->m_calendar->events().last()->addAlarm(new QiCalAlarm());
+                      parser->m_state.push(QiCalendarParser::CAL_ALARM);}}
+             }
+            },
+        };
+
+        grammar.stateMap = {
+            {"VCALENDAR", CAL_CALENDAR},
+            {"VTIMEZONE", CAL_TIMEZONE},
+            {"STANDARD", CAL_TZINFO_STD},
+            {"DAYLIGHT", CAL_TZINFO_DAYLIGHT},
+            {"VEVENT", CAL_EVENT},
+            {"VALARM", CAL_ALARM}
+        };
+
+        grammar.keyWords = {
+            { CAL_ROOT, {
+                  {"BEGIN", VCAL_BEGIN},
+                  {"END", VCAL_END}
+              }
+            },
+            { CAL_CALENDAR , {
+                  {"BEGIN", VCAL_BEGIN},
+                  {"PRODID", VCAL_STRING("prodId")},
+                  {"VERSION", VCAL_STRING("version")},
+                  {"METHOD", VCAL_STRING("method")},
+                  {"END", VCAL_END}
+              }
+            },
+            { CAL_TIMEZONE, {
+                  {"BEGIN", VCAL_BEGIN},
+                  {"TZID", VCAL_STRING("tzId")},
+                  {"END", VCAL_END}
+              }
+            },
+            { CAL_TZINFO_STD, {
+                  {"TZOFFSETFROM", VCAL_UTCOFFSET("offsetFrom")},
+                  {"TZOFFSETTO", VCAL_UTCOFFSET("offsetTo")},
+                  {"TZNAME", VCAL_STRING("tzName")},
+                  {"DTSTART", VCAL_DATETIME("dtStart")},
+                  {"RRULE", VCAL_TZRULE},
+                  {"RDATE", VCAL_DATELIST("rDates")},
+                  {"END", VCAL_END}
+              }
+            },
+            { CAL_TZINFO_DAYLIGHT, {
+                  {"TZOFFSETFROM", VCAL_UTCOFFSET("offsetFrom")},
+                  {"TZOFFSETTO", VCAL_UTCOFFSET("offsetTo")},
+                  {"TZNAME", VCAL_STRING("tzName")},
+                  {"DTSTART", VCAL_DATETIME("dtStart")},
+                  {"RRULE", VCAL_TZRULE},
+                  {"RDATE", VCAL_DATELIST("rDates")},
+                  {"END", VCAL_END}
+              }
+            },
+            { CAL_EVENT, {
+                  {"BEGIN", VCAL_BEGIN},
+                  {"DTSTART", VCAL_DATETIME("dtStart")},
+                  {"DTEND", VCAL_DATETIME("dtEnd")},
+                  {"DTSTAMP", VCAL_DATETIME("dtStamp")},
+                  {"UID", VCAL_STRING("uid")},
+                  {"CREATED", VCAL_DATETIME("created")},
+                  {"DESCRIPTION", VCAL_STRING("description")},
+                  {"SUMMARY", VCAL_STRING("summary")},
+                  {"LAST-MODIFIED", VCAL_DATETIME("lastModified")},
+                  {"STATUS", VCAL_EVTSTATUS},
+                  {"TRANSP", VCAL_EVTTRANSP},
+                  {"SEQUENCE", VCAL_INTEGER("sequence")},
+                  {"RRULE", VCAL_TZRULE},
+                  {"EXDATE", VCAL_DATELIST("exDates")},
+                  {"RDATE", VCAL_DATELIST("rDates")},
+                  {"END", VCAL_END}
+              }
+
+            },
+            { CAL_ALARM, {
+                  {"DESCRIPTION", VCAL_STRING("description")},
+                  {"ACTION", VCAL_ALARMACTION},
+                  {"TRIGGER", VCAL_ALARMTRIGGER},
+                  {"END", VCAL_END}
+              }
+            }
+        };
+
+        grammar.rRules = {
+            { "FREQ", [](QiCalendarParser* parser, const QString& value){
+                  parser->setObjectValue("freq", parser->m_grammar->freqs.value(value));
+              }
+            },
+            { "BYMONTH", VCAL_STRING("monthList")},
+            { "BYDAY", VCAL_STRING("dayList")},
+            { "BYHOUR", VCAL_STRING("hourList")},
+            { "BYMINUTE", VCAL_STRING("minuteList")},
+            { "BYMONTHDAY", VCAL_STRING("monthDayList")},
+            { "BYYEARDAY", VCAL_STRING("yearDayList")},
+            { "BYWEEKNO", VCAL_STRING("weekList")},
+            { "BYSECOND", VCAL_STRING("secondList")},
+            { "BYSETPOS", VCAL_STRING("setposList")},
+            { "WKST", VCAL_STRING("wkst")},
+            { "INTERVAL", VCAL_INTEGER("interval")},
+            { "COUNT", VCAL_INTEGER("count")},
+            { "UNTIL", VCAL_DATETIME("until")}
+        };
+
+        grammar.freqs = {
+            {"SECONDLY", QiCalRule::RR_SECONDLY},
+            {"MINUTELY", QiCalRule::RR_MINUTELY},
+            {"HOURLY", QiCalRule::RR_HOURLY},
+            {"DAILY", QiCalRule::RR_DAILY},
+            {"WEEKLY", QiCalRule::RR_WEEKLY},
+            {"MONTHLY", QiCalRule::RR_MONTHLY},
+            {"YEARLY", QiCalRule::RR_YEARLY}
+        };
+
+        grammar.alActions = {
+            { "AUDIO", QiCalAlarm::ACT_AUDIO },
+            { "DISPLAY", QiCalAlarm::ACT_DISPLAY },
+            { "EMAIL", QiCalAlarm::ACT_EMAIL }
+        };
+
+        grammar.evtStatuses = {
+            { "TENTATIVE", QiCalEvent::STAT_TENTATIVE },
+            { "CONFIRMED", QiCalEvent::STAT_CONFIRMED },
+            { "CANCELLED", QiCalEvent::STAT_CANCELLED }
+        };
+
+        grammar.evtTransps = {
+            { "OPAQUE", QiCalEvent::TRANS_OPAQUE },
+            { "TRANSPARENT", QiCalEvent::TRANS_TRANSPARENT }
+        };
+
+        return grammar;
+    }();
+
+    return shared;
 }
 
 bool QiCalendarParser::parseFile(const QString &filePath)
@@ -191,50 +249,85 @@ bool QiCalendarParser::parseFile(const QString &filePath)
         m_calendar = nullptr;
     }
 
-    m_state.clear();
-    m_state.push(CAL_ROOT);
+    m_snapshot.clear();
+    m_zones.clear();
+    m_eventBlocks.clear();
+    m_zoneBlocks.clear();
 
-    QFile file(filePath);
-    if (!file.open(QFile::ReadOnly))
+    if (!readFile(filePath, nullptr))
     {
+        delete m_calendar;
+        m_calendar = nullptr;
         return false;
     }
 
-    QByteArray lineData = file.readLine();
-    while (!lineData.isEmpty())
+    return true;
+}
+
+bool QiCalendarParser::loadFile(const QString &filePath, const QString &snapshotPath)
+{
+    QSharedPointer<QiCalSnapshot> snapshot(new QiCalSnapshot());
+    if (snapshot->open(snapshotPath) && !snapshot->isStale(filePath))
     {
-        QString line(lineData);
-        QStringList cmdVal = line.split(":");
+        // records are read in place from the mapping; objects are only built when calendar() is first asked for
+        delete m_calendar;
+        m_calendar = nullptr;
+        m_snapshot = snapshot;
+        m_zones.clear();
+        m_eventBlocks.clear();
+        m_zoneBlocks.clear();
+        return true;
+    }
+    snapshot.clear();
 
-        if (cmdVal.size() > 1)
-        {
-            QString cmd = cmdVal[0];
-            if (!m_keyWords[m_state.top()][cmd] && cmd.startsWith("DT"))
-            {
-                QStringList dtCmd = cmd.split(";");
-                if (dtCmd.size() > 1)
-                {
-                    cmd = dtCmd[0];
-                }
-            }
+    if (!parseFile(filePath))
+    {
+        return false;
+    }
 
-            if (m_keyWords[m_state.top()][cmd])
-            {
-                QString value = cmdVal[1].trimmed();
-                m_keyWords[m_state.top()][cmd](value);
-            }
-        }
+    QiCalSnapshot::save(m_calendar, snapshotPath, filePath);
 
-        lineData = file.readLine();
+    return true;
+}
+
+bool QiCalendarParser::reloadFile(const QString &filePath, QiCalChangeReport *report)
+{
+    calendar();
+
+    return readFile(filePath, report);
+}
+
+QiCalCalendar *QiCalendarParser::calendar()
+{
+    if (m_calendar == nullptr && !m_snapshot.isNull())
+    {
+        m_calendar = m_snapshot->toCalendar();
+        m_snapshot.clear();
     }
 
-    return m_calendar != nullptr;
+    return m_calendar;
+}
+
+const QiCalSnapshot *QiCalendarParser::snapshot() const
+{
+    return m_snapshot.data();
+}
+
+QiCalCalendar *QiCalendarParser::takeCalendar()
+{
+    QiCalCalendar* calendar = this->calendar();
+
+    m_calendar = nullptr;
+    m_eventBlocks.clear();
+    m_zoneBlocks.clear();
+
+    return calendar;
 }
 
 QList<QiCalEvent *> QiCalendarParser::eventsFrom(const QDateTime &from)
 {
     QList<QiCalEvent*> ret;
-    for (QiCalEvent* ev : m_calendar->events())
+    for (QiCalEvent* ev : calendar()->events())
     {
         if (ev->dtStart() >= from)
         {
@@ -247,28 +340,416 @@ QList<QiCalEvent *> QiCalendarParser::eventsFrom(const QDateTime &from)
 
 QList<QiCalEvent *> QiCalendarParser::eventsRange(const QDateTime &from, const QDateTime &to)
 {
-    //auto ruleEvents = std::async(std::launch::async, [&](){ return genRuleEvents(from, to); });
+    const auto earlier = [](QiCalEvent* eventA, QiCalEvent* eventB) {
+        return eventA->dtStart() < eventB->dtStart();
+    };
 
     QList<QiCalEvent*> ret;
-    for (QiCalEvent* ev : m_calendar->events())
+    for (QiCalEvent* ev : calendar()->events())
     {
-        if (ev->dtStart() >= from && ev->dtStart() <= to)
+        if (ev->rule() == nullptr && ev->dtStart() >= from && ev->dtStart() <= to)
         {
             ret.push_back(ev);
         }
     }
 
+    std::sort(ret.begin(), ret.end(), earlier);
+
+    const int singles = ret.count();
     ret.append(genRuleEvents(from, to));
-    std::sort(ret.begin(), ret.end(), [](QiCalEvent* eventA, QiCalEvent* eventB) {
-        return eventA->dtStart() < eventB->dtStart();
-    });
+    std::inplace_merge(ret.begin(), ret.begin() + singles, ret.end(), earlier);
 
     return ret;
 }
 
+int QiCalendarParser::expansionThreads() const
+{
+    return m_expansionThreads;
+}
+
+void QiCalendarParser::setExpansionThreads(int threads)
+{
+    m_expansionThreads = threads;
+}
+
+QList<QiCalConflict> QiCalendarParser::conflictsRange(const QDateTime &from, const QDateTime &to, const QiCalConflictDetector &detector)
+{
+    return detector.conflicts(eventsRange(from, to));
+}
+
+QList<QiCalConflict> QiCalendarParser::conflictsRange(const QList<QiCalendarParser *> &parsers, const QDateTime &from, const QDateTime &to, const QiCalConflictDetector &detector)
+{
+    QList<QiCalEvent*> events;
+    for (QiCalendarParser* parser : parsers)
+    {
+        if (parser->calendar() != nullptr)
+        {
+            events.append(parser->eventsRange(from, to));
+        }
+    }
+
+    return detector.conflicts(events);
+}
+
+bool QiCalendarParser::readFile(const QString &filePath, QiCalChangeReport *report)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    // compressed input is inflated block by block while it is being tokenized
+    QiCalDecompressor decompressor(&file);
+    QIODevice* input = &file;
+    if (decompressor.format() != QiCalDecompressor::FMT_PLAIN)
+    {
+        if (!decompressor.open(QIODevice::ReadOnly))
+        {
+            return false;
+        }
+        input = &decompressor;
+    }
+
+    m_state.clear();
+    m_state.push(CAL_ROOT);
+
+    // top-level VTIMEZONE and VEVENT blocks are keyed by a hash of their raw lines; unchanged blocks keep their objects
+    QiCalChangeReport changes;
+    QHash<QByteArray, QiCalEvent*> eventBlocks;
+    QHash<QByteArray, QiCalTimeZone*> zoneBlocks;
+    QSet<QiCalEvent*> keptEvents;
+    QSet<QiCalTimeZone*> keptZones;
+    QList<QPair<QByteArray, QiCalEvent*> > parsed;
+    QList<QiCalTimeZone*> parsedZones;
+    QSet<QString> changedZones;
+    bool zonesDone = false;
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QList<QByteArray> block;
+    QString blockEnd;
+
+    const auto parseBlock = [&]() {
+        for (const QByteArray& blockLine : block)
+        {
+            parseLine(QString(blockLine));
+        }
+    };
+
+    const auto zoneChanged = [&](const QString& tzId) {
+        changedZones.insert(tzId);
+        m_zones.remove(tzId);
+        changes.timeZones.push_back(tzId);
+    };
+
+    const auto finishZones = [&]() {
+        if (zonesDone || m_calendar == nullptr)
+        {
+            return;
+        }
+
+        zonesDone = true;
+        for (QiCalTimeZone* zone : m_calendar->timeZones())
+        {
+            if (!keptZones.contains(zone) && !m_retiredZones.contains(zone))
+            {
+                zoneChanged(zone->tzId());
+                m_retiredZones.insert(zone);
+            }
+        }
+    };
+
+    const auto endBlock = [&]() {
+        const QByteArray key = hash.result();
+        hash.reset();
+
+        if (blockEnd == "END:VTIMEZONE")
+        {
+            QiCalTimeZone* zone = m_zoneBlocks.value(key);
+            if (zone == nullptr || keptZones.contains(zone) || m_retiredZones.contains(zone) || !m_calendar->timeZones().contains(zone))
+            {
+                parseBlock();
+                zone = m_calendar->timeZones().last();
+                zone->setFingerprint(key);
+                parsedZones.push_back(zone);
+
+                // replaced zones stay in the calendar until the whole file has been read
+                for (QiCalTimeZone* previous : m_calendar->timeZones())
+                {
+                    if (previous != zone && !keptZones.contains(previous) && previous->tzId() == zone->tzId())
+                    {
+                        m_retiredZones.insert(previous);
+                    }
+                }
+
+                zoneChanged(zone->tzId());
+            }
+
+            keptZones.insert(zone);
+            zoneBlocks.insert(key, zone);
+        }
+        else
+        {
+            finishZones();
+
+            QiCalEvent* event = m_eventBlocks.value(key);
+            if (event != nullptr && !keptEvents.contains(event) && (event->zone().isNull() || !changedZones.contains(event->zone()->tzId())))
+            {
+                keptEvents.insert(event);
+                eventBlocks.insert(key, event);
+            }
+            else
+            {
+                parseBlock();
+                parsed.push_back(qMakePair(key, m_calendar->events().last()));
+                keptEvents.insert(parsed.last().second);
+            }
+        }
+
+        block.clear();
+        blockEnd.clear();
+    };
+
+    QByteArray lineData = input->readLine();
+    while (!lineData.isEmpty())
+    {
+        // folded lines (RFC 5545 3.1) continue on lines starting with a space or tab; octets are joined before decoding
+        QByteArray nextData = input->readLine();
+        while (nextData.startsWith(' ') || nextData.startsWith('\t'))
+        {
+            lineData.chop(lineData.endsWith("\r\n") ? 2 : (lineData.endsWith('\n') ? 1 : 0));
+            lineData.append(nextData.constData() + 1, nextData.size() - 1);
+            nextData = input->readLine();
+        }
+
+        QString line(lineData);
+        const QString trimmed = line.trimmed();
+
+        if (!blockEnd.isEmpty())
+        {
+            block.push_back(lineData);
+            hash.addData(lineData);
+
+            if (trimmed == blockEnd)
+            {
+                endBlock();
+            }
+        }
+        else if (m_state.top() == CAL_CALENDAR && (trimmed == "BEGIN:VEVENT" || trimmed == "BEGIN:VTIMEZONE"))
+        {
+            blockEnd = "END:" + trimmed.mid(6);
+            block.push_back(lineData);
+            hash.addData(lineData);
+        }
+        else
+        {
+            parseLine(line);
+        }
+
+        lineData = nextData;
+    }
+
+    // a read error leaves the tail of the file unseen, so nothing may be treated as removed or replaced
+    if (decompressor.hasError() || file.error() != QFile::NoError)
+    {
+        for (const QPair<QByteArray, QiCalEvent*>& item : parsed)
+        {
+            m_calendar->removeEvent(item.second);
+        }
+
+        for (QiCalTimeZone* zone : parsedZones)
+        {
+            m_calendar->removeTimeZone(zone);
+        }
+
+        for (const QString& tzId : changedZones)
+        {
+            m_zones.remove(tzId);
+        }
+
+        m_retiredZones.clear();
+        return false;
+    }
+
+    if (!blockEnd.isEmpty())
+    {
+        endBlock();
+    }
+
+    if (m_calendar == nullptr)
+    {
+        return false;
+    }
+
+    finishZones();
+
+    for (QiCalTimeZone* zone : m_retiredZones)
+    {
+        m_calendar->removeTimeZone(zone);
+    }
+    m_retiredZones.clear();
+
+    QMultiHash<QString, QiCalEvent*> stale;
+    for (QiCalEvent* event : m_calendar->events())
+    {
+        if (!keptEvents.contains(event))
+        {
+            stale.insert(event->uid(), event);
+        }
+    }
+
+    for (const QPair<QByteArray, QiCalEvent*>& item : parsed)
+    {
+        QiCalEvent* previous = stale.take(item.second->uid());
+        if (previous != nullptr)
+        {
+            updateEvent(previous, item.second);
+            eventBlocks.insert(item.first, previous);
+            changes.updated.push_back(previous);
+        }
+        else
+        {
+            eventBlocks.insert(item.first, item.second);
+            changes.added.push_back(item.second);
+        }
+    }
+
+    for (QiCalEvent* event : stale)
+    {
+        changes.removed.push_back(event->uid());
+        m_calendar->removeEvent(event);
+    }
+
+    m_eventBlocks = eventBlocks;
+    m_zoneBlocks = zoneBlocks;
+
+    if (report != nullptr)
+    {
+        *report = changes;
+    }
+
+    return true;
+}
+
+void QiCalendarParser::parseLine(const QString &line)
+{
+    // the name ends at the first colon outside a quoted parameter value; text values may contain more
+    const int colon = unquotedIndexOf(line, ':');
+
+    if (colon >= 0)
+    {
+        const QString params = line.left(colon);
+        QString cmd = params;
+        m_params.clear();
+        if (!keyWord(cmd))
+        {
+            const int semicolon = unquotedIndexOf(params, ';');
+            if (semicolon >= 0)
+            {
+                int from = semicolon + 1;
+                cmd = params.left(semicolon);
+                while (from <= params.size())
+                {
+                    int next = unquotedIndexOf(params, ';', from);
+                    if (next < 0)
+                    {
+                        next = params.size();
+                    }
+
+                    const QString param = params.mid(from, next - from);
+                    int eq = param.indexOf('=');
+                    if (eq > 0)
+                    {
+                        QString value = param.mid(eq + 1);
+                        if (value.size() > 1 && value.startsWith('"') && value.endsWith('"'))
+                        {
+                            value = value.mid(1, value.size() - 2);
+                        }
+                        m_params.insert(param.left(eq).toUpper(), value);
+                    }
+
+                    from = next + 1;
+                }
+            }
+        }
+
+        const ValueHandler handler = keyWord(cmd);
+        if (handler)
+        {
+            QString value = line.mid(colon + 1).trimmed();
+            handler(this, value);
+        }
+    }
+}
+
+void QiCalendarParser::updateEvent(QiCalEvent *target, QiCalEvent *source)
+{
+    QiCalRule* previousRule = target->rule();
+    QiCalRule* rule = source->rule();
+
+    source->setRule(nullptr);
+    if (rule != nullptr)
+    {
+        rule->setCalEvent(target);
+    }
+    target->setRule(rule);
+
+    if (previousRule != nullptr)
+    {
+        m_calendar->removeRule(previousRule);
+        delete previousRule;
+    }
+
+    target->setZone(source->zone());
+    target->setDtStart(source->dtStart());
+    target->setDtEnd(source->dtEnd());
+    target->setDtStamp(source->dtStamp());
+    target->setCreated(source->created());
+    target->setLastModified(source->lastModified());
+    target->setSummary(source->summary());
+    target->setDescription(source->description());
+    target->setLocation(source->location());
+    target->setStatus(source->status());
+    target->setTransp(source->transp());
+    target->setSequence(source->sequence());
+    target->setAllDay(source->isAllDay());
+    target->setExDates(source->exDates());
+    target->setRDates(source->rDates());
+
+    target->clearAlarms();
+    for (QiCalAlarm* alarm : source->alarms())
+    {
+        target->addAlarm(alarm);
+    }
+
+    m_calendar->removeEvent(source);
+}
+
 void QiCalendarParser::parseString(const QString &propertyName, const QString &value)
 {
-    setObjectValue(propertyName, value);
+    if (!value.contains('\\'))
+    {
+        setObjectValue(propertyName, value);
+        return;
+    }
+
+    // TEXT escapes written by QiCalWriter (RFC 5545 3.3.11)
+    QString text;
+    text.reserve(value.size());
+    for (int i = 0; i < value.size(); i++)
+    {
+        if (value.at(i) == '\\' && i + 1 < value.size())
+        {
+            const QChar next = value.at(++i);
+            text.append(next == 'n' || next == 'N' ? QChar('\n') : next);
+        }
+        else
+        {
+            text.append(value.at(i));
+        }
+    }
+
+    setObjectValue(propertyName, text);
 }
 
 void QiCalendarParser::parseInt(const QString &propertyName, const QString &value)
@@ -277,26 +758,146 @@ void QiCalendarParser::parseInt(const QString &propertyName, const QString &valu
     setObjectValue(propertyName, val);
 }
 
+void QiCalendarParser::parseUtcOffset(const QString &propertyName, const QString &value)
+{
+    const QString digits = value.mid(1);
+    if ((!value.startsWith('+') && !value.startsWith('-')) || (digits.size() != 4 && digits.size() != 6))
+    {
+        return;
+    }
+
+    for (const QChar& digit : digits)
+    {
+        if (!digit.isDigit())
+        {
+            return;
+        }
+    }
+
+    const int offset = digits.left(2).toInt() * 3600 + digits.mid(2, 2).toInt() * 60 + digits.mid(4, 2).toInt();
+    setObjectValue(propertyName, value.startsWith('-') ? -offset : offset);
+}
+
 void QiCalendarParser::parseDate(const QString &propertyName, const QString &value)
 {
-    QDateTime date = QDateTime::fromString(value, "yyyyMMddThhmmss");
+    QDateTime date = toDateTime(value);
 
     if (!date.isValid())
     {
-        date = QDateTime::fromString(value, "yyyyMMddThhmmssZ");
+        date = QDateTime::fromString("01011970T000000", "ddMMyyyyThhmmss");
+    }
+
+    QSharedPointer<const QiCalZoneTable> zone;
+    if (date.timeSpec() == Qt::LocalTime && m_params.contains("TZID"))
+    {
+        zone = resolveZone(m_params.value("TZID"));
+    }
+
+    QiCalEvent* evt = qobject_cast<QiCalEvent*>(currentObject());
+    if (!zone.isNull())
+    {
+        date = zone->toDateTime(date.date(), date.time());
+
+        if (evt != nullptr && propertyName == "dtStart")
+        {
+            evt->setZone(zone);
+        }
+    }
+
+    if (evt != nullptr && propertyName == "dtStart")
+    {
+        evt->setAllDay(m_params.value("VALUE").toUpper() == "DATE" || value.size() == 8);
+    }
+
+    setObjectValue(propertyName, date);
+}
+
+void QiCalendarParser::parseDateList(const QString &propertyName, const QString &value)
+{
+    QObject* cur = currentObject();
+
+    if (cur == nullptr)
+    {
+        return;
+    }
+
+    QVector<qint64> dates = cur->property(propertyName.toStdString().c_str()).value<QVector<qint64> >();
+
+    QSharedPointer<const QiCalZoneTable> zone;
+    if (m_params.contains("TZID"))
+    {
+        zone = resolveZone(m_params.value("TZID"));
+    }
+
+    for (const QString& item : value.split(","))
+    {
+        QDateTime date = toDateTime(item.section('/', 0, 0));
+
+        if (date.isValid())
+        {
+            if (qobject_cast<QiCalTzInfo*>(cur) != nullptr)
+            {
+                // observance onsets are local time in TZOFFSETFROM, which may not be known yet
+                date = QDateTime(date.date(), date.time(), Qt::UTC);
+            }
+            else if (!zone.isNull() && date.timeSpec() == Qt::LocalTime)
+            {
+                date = zone->toDateTime(date.date(), date.time());
+            }
+            dates.push_back(date.toMSecsSinceEpoch());
+        }
     }
 
+    setObjectValue(propertyName, QVariant::fromValue(dates));
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalendarParser::resolveZone(const QString &tzId)
+{
+    QString id = tzId;
+    id.remove('"');
+
+    auto cached = m_zones.constFind(id);
+    if (cached != m_zones.constEnd())
+    {
+        return cached.value();
+    }
+
+    QSharedPointer<const QiCalZoneTable> zone;
+    for (QiCalTimeZone* timeZone : m_calendar->timeZones())
+    {
+        if (timeZone->tzId() == id && !m_retiredZones.contains(timeZone))
+        {
+            zone = timeZone->zoneTable();
+            break;
+        }
+    }
+
+    if (zone.isNull())
+    {
+        zone = QiCalZoneRegistry::instance()->systemZone((id.startsWith('/') ? id.mid(1) : id).toUtf8());
+    }
+
+    m_zones.insert(id, zone);
+
+    return zone;
+}
+
+QDateTime QiCalendarParser::toDateTime(const QString &value)
+{
+    QDateTime date = QDateTime::fromString(value, "yyyyMMddThhmmss");
+
     if (!date.isValid())
     {
-        date = QDateTime::fromString(value, "yyyyMMdd");
+        date = QDateTime::fromString(value, "yyyyMMddThhmmssZ");
+        date.setTimeSpec(Qt::UTC);
     }
 
     if (!date.isValid())
     {
-        date = QDateTime::fromString("01011970T000000", "ddMMyyyyThhmmss");
+        date = QDateTime::fromString(value, "yyyyMMdd");
     }
 
-    setObjectValue(propertyName, date);
+    return date;
 }
 
 void QiCalendarParser::parseRule(const QString &value)
@@ -323,28 +924,49 @@ void QiCalendarParser::parseRule(const QString &value)
     for (QString param : params)
     {
         QStringList values = param.split("=");
-        if (values.count() == 2 && m_rRules[values[0]])
+        const ValueHandler handler = values.count() == 2 ? m_grammar->rRules.value(values[0]) : nullptr;
+        if (handler)
         {
-            m_rRules[values[0]](values[1]);
+            handler(this, values[1]);
         }
     }
 
     m_state.pop();
+
+    // plans outlive single files in pooled parsers, so the cache is bounded; rules keep their own reference
+    if (m_rulePlans.size() >= MAX_RULE_PLANS && !m_rulePlans.contains(value))
+    {
+        m_rulePlans.clear();
+    }
+
+    QSharedPointer<const QiCalRulePlan>& plan = m_rulePlans[value];
+    if (plan.isNull())
+    {
+        plan = QiCalRulePlan::compile(rule);
+    }
+
+    rule->setPlan(plan);
 }
 
 void QiCalendarParser::parseAlarmAction(const QString &value)
 {
-    setObjectValue("action", m_alActions[value]);
+    setObjectValue("action", m_grammar->alActions.value(value));
+}
+
+void QiCalendarParser::parseAlarmTrigger(const QString &value)
+{
+    setObjectValue("triggerRelated", m_params.value("RELATED") == "END" ? QiCalAlarm::REL_END : QiCalAlarm::REL_START);
+    setObjectValue("trigger", value);
 }
 
 void QiCalendarParser::parseEvtStatus(const QString &value)
 {
-    setObjectValue("status", m_evtStatuses[value]);
+    setObjectValue("status", m_grammar->evtStatuses.value(value));
 }
 
 void QiCalendarParser::parseEvtTransp(const QString &value)
 {
-    setObjectValue("transp", m_evtTransps[value]);
+    setObjectValue("transp", m_grammar->evtTransps.value(value));
 }
 
 void QiCalendarParser::setObjectValue(const QString &propertyName, const QVariant &value)
@@ -359,22 +981,33 @@ void QiCalendarParser::setObjectValue(const QString &propertyName, const QVarian
 
 void QiCalendarParser::switchState(const QString &state)
 {
-    auto switchFn = m_states[m_state.top()][state];
+    auto states = m_grammar->states.constFind(m_state.top());
 
-    if (switchFn)
+    if (states != m_grammar->states.constEnd())
     {
-        switchFn();
+        const StateHandler switchFn = states.value().value(state);
+        if (switchFn)
+        {
+            switchFn(this);
+        }
     }
 }
 
 void QiCalendarParser::endState(const QString &state)
 {
-    if (m_stateMap[state] == m_state.top())
+    if (m_grammar->stateMap.value(state, CAL_ROOT) == m_state.top())
     {
         m_state.pop();
     }
 }
 
+QiCalendarParser::ValueHandler QiCalendarParser::keyWord(const QString &name) const
+{
+    auto keyWords = m_grammar->keyWords.constFind(m_state.top());
+
+    return keyWords != m_grammar->keyWords.constEnd() ? keyWords.value().value(name) : nullptr;
+}
+
 QObject *QiCalendarParser::currentObject()
 {
     auto stateObject = [&](State state) -> QObject* {
@@ -417,324 +1050,124 @@ QList<QiCalEvent *> QiCalendarParser::genRuleEvents(const QDateTime &from, const
 
     const auto addEvent = [&](QiCalRule* rule, const QDateTime& current) {
         QiCalEvent* event = new QiCalEvent(m_calendar);
+        event->setMasterEvent(rule->calEvent());
         event->setCreated(rule->calEvent()->created());
         event->setDescription(rule->calEvent()->description());
+        const QSharedPointer<const QiCalZoneTable> zone = rule->calEvent()->zone();
         if (rule->calEvent()->dtEnd().isValid())
         {
-            QDateTime dtEnd = current;
-            dtEnd.setTime(rule->calEvent()->dtEnd().time());
-            event->setDtEnd(dtEnd.addDays(rule->calEvent()->dtStart().daysTo(rule->calEvent()->dtEnd())));
+            QDateTime end = current.addMSecs(rule->calEvent()->dtStart().msecsTo(rule->calEvent()->dtEnd()));
+            if (!zone.isNull() && current.timeSpec() == Qt::OffsetFromUTC)
+            {
+                end = end.toOffsetFromUtc(zone->offsetAtUtc(end.toMSecsSinceEpoch() / 1000));
+            }
+            event->setDtEnd(end);
         }
-        event->setDtStart(QDateTime(current.date(), rule->calEvent()->dtStart().time()));
+        event->setDtStart(current);
+        event->setZone(zone);
         event->setDtStamp(rule->calEvent()->dtStamp());
         event->setLastModified(rule->calEvent()->lastModified());
         event->setLocation(rule->calEvent()->location());
         event->setStatus(rule->calEvent()->status());
         event->setSummary(rule->calEvent()->summary());
         event->setTransp(rule->calEvent()->transp());
+        event->setSequence(rule->calEvent()->sequence());
+        event->setAllDay(rule->calEvent()->isAllDay());
         event->setUid(rule->calEvent()->uid());
 
         result.push_back(event);
     };
 
-    const auto calcEnd = [&to](QiCalRule* rule, QDateTime&& countEnd) -> QDateTime {
-        QDateTime endDate;
-        if (rule->count() > -1)
-        {
-            endDate = countEnd;
-        }
-        if ((rule->until().isValid() && endDate.isValid() && rule->until() < endDate)
-                || (rule->until().isValid() && !endDate.isValid()))
+    QList<QiCalRule*> rules;
+    for (QiCalRule* rule : m_calendar->rules())
+    {
+        if (rule->calEvent() != nullptr)
         {
-            endDate = rule->until();
+            rules.push_back(rule);
         }
+    }
+
+    int threads = m_expansionThreads > 0 ? m_expansionThreads : int(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, rules.count() / PARALLEL_MIN_RULES));
 
-        if (!endDate.isValid())
+    // each rule (and its occurrence cache) is only ever touched by one worker
+    const auto expand = [&rules, &from, &to, threads](int worker) {
+        std::vector<RuleOccurrence> buffer;
+        for (int i = worker; i < rules.count(); i += threads)
         {
-            endDate = to;
+            QiCalRule* rule = rules.at(i);
+            for (qint64 msecs : rule->occurrencesBetween(from, to))
+            {
+                buffer.push_back({ msecs, rule, i });
+            }
         }
 
-        return endDate;
+        std::sort(buffer.begin(), buffer.end());
+        return buffer;
     };
 
-    const auto dayWithOrder = [](const QString& byDay) -> std::tuple<qint8, QString> {
-        QString day = byDay.right(2);
-        QString num = QString(byDay).replace(day, "");
-        qint8 dayOrder = num.toInt();
-
-        return std::make_tuple(dayOrder, day);
-    };
-
-    const auto dayList = [&](QiCalRule* rule, const QDate& curDate) -> QList<QDate> {
-        QList<QDate> retList;
-        for (quint8 day : rule->byMonthDay())
+    std::vector<std::vector<RuleOccurrence> > buffers;
+    if (threads == 1)
+    {
+        buffers.push_back(expand(0));
+    }
+    else
+    {
+        std::vector<std::future<std::vector<RuleOccurrence> > > workers;
+        for (int worker = 0; worker < threads; worker++)
         {
-            QDate date(curDate.year(), curDate.month(), day);
-            retList << date;
+            workers.push_back(std::async(std::launch::async, expand, worker));
         }
 
-        for (const QString& byDay : rule->byDay())
+        for (auto& worker : workers)
         {
-            QString day;
-            qint8 dayOrder = 0;
-            std::tie(dayOrder, day) = dayWithOrder(byDay);
-
-            auto it = std::find_if(m_weekDays.begin(), m_weekDays.end(), [&day](const auto& dayName) {
-                return dayName == day;
-            });
-
-            if (it == m_weekDays.end())
-            {
-                continue;
-            }
-
-            Qt::DayOfWeek dow = (Qt::DayOfWeek)it.key();
-            QDate firstDay = QDate(curDate.year(), curDate.month(), 1);
-            qint8 firstOffset = dow - firstDay.dayOfWeek();
-            firstOffset = firstOffset >= 0 ? firstOffset : 7 + firstOffset;
-            QDate lastDay = QDate(curDate.year(), curDate.month() + 1, 1).addDays(-1);
-            quint8 lastOffset = lastDay.dayOfWeek() - dow;
-            lastOffset = lastOffset > 0 ? lastOffset : 7 + lastOffset;
-
-            if (dayOrder > 0)
-            {
-                retList << firstDay.addDays(firstOffset + 7 * (dayOrder - 1));
-            }
-            else if (dayOrder < 0)
-            {
-                retList << lastDay.addDays(-(lastOffset + 7 * (dayOrder -1)));
-            }
-            else
-            {
-                QDate resDate(curDate.year(), curDate.month(), firstOffset);
-                while (resDate.month() == curDate.month())
-                {
-                    retList << resDate;
-                    resDate = resDate.addDays(7);
-                }
-            }
+            buffers.push_back(worker.get());
         }
+    }
 
-        if (retList.isEmpty())
+    while (buffers.size() > 1)
+    {
+        std::vector<std::future<std::vector<RuleOccurrence> > > merges;
+        for (size_t i = 0; i + 1 < buffers.size(); i += 2)
         {
-            QDate date(curDate.year(), curDate.month(), rule->calEvent()->dtStart().date().day());
-            retList << date;
+            merges.push_back(std::async(std::launch::async, [&buffers, i]() {
+                std::vector<RuleOccurrence> merged(buffers[i].size() + buffers[i + 1].size());
+                std::merge(buffers[i].begin(), buffers[i].end(), buffers[i + 1].begin(), buffers[i + 1].end(), merged.begin());
+                return merged;
+            }));
         }
 
-        std::sort(retList.begin(), retList.end());
-
-        return retList;
-    };
-
-    for (QiCalRule* rule : m_calendar->rules())
-    {
-        if (rule->calEvent() == nullptr)
+        std::vector<std::vector<RuleOccurrence> > next;
+        for (auto& merge : merges)
         {
-            continue;
+            next.push_back(merge.get());
         }
 
-        QDateTime start = rule->calEvent()->dtStart();
-        switch (rule->freq()) {
-        case QiCalRule::RR_DAILY:
+        if (buffers.size() % 2 == 1)
         {
-            QDateTime endDate(calcEnd(rule, start.addDays(rule->count() * rule->interval() - 1)));
-            QDateTime current = from;
-
-            while (current <= endDate)
-            {
-                if (start.daysTo(current) % rule->interval() == 0)
-                {
-                    addEvent(rule, current);
-                    current = current.addDays(rule->interval());
-                }
-                else
-                {
-                    current = current.addDays(1);
-                }
-            }
-            break;
+            next.push_back(std::move(buffers.back()));
         }
-        case QiCalRule::RR_WEEKLY:
-        {
-            QDateTime endDate(calcEnd(rule, start.addDays(rule->count() * 7 * rule->interval() - 7)));
-            QDateTime current = from;
-            QStringList wkst;
-            int dayOffsets[7] = { 0 };
 
-            if (rule->byDay().count() > 1 && !rule->wkst().isEmpty())
-            {
-                wkst = m_wkst[rule->wkst()];
-                QList<quint16> dayNums;
-
-                for (const QString& day : rule->byDay())
-                {
-                    dayNums << wkst.indexOf(day);
-                }
-
-                std::sort(dayNums.begin(), dayNums.end());
-
-                for (int i = 0; i < dayNums.count(); i++)
-                {
-                    if (i == dayNums.count() - 1)
-                    {
-                        dayOffsets[dayNums[i]] = 7 - dayNums[i] + 7 * (rule->interval() - 1);
-                    }
-                    else
-                    {
-                        dayOffsets[dayNums[i]] = dayNums[i + 1] - dayNums[i];
-                    }
-                }
-            }
-
-            QStringList days = rule->byDay();
+        buffers.swap(next);
+    }
 
-            if (days.isEmpty())
-            {
-                days << m_weekDays[start.date().dayOfWeek()];
-            }
+    if (buffers.empty())
+    {
+        return result;
+    }
 
-            while (current <= endDate)
-            {
-                if (days.contains(m_weekDays[current.date().dayOfWeek()]) && (start.daysTo(current) / 7) % rule->interval() == 0)
-                {
-                    addEvent(rule, current);
-                    current = current.addDays(wkst.isEmpty() ? 7 * rule->interval() : dayOffsets[wkst.indexOf(m_weekDays[current.date().dayOfWeek()])]);
-                }
-                else if (days.contains(m_weekDays[current.date().dayOfWeek()]) && (start.daysTo(current) / 7) % rule->interval() != 0)
-                {
-                    current = current.addDays(wkst.isEmpty() ? 7 : dayOffsets[wkst.indexOf(m_weekDays[current.date().dayOfWeek()])]);
-                }
-                else
-                {
-                    current = current.addDays(1);
-                }
-            }
-            break;
-        }
-        case QiCalRule::RR_MONTHLY:
+    for (const RuleOccurrence& occurrence : buffers.front())
+    {
+        const QDateTime dtStart = occurrence.rule->calEvent()->dtStart();
+        const QSharedPointer<const QiCalZoneTable> zone = occurrence.rule->calEvent()->zone();
+        if (!zone.isNull() && dtStart.timeSpec() == Qt::OffsetFromUTC)
         {
-            QDateTime endDate(calcEnd(rule, start.addMonths(rule->count() * rule->interval() - 1)));
-            QDateTime current = from;
-
-            QList<QDate> dates;
-            quint8 month = 0;
-            while (current <= endDate)
-            {
-                if ( ((current.date().month() - start.date().month()) % rule->interval() != 0)
-                        || (!rule->byMonth().isEmpty() && !rule->byMonth().contains(current.date().month())) )
-                {
-                    current = current.addMonths(1);
-                    continue;
-                }
-
-                if (month != current.date().month())
-                {
-                    dates = dayList(rule, current.date());
-                    month = current.date().month();
-                }
-
-                if (dates.contains(current.date()))
-                {
-                    addEvent(rule, current);
-                    dates.removeOne(current.date());
-                }
-
-                if (dates.isEmpty() && endDate.date().month() < month + 1)
-                {
-                    break;
-                }
-
-                current = current.addDays(1);
-            }
-            break;
+            addEvent(occurrence.rule, QDateTime::fromMSecsSinceEpoch(occurrence.start, Qt::OffsetFromUTC, zone->offsetAtUtc(occurrence.start / 1000)));
+            continue;
         }
-        case QiCalRule::RR_YEARLY:
-        {
-            QDateTime endDate(calcEnd(rule, start.addYears(rule->count() * rule->interval() - 1)));
-            QDateTime current = from;
-            quint8 month = 0;
-            QList<QDate> dates;
-
-            while (current <= endDate)
-            {
-                if ((current.date().year() - start.date().year()) % rule->interval() != 0)
-                {
-                    current = current.addYears(1);
-                    continue;
-                }
-
-                QList<qint32> weeks = rule->byWeekNo();
-                std::sort(weeks.begin(), weeks.end());
-
-                if (month != current.date().month())
-                {
-                    dates = dayList(rule, current.date());
-                    month = current.date().month();
-                }
-
-                // by weekno
-                if (weeks.contains(current.date().weekNumber()) && dates.contains(current.date()))
-                {
-                    addEvent(rule, current);
-
-                    if (rule->byDay().count() > 1)
-                    {
-                        current = current.addDays(1);
-                    }
-                    else if (weeks.count() > 1 && weeks.indexOf(current.date().weekNumber()) < weeks.count() - 1)
-                    {
-                        current = current.addDays((weeks[weeks.indexOf(current.date().weekNumber()) + 1] - current.date().weekNumber()) * 7);
-                    }
-                    else
-                    {
-                        current = current.addYears(1);
-                    }
-
-                    continue;
-                }
-
-                QList<qint32> months = rule->byMonth();
-                std::sort(months.begin(), months.end());
-
-                // by month
-                if (months.contains(current.date().month()) && dates.contains(current.date()))
-                {
-                    addEvent(rule, current);
-
-                    if (rule->byDay().count() > 1 || rule->byMonthDay().count() > 1)
-                    {
-                        current = current.addDays(1);
-                    }
-                    else if (months.count() > 1 && months.indexOf(current.date().month()) < months.count() - 1)
-                    {
-                        current.setDate(QDate(current.date().year(), current.date().month() + 1, 1));
-                    }
-                    else
-                    {
-                        current = current.addYears(1);
-                    }
-
-                    continue;
-                }
-
-                QDate eventDate = rule->calEvent()->dtStart().date();
-                QDate currentEventDate(current.date().year(), eventDate.month(), eventDate.day());
-
-                if (current.date() <= currentEventDate && currentEventDate <= endDate.date())
-                {
-                    QDateTime eventDateTime = rule->calEvent()->dtStart();
-                    eventDateTime.setDate(currentEventDate);
-                    addEvent(rule, eventDateTime);
-                }
 
-                current = current.addYears(1);
-            }
-
-            break;
-        }
-        default:
-            break;
-        }
+        addEvent(occurrence.rule, dtStart.timeSpec() == Qt::TimeZone ? QDateTime::fromMSecsSinceEpoch(occurrence.start, dtStart.timeZone())
+                                                                     : QDateTime::fromMSecsSinceEpoch(occurrence.start, dtStart.timeSpec(), dtStart.offsetFromUtc()));
     }
 
     return result;
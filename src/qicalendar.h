@@ -5,12 +5,24 @@
 #include <QString>
 #include <QStack>
 #include <QHash>
-
-#include <functional>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
 
 #include "qicalcalendar.h"
+#include "qicalconflicts.h"
 #include "qicalendar_global.h"
 
+class QiCalSnapshot;
+
+struct QiCalChangeReport
+{
+    QList<QiCalEvent*> added;
+    QList<QiCalEvent*> updated;
+    QStringList removed;
+    QStringList timeZones;
+};
+
 class QICALENDARSHARED_EXPORT QiCalendarParser
 {
 
@@ -18,10 +30,23 @@ public:
     QiCalendarParser();
 
     bool parseFile(const QString& file);
+    bool loadFile(const QString& file, const QString& snapshotFile);
+    bool reloadFile(const QString& file, QiCalChangeReport* report = nullptr);
     QiCalCalendar* calendar();
+    const QiCalSnapshot* snapshot() const;
+    QiCalCalendar* takeCalendar();
     QList<QiCalEvent*> eventsFrom(const QDateTime& from);
     QList<QiCalEvent*> eventsRange(const QDateTime& from, const QDateTime& to);
 
+    int expansionThreads() const;
+    void setExpansionThreads(int threads);
+
+    QList<QiCalConflict> conflictsRange(const QDateTime& from, const QDateTime& to,
+                                        const QiCalConflictDetector& detector = QiCalConflictDetector());
+
+    static QList<QiCalConflict> conflictsRange(const QList<QiCalendarParser*>& parsers, const QDateTime& from, const QDateTime& to,
+                                               const QiCalConflictDetector& detector = QiCalConflictDetector());
+
 private:
     enum State
     {
@@ -35,44 +60,76 @@ private:
         CAL_RRULE
     };
 
+    typedef void (*StateHandler)(QiCalendarParser* parser);
+    typedef void (*ValueHandler)(QiCalendarParser* parser, const QString& value);
+
+    struct Grammar
+    {
+        QHash<State, QHash<QString, ValueHandler> > keyWords;
+        QHash<State, QHash<QString, StateHandler> > states;
+        QHash<QString, ValueHandler> rRules;
+        QHash<QString, QiCalRule::Freq> freqs;
+        QHash<QString, QiCalAlarm::Action> alActions;
+        QHash<QString, QiCalEvent::Status> evtStatuses;
+        QHash<QString, QiCalEvent::Transp> evtTransps;
+        QHash<QString, State> stateMap;
+    };
+
+    static const Grammar& grammar();
+
+    bool readFile(const QString& filePath, QiCalChangeReport* report);
+    void parseLine(const QString& line);
+    void updateEvent(QiCalEvent* target, QiCalEvent* source);
+
     void parseString(const QString& propertyName, const QString& value);
     void parseInt(const QString& propertyName, const QString& value);
+    void parseUtcOffset(const QString& propertyName, const QString& value);
     void parseDate(const QString& propertyName, const QString& value);
+    void parseDateList(const QString& propertyName, const QString& value);
     void parseRule(const QString& value);
     void parseAlarmAction(const QString& value);
+    void parseAlarmTrigger(const QString& value);
     void parseEvtStatus(const QString& value);
     void parseEvtTransp(const QString& value);
 
     void setObjectValue(const QString& propertyName, const QVariant& value);
 
+    ValueHandler keyWord(const QString& name) const;
     void switchState(const QString& state);
     void endState(const QString& state);
     QObject *currentObject();
 
+    QSharedPointer<const QiCalZoneTable> resolveZone(const QString& tzId);
+
+    static QDateTime toDateTime(const QString& value);
+
     QList<QiCalEvent*> genRuleEvents(const QDateTime& from, const QDateTime& to);
 
-    QHash<State, QHash<QString, std::function<void(const QString&)> > > m_keyWords;
-    QHash<State, QHash<QString, std::function<void()> > > m_states;
-    QHash<QString, std::function<void(const QString&)> > m_rRules;
-    QHash<QString, QiCalAlarm::Action> m_alActions;
-    QHash<QString, QiCalEvent::Status> m_evtStatuses;
-    QHash<QString, QiCalEvent::Transp> m_evtTransps;
-    QHash<QString, State> m_stateMap;
-    QHash<int, QString> m_weekDays;
-    QHash<QString, QStringList> m_wkst;
+    const Grammar* m_grammar;
     QStack<State> m_state;
+    QHash<QString, QString> m_params;
+    QHash<QString, QSharedPointer<const QiCalRulePlan> > m_rulePlans;
+    QHash<QString, QSharedPointer<const QiCalZoneTable> > m_zones;
+    QHash<QByteArray, QiCalEvent*> m_eventBlocks;
+    QHash<QByteArray, QiCalTimeZone*> m_zoneBlocks;
+    QSet<QiCalTimeZone*> m_retiredZones;
+    QSharedPointer<QiCalSnapshot> m_snapshot;
 
     QiCalCalendar* m_calendar;
+    int m_expansionThreads;
 };
 
-#define VCAL_BEGIN std::bind(&QiCalendarParser::switchState, this, _1)
-#define VCAL_END [&](const QString& val){ endState(val); }
-#define VCAL_STRING(prop) [&](const QString& val){ parseString(prop, val); }
-#define VCAL_INTEGER(prop) [&](const QString& val){ parseInt(prop, val); }
-#define VCAL_DATETIME(prop) [&](const QString& val){ parseDate(prop, val); }
-#define VCAL_TZRULE [&](const QString& val){ parseRule(val); }
-#define VCAL_ALARMACTION [&](const QString& val){ parseAlarmAction(val); }
-#define VCAL_EVTSTATUS [&](const QString& val){ parseEvtStatus(val); }
-#define VCAL_EVTTRANSP [&](const QString& val){ parseEvtTransp(val); }
+#define VCAL_BEGIN [](QiCalendarParser* parser, const QString& val){ parser->switchState(val); }
+#define VCAL_END [](QiCalendarParser* parser, const QString& val){ parser->endState(val); }
+#define VCAL_STRING(prop) [](QiCalendarParser* parser, const QString& val){ parser->parseString(prop, val); }
+#define VCAL_INTEGER(prop) [](QiCalendarParser* parser, const QString& val){ parser->parseInt(prop, val); }
+#define VCAL_UTCOFFSET(prop) [](QiCalendarParser* parser, const QString& val){ parser->parseUtcOffset(prop, val); }
+#define VCAL_DATETIME(prop) [](QiCalendarParser* parser, const QString& val){ parser->parseDate(prop, val); }
+#define VCAL_DATELIST(prop) [](QiCalendarParser* parser, const QString& val){ parser->parseDateList(prop, val); }
+#define VCAL_TZRULE [](QiCalendarParser* parser, const QString& val){ parser->parseRule(val); }
+#define VCAL_ALARMACTION [](QiCalendarParser* parser, const QString& val){ parser->parseAlarmAction(val); }
+#define VCAL_ALARMTRIGGER [](QiCalendarParser* parser, const QString& val){ parser->parseAlarmTrigger(val); }
+#define VCAL_EVTSTATUS [](QiCalendarParser* parser, const QString& val){ parser->parseEvtStatus(val); }
+#define VCAL_EVTTRANSP [](QiCalendarParser* parser, const QString& val){ parser->parseEvtTransp(val); }
 
 #endif // QICALENDAR_H
@@ -1,8 +1,27 @@
 #include "qicalevent.h"
 
+#include <algorithm>
+
+namespace
+{
+
+QVector<qint64> sortedDates(QVector<qint64> dates)
+{
+    std::sort(dates.begin(), dates.end());
+    dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+
+    return dates;
+}
+
+}
+
 QiCalEvent::QiCalEvent(QObject *parent) : QObject(parent),
     m_status(STAT_TENTATIVE),
-    m_transp(TRANS_OPAQUE)
+    m_transp(TRANS_OPAQUE),
+    m_sequence(0),
+    m_allDay(false),
+    m_rule(nullptr),
+    m_masterEvent(nullptr)
 {
 }
 
@@ -116,6 +135,28 @@ void QiCalEvent::setTransp(const Transp &transp)
     emit transpChanged();
 }
 
+int QiCalEvent::sequence() const
+{
+    return m_sequence;
+}
+
+void QiCalEvent::setSequence(int sequence)
+{
+    m_sequence = sequence;
+    emit sequenceChanged();
+}
+
+bool QiCalEvent::isAllDay() const
+{
+    return m_allDay;
+}
+
+void QiCalEvent::setAllDay(bool allDay)
+{
+    m_allDay = allDay;
+    emit allDayChanged();
+}
+
 QList<QiCalAlarm *> QiCalEvent::alarms() const
 {
     return m_alarms;
@@ -169,13 +210,63 @@ QiCalRule *QiCalEvent::rule() const
 
 void QiCalEvent::setRule(QiCalRule *rule)
 {
-    rule->setParent(this);
+    if (rule != nullptr)
+    {
+        rule->setParent(this);
+    }
     m_rule = rule;
     emit ruleChanged();
 }
 
+QiCalEvent *QiCalEvent::masterEvent() const
+{
+    return m_masterEvent;
+}
+
+void QiCalEvent::setMasterEvent(QiCalEvent *masterEvent)
+{
+    m_masterEvent = masterEvent;
+    emit masterEventChanged();
+}
+
+QVector<qint64> QiCalEvent::exDates() const
+{
+    return m_exDates;
+}
+
+void QiCalEvent::setExDates(const QVector<qint64> &exDates)
+{
+    m_exDates = sortedDates(exDates);
+    emit exDatesChanged();
+}
+
+QVector<qint64> QiCalEvent::rDates() const
+{
+    return m_rDates;
+}
+
+void QiCalEvent::setRDates(const QVector<qint64> &rDates)
+{
+    m_rDates = sortedDates(rDates);
+    emit rDatesChanged();
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalEvent::zone() const
+{
+    return m_zone;
+}
+
+void QiCalEvent::setZone(const QSharedPointer<const QiCalZoneTable> &zone)
+{
+    m_zone = zone;
+    emit zoneChanged();
+}
+
 QiCalAlarm::QiCalAlarm(QObject *parent) : QObject(parent),
-    m_action(ACT_AUDIO)
+    m_action(ACT_AUDIO),
+    m_triggerRelated(REL_START),
+    m_triggerOffset(0),
+    m_triggerValid(false)
 {
 }
 
@@ -209,5 +300,172 @@ QString QiCalAlarm::trigger() const
 void QiCalAlarm::setTrigger(const QString &trigger)
 {
     m_trigger = trigger;
+    m_triggerOffset = parseDuration(trigger, &m_triggerValid);
+    m_triggerTime = QDateTime();
+
+    if (!m_triggerValid)
+    {
+        QString time = trigger;
+        bool utc = time.endsWith('Z');
+        if (utc)
+        {
+            time.chop(1);
+        }
+
+        m_triggerTime = QDateTime::fromString(time, "yyyyMMddThhmmss");
+        if (utc)
+        {
+            m_triggerTime.setTimeSpec(Qt::UTC);
+        }
+        m_triggerValid = m_triggerTime.isValid();
+    }
+
     emit triggerChanged();
 }
+
+QiCalAlarm::Related QiCalAlarm::triggerRelated() const
+{
+    return m_triggerRelated;
+}
+
+void QiCalAlarm::setTriggerRelated(const Related &related)
+{
+    m_triggerRelated = related;
+    emit triggerChanged();
+}
+
+qint64 QiCalAlarm::triggerOffset() const
+{
+    return m_triggerOffset;
+}
+
+QDateTime QiCalAlarm::triggerTime() const
+{
+    return m_triggerTime;
+}
+
+bool QiCalAlarm::isTriggerAbsolute() const
+{
+    return m_triggerTime.isValid();
+}
+
+bool QiCalAlarm::isTriggerValid() const
+{
+    return m_triggerValid;
+}
+
+QDateTime QiCalAlarm::fireTime(const QDateTime &occurrenceStart, const QDateTime &occurrenceEnd) const
+{
+    if (!m_triggerValid)
+    {
+        return QDateTime();
+    }
+
+    if (isTriggerAbsolute())
+    {
+        return m_triggerTime;
+    }
+
+    if (m_triggerRelated == REL_END && occurrenceEnd.isValid())
+    {
+        return occurrenceEnd.addSecs(m_triggerOffset);
+    }
+
+    return occurrenceStart.addSecs(m_triggerOffset);
+}
+
+qint64 QiCalAlarm::parseDuration(const QString &duration, bool *ok)
+{
+    const auto fail = [ok]() -> qint64 {
+        if (ok)
+        {
+            *ok = false;
+        }
+        return 0;
+    };
+
+    int pos = 0;
+    qint64 sign = 1;
+
+    if (pos < duration.size() && (duration[pos] == '+' || duration[pos] == '-'))
+    {
+        sign = duration[pos] == '-' ? -1 : 1;
+        pos++;
+    }
+
+    if (pos >= duration.size() || duration[pos] != 'P')
+    {
+        return fail();
+    }
+    pos++;
+
+    qint64 seconds = 0;
+    qint64 num = 0;
+    bool hasNum = false;
+    bool inTime = false;
+    bool hasUnit = false;
+
+    for (; pos < duration.size(); pos++)
+    {
+        QChar c = duration[pos];
+
+        if (c.isDigit())
+        {
+            num = num * 10 + c.digitValue();
+            hasNum = true;
+            continue;
+        }
+
+        if (c == 'T' && !hasNum && !inTime)
+        {
+            inTime = true;
+            continue;
+        }
+
+        if (!hasNum)
+        {
+            return fail();
+        }
+
+        switch (c.toLatin1()) {
+        case 'W':
+            seconds += num * 604800;
+            break;
+        case 'D':
+            seconds += num * 86400;
+            break;
+        case 'H':
+            seconds += num * 3600;
+            break;
+        case 'M':
+            seconds += num * 60;
+            break;
+        case 'S':
+            seconds += num;
+            break;
+        default:
+            return fail();
+        }
+
+        if (inTime != (c == 'H' || c == 'M' || c == 'S'))
+        {
+            return fail();
+        }
+
+        num = 0;
+        hasNum = false;
+        hasUnit = true;
+    }
+
+    if (hasNum || !hasUnit)
+    {
+        return fail();
+    }
+
+    if (ok)
+    {
+        *ok = true;
+    }
+
+    return sign * seconds;
+}
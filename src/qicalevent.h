@@ -4,8 +4,11 @@
 #include <QObject>
 #include <QDateTime>
 #include <QString>
+#include <QVector>
+#include <QSharedPointer>
 
 #include "qicalrule.h"
+#include "qicalzonetable.h"
 
 class QiCalAlarm : public QObject
 {
@@ -13,6 +16,9 @@ class QiCalAlarm : public QObject
     Q_PROPERTY(Action action READ action WRITE setAction NOTIFY actionChanged)
     Q_PROPERTY(QString description READ description WRITE setDescription NOTIFY descriptionChanged)
     Q_PROPERTY(QString trigger READ trigger WRITE setTrigger NOTIFY triggerChanged)
+    Q_PROPERTY(Related triggerRelated READ triggerRelated WRITE setTriggerRelated NOTIFY triggerChanged)
+    Q_PROPERTY(qint64 triggerOffset READ triggerOffset NOTIFY triggerChanged)
+    Q_PROPERTY(QDateTime triggerTime READ triggerTime NOTIFY triggerChanged)
 
 public:
     enum Action
@@ -23,6 +29,13 @@ public:
     };
     Q_ENUM(Action)
 
+    enum Related
+    {
+        REL_START = 0,
+        REL_END
+    };
+    Q_ENUM(Related)
+
     explicit QiCalAlarm(QObject *parent = nullptr);
 
     Action action() const;
@@ -34,6 +47,18 @@ public:
     QString trigger() const;
     void setTrigger(const QString &trigger);
 
+    Related triggerRelated() const;
+    void setTriggerRelated(const Related &related);
+
+    qint64 triggerOffset() const;
+    QDateTime triggerTime() const;
+    bool isTriggerAbsolute() const;
+    bool isTriggerValid() const;
+
+    QDateTime fireTime(const QDateTime& occurrenceStart, const QDateTime& occurrenceEnd) const;
+
+    static qint64 parseDuration(const QString& duration, bool* ok = nullptr);
+
 signals:
     void actionChanged();
     void descriptionChanged();
@@ -43,6 +68,10 @@ private:
     Action m_action;
     QString m_description;
     QString m_trigger;
+    Related m_triggerRelated;
+    qint64 m_triggerOffset;
+    QDateTime m_triggerTime;
+    bool m_triggerValid;
 };
 
 class QiCalEvent : public QObject
@@ -59,8 +88,13 @@ class QiCalEvent : public QObject
     Q_PROPERTY(QString location READ location WRITE setLocation NOTIFY locationChanged)
     Q_PROPERTY(Status status READ status WRITE setStatus NOTIFY statusChanged)
     Q_PROPERTY(Transp transp READ transp WRITE setTransp NOTIFY transpChanged)
+    Q_PROPERTY(int sequence READ sequence WRITE setSequence NOTIFY sequenceChanged)
+    Q_PROPERTY(bool allDay READ isAllDay WRITE setAllDay NOTIFY allDayChanged)
     Q_PROPERTY(QList<QiCalAlarm*> alarms READ alarms NOTIFY alarmsChanged)
     Q_PROPERTY(QiCalRule* rule READ rule WRITE setRule NOTIFY ruleChanged)
+    Q_PROPERTY(QiCalEvent* masterEvent READ masterEvent WRITE setMasterEvent NOTIFY masterEventChanged)
+    Q_PROPERTY(QVector<qint64> exDates READ exDates WRITE setExDates NOTIFY exDatesChanged)
+    Q_PROPERTY(QVector<qint64> rDates READ rDates WRITE setRDates NOTIFY rDatesChanged)
 public:
     enum Status
     {
@@ -109,6 +143,12 @@ public:
     Transp transp() const;
     void setTransp(const Transp &transp);
 
+    int sequence() const;
+    void setSequence(int sequence);
+
+    bool isAllDay() const;
+    void setAllDay(bool allDay);
+
     QList<QiCalAlarm *> alarms() const;
     void addAlarm(QiCalAlarm* alarm);
     void removeAlarm(QiCalAlarm* alarm);
@@ -122,6 +162,18 @@ public:
     QiCalRule *rule() const;
     void setRule(QiCalRule *rule);
 
+    QiCalEvent *masterEvent() const;
+    void setMasterEvent(QiCalEvent *masterEvent);
+
+    QVector<qint64> exDates() const;
+    void setExDates(const QVector<qint64> &exDates);
+
+    QVector<qint64> rDates() const;
+    void setRDates(const QVector<qint64> &rDates);
+
+    QSharedPointer<const QiCalZoneTable> zone() const;
+    void setZone(const QSharedPointer<const QiCalZoneTable> &zone);
+
 signals:
     void dtStartChanged();
     void dtEndChanged();
@@ -134,8 +186,14 @@ signals:
     void locationChanged();
     void statusChanged();
     void transpChanged();
+    void sequenceChanged();
+    void allDayChanged();
     void alarmsChanged();
     void ruleChanged();
+    void masterEventChanged();
+    void exDatesChanged();
+    void rDatesChanged();
+    void zoneChanged();
 
 private:
     QDateTime m_dtStart;
@@ -149,8 +207,14 @@ private:
     QString m_location;
     Status m_status;
     Transp m_transp;
+    int m_sequence;
+    bool m_allDay;
     QList<QiCalAlarm*> m_alarms;
     QiCalRule* m_rule;
+    QiCalEvent* m_masterEvent;
+    QVector<qint64> m_exDates;
+    QVector<qint64> m_rDates;
+    QSharedPointer<const QiCalZoneTable> m_zone;
 };
 
 #endif // QICALEVENT_H
@@ -0,0 +1,785 @@
+#include "qicaljcalwriter.h"
+#include "qicalutil_p.h"
+
+#include <cstring>
+
+using namespace QiCalUtil;
+
+namespace
+{
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+}
+
+QiCalJCalWriter::QiCalJCalWriter(QIODevice *device) :
+    m_device(device),
+    m_separator(false),
+    m_ok(true)
+{
+    m_buffer.reserve(FLUSH_SIZE);
+}
+
+QIODevice *QiCalJCalWriter::device() const
+{
+    return m_device;
+}
+
+void QiCalJCalWriter::setDevice(QIODevice *device)
+{
+    m_device = device;
+}
+
+bool QiCalJCalWriter::writeCalendar(const QiCalCalendar *calendar)
+{
+    if (calendar == nullptr)
+    {
+        return false;
+    }
+
+    beginCalendar(calendar);
+
+    for (const QiCalEvent* event : calendar->events())
+    {
+        writeEvent(event);
+    }
+
+    endCalendar();
+
+    return flush();
+}
+
+bool QiCalJCalWriter::writeOccurrences(const QiCalCalendar *calendar, const QList<QiCalEvent *> &occurrences)
+{
+    if (calendar == nullptr)
+    {
+        return false;
+    }
+
+    beginCalendar(calendar);
+
+    for (const QiCalEvent* event : occurrences)
+    {
+        writeEvent(event);
+    }
+
+    endCalendar();
+
+    return flush();
+}
+
+const QByteArray &QiCalJCalWriter::buffer() const
+{
+    return m_buffer;
+}
+
+void QiCalJCalWriter::clear()
+{
+    m_buffer.resize(0);
+    m_separator = false;
+    m_ok = true;
+}
+
+bool QiCalJCalWriter::flush()
+{
+    if (m_device == nullptr || m_buffer.isEmpty())
+    {
+        return m_ok;
+    }
+
+    if (m_device->write(m_buffer.constData(), m_buffer.size()) != m_buffer.size())
+    {
+        m_ok = false;
+    }
+    m_buffer.resize(0);
+
+    return m_ok;
+}
+
+void QiCalJCalWriter::beginCalendar(const QiCalCalendar *calendar)
+{
+    m_ok = true;
+    m_separator = false;
+    m_tzIds.clear();
+
+    beginArray();
+    value("vcalendar");
+    beginArray();
+
+    if (calendar->version().isEmpty())
+    {
+        writeText("version", "2.0");
+    }
+    else
+    {
+        writeText("version", calendar->version());
+    }
+
+    if (calendar->prodId().isEmpty())
+    {
+        writeText("prodid", "-//qiCalendar//qiCalendar//EN");
+    }
+    else
+    {
+        writeText("prodid", calendar->prodId());
+    }
+
+    if (!calendar->method().isEmpty())
+    {
+        writeText("method", calendar->method());
+    }
+
+    endArray();
+    beginArray();
+
+    for (const QiCalTimeZone* timeZone : calendar->timeZones())
+    {
+        m_tzIds.insert(timeZone->tzId());
+        writeTimeZone(timeZone);
+    }
+}
+
+void QiCalJCalWriter::endCalendar()
+{
+    endArray();
+    endArray();
+    m_separator = false;
+}
+
+void QiCalJCalWriter::writeTimeZone(const QiCalTimeZone *timeZone)
+{
+    beginComponent("vtimezone");
+    writeText("tzid", timeZone->tzId());
+    endArray();
+    beginArray();
+
+    for (const QiCalTzInfo* info : timeZone->observances())
+    {
+        writeTzInfo(info->isDayLight() ? "daylight" : "standard", info);
+    }
+
+    endComponent();
+}
+
+void QiCalJCalWriter::writeTzInfo(const char *name, const QiCalTzInfo *info)
+{
+    beginComponent(name);
+
+    if (info->dtStart().isValid())
+    {
+        beginProperty("dtstart", nullptr, "date-time");
+        stamp(localSeconds(info->dtStart()), false);
+        endProperty();
+    }
+
+    writeUtcOffset("tzoffsetfrom", info->offsetFrom());
+    writeUtcOffset("tzoffsetto", info->offsetTo());
+
+    if (!info->tzName().isEmpty())
+    {
+        writeText("tzname", info->tzName());
+    }
+
+    if (info->rule() != nullptr)
+    {
+        writeRule(info->rule());
+    }
+
+    if (!info->rDates().isEmpty())
+    {
+        beginProperty("rdate", nullptr, "date-time");
+        for (qint64 rDate : info->rDates())
+        {
+            stamp(floorDiv(rDate, 1000), false);
+        }
+        endProperty();
+    }
+
+    endArray();
+    beginArray();
+    endComponent();
+}
+
+void QiCalJCalWriter::writeEvent(const QiCalEvent *event)
+{
+    const QiCalEvent* master = event->masterEvent();
+
+    beginComponent("vevent");
+
+    writeText("uid", event->uid());
+    writeDateTime("dtstamp", event->dtStamp(), nullptr);
+    writeDateTime("dtstart", event->dtStart(), event);
+    writeDateTime("dtend", event->dtEnd(), event);
+
+    if (master != nullptr)
+    {
+        writeDateTime("recurrence-id", event->dtStart(), event);
+    }
+
+    writeDateTime("created", event->created(), nullptr);
+    writeDateTime("last-modified", event->lastModified(), nullptr);
+
+    if (!event->summary().isEmpty())
+    {
+        writeText("summary", event->summary());
+    }
+
+    if (!event->description().isEmpty())
+    {
+        writeText("description", event->description());
+    }
+
+    if (!event->location().isEmpty())
+    {
+        writeText("location", event->location());
+    }
+
+    writeText("status", STATUS_NAMES[event->status()]);
+    writeText("transp", TRANSP_NAMES[event->transp()]);
+
+    if (event->sequence() > 0)
+    {
+        beginProperty("sequence", nullptr, "integer");
+        value(qint64(event->sequence()));
+        endProperty();
+    }
+
+    if (master == nullptr)
+    {
+        if (event->rule() != nullptr)
+        {
+            writeRule(event->rule());
+        }
+
+        writeDateList("rdate", event->rDates(), event);
+        writeDateList("exdate", event->exDates(), event);
+    }
+
+    endArray();
+    beginArray();
+
+    for (const QiCalAlarm* alarm : (master != nullptr ? master : event)->alarms())
+    {
+        writeAlarm(alarm);
+    }
+
+    endComponent();
+}
+
+void QiCalJCalWriter::writeAlarm(const QiCalAlarm *alarm)
+{
+    beginComponent("valarm");
+    writeText("action", ACTION_NAMES[alarm->action()]);
+
+    if (!alarm->description().isEmpty())
+    {
+        writeText("description", alarm->description());
+    }
+
+    if (alarm->isTriggerAbsolute())
+    {
+        writeDateTime("trigger", alarm->triggerTime(), nullptr);
+    }
+    else if (alarm->isTriggerValid())
+    {
+        beginArray();
+        value("trigger");
+        beginObject();
+        if (alarm->triggerRelated() == QiCalAlarm::REL_END)
+        {
+            key("related");
+            value("END");
+        }
+        endObject();
+        value("duration");
+        value(alarm->trigger());
+        endProperty();
+    }
+
+    endArray();
+    beginArray();
+    endComponent();
+}
+
+void QiCalJCalWriter::writeRule(const QiCalRule *rule)
+{
+    beginProperty("rrule", nullptr, "recur");
+    beginObject();
+
+    key("freq");
+    value(FREQ_NAMES[rule->freq()]);
+
+    if (rule->until().isValid())
+    {
+        key("until");
+        if (rule->until().timeSpec() == Qt::LocalTime)
+        {
+            stamp(localSeconds(rule->until()), false);
+        }
+        else
+        {
+            stamp(floorDiv(rule->until().toMSecsSinceEpoch(), 1000), true);
+        }
+    }
+
+    if (rule->count() > 0)
+    {
+        key("count");
+        value(qint64(rule->count()));
+    }
+
+    if (rule->interval() > 1)
+    {
+        key("interval");
+        value(qint64(rule->interval()));
+    }
+
+    intList("bysecond", rule->bySecond());
+    intList("byminute", rule->byMinute());
+    intList("byhour", rule->byHour());
+
+    const QList<QString> byDay = rule->byDay();
+    if (!byDay.isEmpty() && !(byDay.size() == 1 && byDay.first().isEmpty()))
+    {
+        key("byday");
+        if (byDay.size() > 1)
+        {
+            beginArray();
+        }
+        for (const QString& day : byDay)
+        {
+            value(day);
+        }
+        if (byDay.size() > 1)
+        {
+            endArray();
+        }
+    }
+
+    intList("bymonthday", rule->byMonthDay());
+    intList("byyearday", rule->byYearDay());
+    intList("byweekno", rule->byWeekNo());
+    intList("bymonth", rule->byMonth());
+    intList("bysetpos", rule->bySetPos());
+
+    if (!rule->wkst().isEmpty())
+    {
+        key("wkst");
+        value(rule->wkst());
+    }
+
+    endObject();
+    endProperty();
+}
+
+void QiCalJCalWriter::writeText(const char *name, const QString &text)
+{
+    beginProperty(name, nullptr, "text");
+    value(text);
+    endProperty();
+}
+
+void QiCalJCalWriter::writeText(const char *name, const char *text)
+{
+    beginProperty(name, nullptr, "text");
+    value(text);
+    endProperty();
+}
+
+void QiCalJCalWriter::writeDateTime(const char *name, const QDateTime &dateTime, const QiCalEvent *event)
+{
+    if (!dateTime.isValid())
+    {
+        return;
+    }
+
+    if (event != nullptr && event->isAllDay())
+    {
+        beginProperty(name, nullptr, "date");
+        date(dateTime.date());
+        endProperty();
+        return;
+    }
+
+    const QString* tzId = dateTime.timeSpec() == Qt::OffsetFromUTC ? zoneId(event) : nullptr;
+    beginProperty(name, tzId, "date-time");
+
+    if (tzId != nullptr)
+    {
+        stamp(floorDiv(dateTime.toMSecsSinceEpoch(), 1000) + dateTime.offsetFromUtc(), false);
+    }
+    else if (dateTime.timeSpec() == Qt::LocalTime)
+    {
+        stamp(localSeconds(dateTime), false);
+    }
+    else
+    {
+        stamp(floorDiv(dateTime.toMSecsSinceEpoch(), 1000), true);
+    }
+
+    endProperty();
+}
+
+void QiCalJCalWriter::writeDateList(const char *name, const QVector<qint64> &dates, const QiCalEvent *event)
+{
+    if (dates.isEmpty())
+    {
+        return;
+    }
+
+    if (event->isAllDay())
+    {
+        beginProperty(name, nullptr, "date");
+        for (qint64 msecs : dates)
+        {
+            const qint64 wall = event->zone().isNull() ? localSeconds(QDateTime::fromMSecsSinceEpoch(msecs)) : event->zone()->toLocal(floorDiv(msecs, 1000));
+            date(QDate::fromJulianDay(floorDiv(wall, SECS_PER_DAY) + EPOCH_JULIAN_DAY));
+        }
+        endProperty();
+        return;
+    }
+
+    const QString* tzId = zoneId(event);
+    beginProperty(name, tzId, "date-time");
+
+    for (qint64 date : dates)
+    {
+        const qint64 utc = floorDiv(date, 1000);
+        if (tzId != nullptr)
+        {
+            stamp(event->zone()->toLocal(utc), false);
+        }
+        else
+        {
+            stamp(utc, true);
+        }
+    }
+
+    endProperty();
+}
+
+void QiCalJCalWriter::writeUtcOffset(const char *name, int offset)
+{
+    char text[12];
+    char* out = text;
+    const int seconds = qAbs(offset);
+
+    *out++ = '"';
+    *out++ = offset < 0 ? '-' : '+';
+    out = putDigits(out, seconds / 3600, 2);
+    *out++ = ':';
+    out = putDigits(out, seconds / 60 % 60, 2);
+    if (seconds % 60 != 0)
+    {
+        *out++ = ':';
+        out = putDigits(out, seconds % 60, 2);
+    }
+    *out++ = '"';
+
+    beginProperty(name, nullptr, "utc-offset");
+    separate();
+    append(text, int(out - text));
+    m_separator = true;
+    endProperty();
+}
+
+const QString *QiCalJCalWriter::zoneId(const QiCalEvent *event) const
+{
+    if (event == nullptr || event->zone().isNull())
+    {
+        return nullptr;
+    }
+
+    auto found = m_tzIds.constFind(event->zone()->tzId());
+
+    return found != m_tzIds.constEnd() ? &*found : nullptr;
+}
+
+void QiCalJCalWriter::beginComponent(const char *name)
+{
+    beginArray();
+    value(name);
+    beginArray();
+}
+
+void QiCalJCalWriter::endComponent()
+{
+    endArray();
+    endArray();
+
+    if (m_device != nullptr && m_buffer.size() >= FLUSH_SIZE)
+    {
+        flush();
+    }
+}
+
+void QiCalJCalWriter::beginProperty(const char *name, const QString *tzId, const char *type)
+{
+    beginArray();
+    value(name);
+    beginObject();
+    if (tzId != nullptr)
+    {
+        key("tzid");
+        value(*tzId);
+    }
+    endObject();
+    value(type);
+}
+
+void QiCalJCalWriter::endProperty()
+{
+    endArray();
+
+    if (m_device != nullptr && m_buffer.size() >= FLUSH_SIZE)
+    {
+        flush();
+    }
+}
+
+void QiCalJCalWriter::beginArray()
+{
+    separate();
+    append("[", 1);
+    m_separator = false;
+}
+
+void QiCalJCalWriter::endArray()
+{
+    append("]", 1);
+    m_separator = true;
+}
+
+void QiCalJCalWriter::beginObject()
+{
+    separate();
+    append("{", 1);
+    m_separator = false;
+}
+
+void QiCalJCalWriter::endObject()
+{
+    append("}", 1);
+    m_separator = true;
+}
+
+void QiCalJCalWriter::key(const char *name)
+{
+    separate();
+    append("\"", 1);
+    append(name, int(std::strlen(name)));
+    append("\":", 2);
+    m_separator = false;
+}
+
+void QiCalJCalWriter::value(const char *text)
+{
+    separate();
+    append("\"", 1);
+    append(text, int(std::strlen(text)));
+    append("\"", 1);
+    m_separator = true;
+}
+
+void QiCalJCalWriter::value(const QString &text)
+{
+    separate();
+    append("\"", 1);
+    appendUtf8(text);
+    append("\"", 1);
+    m_separator = true;
+}
+
+void QiCalJCalWriter::value(qint64 number)
+{
+    char text[24];
+    char* end = text + sizeof(text);
+    char* out = end;
+    quint64 magnitude = number < 0 ? quint64(0) - quint64(number) : quint64(number);
+
+    do
+    {
+        *--out = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (number < 0)
+    {
+        *--out = '-';
+    }
+
+    separate();
+    append(out, int(end - out));
+    m_separator = true;
+}
+
+void QiCalJCalWriter::intList(const char *name, const QList<qint32> &values)
+{
+    if (values.isEmpty())
+    {
+        return;
+    }
+
+    key(name);
+    if (values.size() == 1)
+    {
+        value(qint64(values.first()));
+        return;
+    }
+
+    beginArray();
+    for (qint32 number : values)
+    {
+        value(qint64(number));
+    }
+    endArray();
+}
+
+void QiCalJCalWriter::date(const QDate &date)
+{
+    char text[12];
+    char* out = text;
+    *out++ = '"';
+    out = putDigits(out, date.year(), 4);
+    *out++ = '-';
+    out = putDigits(out, date.month(), 2);
+    *out++ = '-';
+    out = putDigits(out, date.day(), 2);
+    *out++ = '"';
+
+    separate();
+    append(text, int(out - text));
+    m_separator = true;
+}
+
+void QiCalJCalWriter::stamp(qint64 seconds, bool utc)
+{
+    const qint64 days = floorDiv(seconds, SECS_PER_DAY);
+    const int secs = int(seconds - days * SECS_PER_DAY);
+    int year;
+    int month;
+    int day;
+    QDate::fromJulianDay(days + EPOCH_JULIAN_DAY).getDate(&year, &month, &day);
+
+    char text[24];
+    char* out = text;
+    *out++ = '"';
+    out = putDigits(out, year, 4);
+    *out++ = '-';
+    out = putDigits(out, month, 2);
+    *out++ = '-';
+    out = putDigits(out, day, 2);
+    *out++ = 'T';
+    out = putDigits(out, secs / 3600, 2);
+    *out++ = ':';
+    out = putDigits(out, secs / 60 % 60, 2);
+    *out++ = ':';
+    out = putDigits(out, secs % 60, 2);
+    if (utc)
+    {
+        *out++ = 'Z';
+    }
+    *out++ = '"';
+
+    separate();
+    append(text, int(out - text));
+    m_separator = true;
+}
+
+void QiCalJCalWriter::separate()
+{
+    if (m_separator)
+    {
+        append(",", 1);
+    }
+}
+
+void QiCalJCalWriter::append(const char *text, int length)
+{
+    m_buffer.append(text, length);
+}
+
+void QiCalJCalWriter::appendUtf8(const QString &text)
+{
+    const int length = text.size();
+    const int start = m_buffer.size();
+
+    // Worst case is six octets per UTF-16 unit for a \u00XX escape.
+    m_buffer.resize(start + length * 6);
+
+    const QChar* data = text.constData();
+    char* out = m_buffer.data() + start;
+
+    for (int i = 0; i < length; i++)
+    {
+        uint code = data[i].unicode();
+
+        if (code < 0x80)
+        {
+            if (code == '"' || code == '\\')
+            {
+                *out++ = '\\';
+                *out++ = char(code);
+            }
+            else if (code == '\n')
+            {
+                *out++ = '\\';
+                *out++ = 'n';
+            }
+            else if (code == '\r')
+            {
+                *out++ = '\\';
+                *out++ = 'r';
+            }
+            else if (code == '\t')
+            {
+                *out++ = '\\';
+                *out++ = 't';
+            }
+            else if (code < 0x20)
+            {
+                *out++ = '\\';
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = HEX_DIGITS[code >> 4];
+                *out++ = HEX_DIGITS[code & 0xf];
+            }
+            else
+            {
+                *out++ = char(code);
+            }
+            continue;
+        }
+
+        if (code < 0x800)
+        {
+            *out++ = char(0xc0 | (code >> 6));
+            *out++ = char(0x80 | (code & 0x3f));
+            continue;
+        }
+
+        if (QChar::isHighSurrogate(code) && i + 1 < length && data[i + 1].isLowSurrogate())
+        {
+            code = QChar::surrogateToUcs4(ushort(code), data[++i].unicode());
+        }
+        else if (QChar::isSurrogate(code))
+        {
+            code = QChar::ReplacementCharacter;
+        }
+
+        if (code >= 0x10000)
+        {
+            *out++ = char(0xf0 | (code >> 18));
+            *out++ = char(0x80 | ((code >> 12) & 0x3f));
+        }
+        else
+        {
+            *out++ = char(0xe0 | (code >> 12));
+        }
+        *out++ = char(0x80 | ((code >> 6) & 0x3f));
+        *out++ = char(0x80 | (code & 0x3f));
+    }
+
+    m_buffer.resize(int(out - m_buffer.constData()));
+}
@@ -0,0 +1,74 @@
+#ifndef QICALJCALWRITER_H
+#define QICALJCALWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QIODevice>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "qicalcalendar.h"
+#include "qicalendar_global.h"
+
+// Streams jCal (RFC 7265) JSON without building a document tree, flushing to a device as it goes.
+class QICALENDARSHARED_EXPORT QiCalJCalWriter
+{
+public:
+    explicit QiCalJCalWriter(QIODevice* device = nullptr);
+
+    QIODevice* device() const;
+    void setDevice(QIODevice* device);
+
+    bool writeCalendar(const QiCalCalendar* calendar);
+    bool writeOccurrences(const QiCalCalendar* calendar, const QList<QiCalEvent*>& occurrences);
+
+    const QByteArray& buffer() const;
+    void clear();
+    bool flush();
+
+    static const int FLUSH_SIZE = 64 * 1024;
+
+private:
+    void beginCalendar(const QiCalCalendar* calendar);
+    void endCalendar();
+    void writeTimeZone(const QiCalTimeZone* timeZone);
+    void writeTzInfo(const char* name, const QiCalTzInfo* info);
+    void writeEvent(const QiCalEvent* event);
+    void writeAlarm(const QiCalAlarm* alarm);
+    void writeRule(const QiCalRule* rule);
+    void writeText(const char* name, const QString& text);
+    void writeText(const char* name, const char* text);
+    void writeDateTime(const char* name, const QDateTime& dateTime, const QiCalEvent* event);
+    void writeDateList(const char* name, const QVector<qint64>& dates, const QiCalEvent* event);
+    void writeUtcOffset(const char* name, int offset);
+
+    const QString* zoneId(const QiCalEvent* event) const;
+
+    void beginComponent(const char* name);
+    void endComponent();
+    void beginProperty(const char* name, const QString* tzId, const char* type);
+    void endProperty();
+    void beginArray();
+    void endArray();
+    void beginObject();
+    void endObject();
+    void key(const char* name);
+    void value(const char* text);
+    void value(const QString& text);
+    void value(qint64 number);
+    void intList(const char* name, const QList<qint32>& values);
+    void date(const QDate& date);
+    void stamp(qint64 seconds, bool utc);
+    void separate();
+    void append(const char* text, int length);
+    void appendUtf8(const QString& text);
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    bool m_separator;
+    bool m_ok;
+    QSet<QString> m_tzIds;
+};
+
+#endif // QICALJCALWRITER_H
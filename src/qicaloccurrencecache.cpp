@@ -0,0 +1,82 @@
+#include "qicaloccurrencecache.h"
+
+#include <algorithm>
+
+QVector<qint64> QiCalOccurrenceCache::range(qint64 from, qint64 to, const Expander &expand)
+{
+    if (to < from)
+    {
+        return QVector<qint64>();
+    }
+
+    // segments are kept sorted, disjoint and non-adjacent; find the ones the query touches
+    auto first = std::lower_bound(m_segments.begin(), m_segments.end(), from, [](const Segment& seg, qint64 value) {
+        return seg.to < value - 1;
+    });
+    auto last = first;
+    while (last != m_segments.end() && last->from <= to + 1)
+    {
+        ++last;
+    }
+
+    if (first != last && first->from <= from && first->to >= to)
+    {
+        return slice(first->occurrences, from, to);
+    }
+
+    Segment merged;
+    merged.from = first != last ? std::min(from, first->from) : from;
+    merged.to = first != last ? std::max(to, (last - 1)->to) : to;
+
+    qint64 cursor = merged.from;
+    for (auto it = first; it != last; ++it)
+    {
+        if (cursor < it->from)
+        {
+            merged.occurrences += expand(cursor, it->from - 1);
+        }
+
+        merged.occurrences += it->occurrences;
+        cursor = it->to + 1;
+    }
+
+    if (cursor <= merged.to)
+    {
+        merged.occurrences += expand(cursor, merged.to);
+    }
+
+    const int index = first - m_segments.begin();
+    m_segments.erase(first, last);
+    m_segments.insert(index, merged);
+
+    return slice(m_segments[index].occurrences, from, to);
+}
+
+QVector<qint64> QiCalOccurrenceCache::slice(const QVector<qint64> &occurrences, qint64 from, qint64 to)
+{
+    auto begin = std::lower_bound(occurrences.constBegin(), occurrences.constEnd(), from);
+    auto end = std::upper_bound(begin, occurrences.constEnd(), to);
+
+    return occurrences.mid(begin - occurrences.constBegin(), end - begin);
+}
+
+void QiCalOccurrenceCache::clear()
+{
+    m_segments.clear();
+}
+
+bool QiCalOccurrenceCache::isEmpty() const
+{
+    return m_segments.isEmpty();
+}
+
+int QiCalOccurrenceCache::size() const
+{
+    int ret = 0;
+    for (const Segment& seg : m_segments)
+    {
+        ret += seg.occurrences.size();
+    }
+
+    return ret;
+}
@@ -0,0 +1,32 @@
+#ifndef QICALOCCURRENCECACHE_H
+#define QICALOCCURRENCECACHE_H
+
+#include <QVector>
+
+#include <functional>
+
+class QiCalOccurrenceCache
+{
+public:
+    typedef std::function<QVector<qint64>(qint64 from, qint64 to)> Expander;
+
+    QVector<qint64> range(qint64 from, qint64 to, const Expander& expand);
+    void clear();
+
+    bool isEmpty() const;
+    int size() const;
+
+private:
+    struct Segment
+    {
+        qint64 from;
+        qint64 to;
+        QVector<qint64> occurrences;
+    };
+
+    static QVector<qint64> slice(const QVector<qint64>& occurrences, qint64 from, qint64 to);
+
+    QVector<Segment> m_segments;
+};
+
+#endif // QICALOCCURRENCECACHE_H
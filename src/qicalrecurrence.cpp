@@ -0,0 +1,1475 @@
+#include "qicalrecurrence.h"
+#include "qicalevent.h"
+#include "qicalcivil.h"
+#include "qicalruleplan.h"
+#include "qicalutil_p.h"
+
+#include <QTimeZone>
+
+#include <algorithm>
+#include <limits>
+
+using namespace QiCalUtil;
+
+namespace
+{
+
+const qint64 EPOCH_WALL = EPOCH_JULIAN_DAY * SECS_PER_DAY;
+const int MAX_YEAR = 9999;
+const int CIVIL_BLOCK = 64;
+
+qint64 ceilDiv(qint64 a, qint64 b)
+{
+    return -floorDiv(-a, b);
+}
+
+int dayOfWeek(qint64 jd)
+{
+    return int(jd % 7) + 1;
+}
+
+qint64 weekOneStart(int year, int weekStart)
+{
+    qint64 jan1 = QDate(year, 1, 1).toJulianDay();
+    int offset = (dayOfWeek(jan1) - weekStart + 7) % 7;
+
+    return offset <= 3 ? jan1 - offset : jan1 + 7 - offset;
+}
+
+}
+
+QiCalRecurrence::QiCalRecurrence(const QiCalRule *rule) :
+    QiCalRecurrence(rule, rule->calEvent() ? rule->calEvent()->dtStart() : QDateTime())
+{
+}
+
+QiCalRecurrence::QiCalRecurrence(const QiCalRule *rule, const QDateTime &dtStart) :
+    m_start(dtStart)
+{
+    init(rule);
+    reset();
+}
+
+void QiCalRecurrence::init(const QiCalRule *rule)
+{
+    m_plan = rule->plan();
+
+    const QiCalEvent* event = rule->calEvent();
+    if (event != nullptr && !event->zone().isNull() && !event->zone()->isFixed() && m_start.timeSpec() == Qt::OffsetFromUTC)
+    {
+        m_zone = event->zone();
+    }
+
+    m_startWall = m_start.isValid() ? toWall(m_start) : 0;
+    m_startJd = floorDiv(m_startWall, SECS_PER_DAY);
+    m_startDate = QDate::fromJulianDay(m_startJd);
+
+    m_hasUntil = m_plan->until.isValid();
+    m_untilWall = m_hasUntil ? toWall(m_plan->until) : 0;
+
+    const quint8 weekMask = m_plan->dayMask ? m_plan->dayMask : quint8(1 << (dayOfWeek(m_startJd) - 1));
+    m_weekOffsetCount = 0;
+    for (int off = 0; off < 7; off++)
+    {
+        if (weekMask & (1 << ((m_plan->weekStart - 1 + off) % 7)))
+        {
+            m_weekOffsets[m_weekOffsetCount++] = off;
+        }
+    }
+    m_week0 = m_startJd - (dayOfWeek(m_startJd) - m_plan->weekStart + 7) % 7;
+
+    const int startSecs = int(m_startWall - m_startJd * SECS_PER_DAY);
+    const QVector<int> hours = m_plan->byHour.isEmpty() ? QVector<int>({ startSecs / 3600 }) : m_plan->byHour;
+    const QVector<int> minutes = m_plan->byMinute.isEmpty() ? QVector<int>({ startSecs / 60 % 60 }) : m_plan->byMinute;
+    const QVector<int> seconds = m_plan->bySecond.isEmpty() ? QVector<int>({ startSecs % 60 }) : m_plan->bySecond;
+
+    m_times.clear();
+    for (int hour : hours)
+    {
+        for (int minute : minutes)
+        {
+            for (int second : seconds)
+            {
+                m_times.push_back(hour * 3600 + minute * 60 + second);
+            }
+        }
+    }
+
+    m_rDates.clear();
+    m_exDates.clear();
+    if (rule->calEvent() != nullptr && m_start.isValid())
+    {
+        for (qint64 msecs : rule->calEvent()->rDates())
+        {
+            m_rDates.push_back(toWall(QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC)));
+        }
+
+        for (qint64 msecs : rule->calEvent()->exDates())
+        {
+            m_exDates.push_back(toWall(QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC)));
+        }
+
+        std::sort(m_rDates.begin(), m_rDates.end());
+        std::sort(m_exDates.begin(), m_exDates.end());
+    }
+
+    m_civilPeriod = -1;
+    m_civilJd.resize(CIVIL_BLOCK);
+    m_civilYear.resize(CIVIL_BLOCK);
+    m_civilMonth.resize(CIVIL_BLOCK);
+    m_civilDay.resize(CIVIL_BLOCK);
+    m_civilDayOfWeek.resize(CIVIL_BLOCK);
+
+    m_limitWall = std::numeric_limits<qint64>::max();
+    m_checkGaps = true;
+    initClosedForm();
+}
+
+void QiCalRecurrence::reset(const QDateTime &from)
+{
+    m_fromCut = from.isValid() ? toWall(from) : std::numeric_limits<qint64>::min();
+    m_fromWall = from.isValid() ? m_fromCut - gapBefore(m_fromCut) : m_fromCut;
+    m_index = 0;
+    m_lastWall = m_startWall - 1;
+    m_done = !m_start.isValid();
+    m_buffer.clear();
+    m_buffer.push_back(m_startWall);
+    m_pos = 0;
+    m_period = firstPeriod(m_fromWall);
+    m_rDatePos = int(std::lower_bound(m_rDates.constBegin(), m_rDates.constEnd(), m_fromCut) - m_rDates.constBegin());
+    m_exDatePos = int(std::lower_bound(m_exDates.constBegin(), m_exDates.constEnd(), m_fromWall) - m_exDates.constBegin());
+
+    if (m_plan->count >= 0 && m_period > 0 && !m_done)
+    {
+        m_index = countBefore(m_period);
+        m_lastWall = m_startWall;
+        m_buffer.clear();
+    }
+}
+
+void QiCalRecurrence::skipTo(const QDateTime &from)
+{
+    const qint64 fromCut = toWall(from);
+    if (fromCut <= m_fromCut)
+    {
+        return;
+    }
+
+    m_fromCut = fromCut;
+    m_fromWall = std::max(m_fromWall, fromCut - gapBefore(fromCut));
+
+    const qint64 period = firstPeriod(m_fromWall);
+    if (!m_done && period > m_period)
+    {
+        if (m_plan->count >= 0)
+        {
+            m_index = countBefore(period);
+            m_lastWall = std::max(m_lastWall, m_startWall);
+        }
+
+        m_period = period;
+        m_buffer.clear();
+        m_pos = 0;
+    }
+}
+
+void QiCalRecurrence::setLimit(const QDateTime &limit)
+{
+    m_limitWall = limit.isValid() ? toWall(limit) : std::numeric_limits<qint64>::max();
+}
+
+bool QiCalRecurrence::hasNext()
+{
+    return fetch();
+}
+
+QDateTime QiCalRecurrence::peek()
+{
+    if (!fetch())
+    {
+        return QDateTime();
+    }
+
+    return toDateTime(m_nextWall);
+}
+
+QDateTime QiCalRecurrence::next()
+{
+    if (!fetch())
+    {
+        return QDateTime();
+    }
+
+    const qint64 wall = m_nextWall;
+    consume();
+
+    return toDateTime(wall);
+}
+
+QList<QDateTime> QiCalRecurrence::between(const QDateTime &from, const QDateTime &to)
+{
+    QList<QDateTime> ret;
+    const qint64 toWallTime = toWall(to);
+
+    setLimit(to);
+    reset(from);
+
+    while (fetch() && m_nextWall <= toWallTime)
+    {
+        // a gap time just before the cut resolves past it
+        const QDateTime occurrence = next();
+        if (occurrence <= to)
+        {
+            ret.push_back(occurrence);
+        }
+    }
+
+    return ret;
+}
+
+QDateTime QiCalRecurrence::dtStart() const
+{
+    return m_start;
+}
+
+QDateTime QiCalRecurrence::toDateTime(qint64 wall) const
+{
+    if (!m_zone.isNull())
+    {
+        const qint64 utc = m_zone->toUtc(wall - EPOCH_WALL);
+        return QDateTime::fromMSecsSinceEpoch(utc * 1000, Qt::OffsetFromUTC, m_zone->offsetAtUtc(utc));
+    }
+
+    switch (m_start.timeSpec()) {
+    case Qt::UTC:
+        return QDateTime::fromMSecsSinceEpoch((wall - EPOCH_WALL) * 1000, Qt::UTC);
+    case Qt::OffsetFromUTC:
+        return QDateTime::fromMSecsSinceEpoch((wall - EPOCH_WALL - m_start.offsetFromUtc()) * 1000, Qt::OffsetFromUTC, m_start.offsetFromUtc());
+    default:
+        break;
+    }
+
+    qint64 jd = floorDiv(wall, SECS_PER_DAY);
+    QDate date = QDate::fromJulianDay(jd);
+    QTime time = QTime::fromMSecsSinceStartOfDay(int(wall - jd * SECS_PER_DAY) * 1000);
+
+    if (m_start.timeSpec() == Qt::TimeZone)
+    {
+        return QDateTime(date, time, m_start.timeZone());
+    }
+
+    return QDateTime(date, time);
+}
+
+qint64 QiCalRecurrence::toWall(const QDateTime &dateTime) const
+{
+    if (!m_zone.isNull())
+    {
+        return m_zone->toLocal(floorDiv(dateTime.toMSecsSinceEpoch(), 1000)) + EPOCH_WALL;
+    }
+
+    QDateTime local;
+
+    switch (m_start.timeSpec()) {
+    case Qt::UTC:
+        return floorDiv(dateTime.toMSecsSinceEpoch(), 1000) + EPOCH_WALL;
+    case Qt::OffsetFromUTC:
+        return floorDiv(dateTime.toMSecsSinceEpoch(), 1000) + m_start.offsetFromUtc() + EPOCH_WALL;
+    case Qt::TimeZone:
+        local = dateTime.toTimeZone(m_start.timeZone());
+        break;
+    default:
+        local = dateTime.toLocalTime();
+        break;
+    }
+
+    return local.date().toJulianDay() * SECS_PER_DAY + local.time().msecsSinceStartOfDay() / 1000;
+}
+
+bool QiCalRecurrence::fetch()
+{
+    while (true)
+    {
+        const bool rule = fetchRule();
+
+        while (m_rDatePos < m_rDates.size() && m_rDates[m_rDatePos] < m_fromCut)
+        {
+            m_rDatePos++;
+        }
+
+        const bool rDate = m_rDatePos < m_rDates.size();
+        if (!rule && !rDate)
+        {
+            return false;
+        }
+
+        m_nextWall = rule && (!rDate || m_buffer[m_pos] < m_rDates[m_rDatePos]) ? m_buffer[m_pos] : m_rDates[m_rDatePos];
+
+        while (m_exDatePos < m_exDates.size() && m_exDates[m_exDatePos] < m_nextWall)
+        {
+            m_exDatePos++;
+        }
+
+        if (m_exDatePos == m_exDates.size() || m_exDates[m_exDatePos] != m_nextWall)
+        {
+            return true;
+        }
+
+        consume();
+    }
+}
+
+void QiCalRecurrence::consume()
+{
+    if (m_pos < m_buffer.size() && m_buffer[m_pos] == m_nextWall)
+    {
+        m_lastWall = m_buffer[m_pos++];
+        m_index++;
+    }
+
+    if (m_rDatePos < m_rDates.size() && m_rDates[m_rDatePos] == m_nextWall)
+    {
+        m_rDatePos++;
+    }
+}
+
+bool QiCalRecurrence::fetchRule()
+{
+    while (true)
+    {
+        while (m_pos < m_buffer.size())
+        {
+            const qint64 wall = m_buffer[m_pos];
+
+            if (wall <= m_lastWall)
+            {
+                m_pos++;
+                continue;
+            }
+
+            if ((m_plan->count >= 0 && m_index >= m_plan->count) || (m_hasUntil && wall > m_untilWall))
+            {
+                m_done = true;
+                m_buffer.clear();
+                m_pos = 0;
+                return false;
+            }
+
+            // just after a gap, candidates inside it come before the cut in wall time but not in elapsed time
+            if (wall < m_fromWall || (wall < m_fromCut && m_zone->toUtc(wall - EPOCH_WALL) < m_zone->toUtc(m_fromCut - EPOCH_WALL)))
+            {
+                m_lastWall = wall;
+                m_index++;
+                m_pos++;
+                continue;
+            }
+
+            return true;
+        }
+
+        if (m_done)
+        {
+            return false;
+        }
+
+        nextPeriod();
+    }
+}
+
+qint64 QiCalRecurrence::firstPeriod(qint64 fromWall) const
+{
+    if (fromWall <= m_startWall)
+    {
+        return 0;
+    }
+
+    const qint64 fromJd = floorDiv(fromWall, SECS_PER_DAY);
+    const QDate fromDate = QDate::fromJulianDay(fromJd);
+
+    switch (m_plan->freq) {
+    case QiCalRule::RR_YEARLY:
+        return (fromDate.year() - m_startDate.year()) / m_plan->interval;
+    case QiCalRule::RR_MONTHLY:
+        return ((fromDate.year() - m_startDate.year()) * 12 + fromDate.month() - m_startDate.month()) / m_plan->interval;
+    case QiCalRule::RR_WEEKLY:
+        return (fromJd - m_week0) / (7 * m_plan->interval);
+    case QiCalRule::RR_DAILY:
+        return (fromJd - m_startJd) / m_plan->interval;
+    case QiCalRule::RR_HOURLY:
+        return (fromWall - m_startWall) / (3600 * m_plan->interval);
+    case QiCalRule::RR_MINUTELY:
+        return (fromWall - m_startWall) / (60 * m_plan->interval);
+    default:
+        return (fromWall - m_startWall) / m_plan->interval;
+    }
+}
+
+bool QiCalRecurrence::outOfRange(qint64 lower) const
+{
+    return lower > m_limitWall || (m_hasUntil && lower > m_untilWall) || QDate::fromJulianDay(floorDiv(lower, SECS_PER_DAY)).year() > MAX_YEAR;
+}
+
+void QiCalRecurrence::nextPeriod()
+{
+    const qint64 next = buildPeriod(m_period);
+
+    if (next < 0)
+    {
+        m_done = true;
+        m_buffer.clear();
+        return;
+    }
+
+    m_period = next;
+}
+
+qint64 QiCalRecurrence::buildPeriod(qint64 period)
+{
+    m_buffer.clear();
+    m_days.clear();
+    m_pos = 0;
+
+    if (m_plan->freq < QiCalRule::RR_DAILY)
+    {
+        const qint64 next = buildSubDailyPeriod(period);
+        applySetPos();
+        dropGapDuplicates();
+        return next;
+    }
+
+    switch (m_plan->freq) {
+    case QiCalRule::RR_YEARLY:
+    {
+        const int year = m_startDate.year() + period * m_plan->interval;
+        if (outOfRange(QDate(year, 1, 1).toJulianDay() * SECS_PER_DAY))
+        {
+            return -1;
+        }
+
+        yearDays(year);
+        break;
+    }
+    case QiCalRule::RR_MONTHLY:
+    {
+        const qint64 month = m_startDate.year() * 12 + m_startDate.month() - 1 + period * m_plan->interval;
+        const QDate first(month / 12, month % 12 + 1, 1);
+        if (outOfRange(first.toJulianDay() * SECS_PER_DAY))
+        {
+            return -1;
+        }
+
+        if (!m_plan->monthMask || (m_plan->monthMask & (1 << first.month())))
+        {
+            monthDays(first.year(), first.month());
+        }
+        break;
+    }
+    case QiCalRule::RR_WEEKLY:
+    {
+        const qint64 weekFirst = m_week0 + period * 7 * m_plan->interval;
+        if (outOfRange(weekFirst * SECS_PER_DAY))
+        {
+            return -1;
+        }
+
+        weekDays(weekFirst);
+        break;
+    }
+    default:
+    {
+        const qint64 jd = m_startJd + period * m_plan->interval;
+        if (outOfRange(jd * SECS_PER_DAY))
+        {
+            return -1;
+        }
+
+        if (dailyMatches(period))
+        {
+            m_days.push_back(jd);
+        }
+        break;
+    }
+    }
+
+    expandDays();
+    applySetPos();
+    dropGapDuplicates();
+
+    return period + 1;
+}
+
+qint64 QiCalRecurrence::buildSubDailyPeriod(qint64 period)
+{
+    const qint64 unit = subDailyUnit();
+    const qint64 length = unit * m_plan->interval;
+    const qint64 bucket = floorDiv(m_startWall + period * length, unit) * unit;
+
+    if (outOfRange(bucket))
+    {
+        return -1;
+    }
+
+    const qint64 jd = floorDiv(bucket, SECS_PER_DAY);
+    const int secs = int(bucket - jd * SECS_PER_DAY);
+    const QDate date = QDate::fromJulianDay(jd);
+    qint64 boundary = -1;
+
+    if (m_plan->monthMask && !(m_plan->monthMask & (1 << date.month())))
+    {
+        boundary = QDate(date.year(), date.month(), 1).addMonths(1).toJulianDay() * SECS_PER_DAY;
+    }
+    else if (!dayMatches(date, true))
+    {
+        boundary = (jd + 1) * SECS_PER_DAY;
+    }
+    else if (m_plan->hourMask && !(m_plan->hourMask & (quint32(1) << (secs / 3600))))
+    {
+        boundary = bucket - secs % 3600 + 3600;
+    }
+    else if (m_plan->freq != QiCalRule::RR_HOURLY && m_plan->minuteMask && !(m_plan->minuteMask & (quint64(1) << (secs / 60 % 60))))
+    {
+        boundary = bucket - secs % 60 + 60;
+    }
+    else if (m_plan->freq == QiCalRule::RR_SECONDLY && m_plan->secondMask && !(m_plan->secondMask & (quint64(1) << (secs % 60))))
+    {
+        boundary = bucket + 1;
+    }
+
+    if (boundary >= 0)
+    {
+        return std::max(period + 1, ceilDiv(boundary - m_startWall, length));
+    }
+
+    const int startSecs = int(m_startWall - m_startJd * SECS_PER_DAY);
+    const QVector<int> seconds = m_plan->bySecond.isEmpty() ? QVector<int>({ startSecs % 60 }) : m_plan->bySecond;
+
+    if (m_plan->freq == QiCalRule::RR_HOURLY)
+    {
+        const QVector<int> minutes = m_plan->byMinute.isEmpty() ? QVector<int>({ startSecs / 60 % 60 }) : m_plan->byMinute;
+        for (int minute : minutes)
+        {
+            for (int second : seconds)
+            {
+                m_buffer.push_back(bucket + minute * 60 + second);
+            }
+        }
+    }
+    else if (m_plan->freq == QiCalRule::RR_MINUTELY)
+    {
+        for (int second : seconds)
+        {
+            m_buffer.push_back(bucket + second);
+        }
+    }
+    else
+    {
+        m_buffer.push_back(bucket);
+    }
+
+    return period + 1;
+}
+
+qint64 QiCalRecurrence::subDailyUnit() const
+{
+    return m_plan->freq == QiCalRule::RR_HOURLY ? 3600 : (m_plan->freq == QiCalRule::RR_MINUTELY ? 60 : 1);
+}
+
+int QiCalRecurrence::candidatesAfterStart() const
+{
+    return int(m_buffer.constEnd() - std::upper_bound(m_buffer.constBegin(), m_buffer.constEnd(), m_startWall));
+}
+
+void QiCalRecurrence::dropGapDuplicates()
+{
+    if (m_zone.isNull() || !m_checkGaps)
+    {
+        return;
+    }
+
+    // a wall time inside a spring-forward gap resolves to the same instant as the wall time one gap later;
+    // when the rule yields both, RFC 5545 keeps only one instance, the earlier candidate
+    QVector<qint64> dropped;
+    for (qint64 wall : m_buffer)
+    {
+        const qint32 gap = gapBefore(wall);
+        if (gap > 0 && wall - gap > m_startWall
+                && (std::binary_search(m_buffer.constBegin(), m_buffer.constEnd(), wall - gap) || isCandidate(wall - gap)))
+        {
+            dropped.push_back(wall);
+        }
+    }
+
+    if (!dropped.isEmpty())
+    {
+        m_buffer.erase(std::remove_if(m_buffer.begin(), m_buffer.end(), [&dropped](qint64 wall) {
+            return std::binary_search(dropped.constBegin(), dropped.constEnd(), wall);
+        }), m_buffer.end());
+    }
+}
+
+qint32 QiCalRecurrence::gapBefore(qint64 wall) const
+{
+    return m_zone.isNull() ? 0 : m_zone->gapBefore(wall - EPOCH_WALL);
+}
+
+bool QiCalRecurrence::isCandidate(qint64 wall) const
+{
+    QiCalRecurrence probe(*this);
+    probe.m_limitWall = std::numeric_limits<qint64>::max();
+    probe.m_checkGaps = false;
+
+    return probe.buildPeriod(periodOf(wall)) >= 0 && std::binary_search(probe.m_buffer.constBegin(), probe.m_buffer.constEnd(), wall);
+}
+
+void QiCalRecurrence::initClosedForm()
+{
+    m_closedForm = m_plan->bySetPos.isEmpty();
+    m_perPeriod = 0;
+    m_firstPeriodCount = 0;
+
+    switch (m_plan->freq) {
+    case QiCalRule::RR_YEARLY:
+    case QiCalRule::RR_MONTHLY:
+        m_closedForm = false;
+        break;
+    case QiCalRule::RR_WEEKLY:
+        m_closedForm = m_closedForm && !m_plan->monthMask;
+        m_perPeriod = m_weekOffsetCount * m_times.size();
+        break;
+    case QiCalRule::RR_DAILY:
+        m_closedForm = m_closedForm && !m_plan->monthMask && !m_plan->dayMask && m_plan->byMonthDay.isEmpty();
+        m_perPeriod = m_times.size();
+        break;
+    default:
+        m_closedForm = m_closedForm && !m_plan->monthMask && !m_plan->dayMask && m_plan->byMonthDay.isEmpty() && m_plan->byYearDay.isEmpty() && !m_plan->hourMask
+                && (m_plan->freq == QiCalRule::RR_HOURLY || !m_plan->minuteMask)
+                && (m_plan->freq != QiCalRule::RR_SECONDLY || !m_plan->secondMask);
+        m_perPeriod = m_plan->freq == QiCalRule::RR_HOURLY ? std::max(m_plan->byMinute.size(), 1) * std::max(m_plan->bySecond.size(), 1)
+                                                     : (m_plan->freq == QiCalRule::RR_MINUTELY ? std::max(m_plan->bySecond.size(), 1) : 1);
+        break;
+    }
+
+    // candidates dropped at a gap make the per-period count vary; with one time a day none can be dropped
+    if (!m_zone.isNull() && (m_plan->freq < QiCalRule::RR_DAILY || m_times.size() > 1))
+    {
+        m_closedForm = false;
+    }
+
+    if (m_closedForm && m_perPeriod > 0 && m_start.isValid())
+    {
+        buildPeriod(0);
+        m_firstPeriodCount = candidatesAfterStart();
+        m_buffer.clear();
+    }
+    else
+    {
+        m_closedForm = false;
+    }
+}
+
+qint64 QiCalRecurrence::countBefore(qint64 period)
+{
+    if (period <= 0)
+    {
+        return 1;
+    }
+
+    if (m_closedForm)
+    {
+        return 1 + m_firstPeriodCount + (period - 1) * m_perPeriod;
+    }
+
+    qint64 total = 1;
+    for (qint64 p = 0; p < period && p >= 0;)
+    {
+        const qint64 next = buildPeriod(p);
+        if (next < 0)
+        {
+            break;
+        }
+
+        total += candidatesAfterStart();
+        p = next;
+    }
+
+    return total;
+}
+
+qint64 QiCalRecurrence::periodOf(qint64 wall) const
+{
+    const qint64 jd = floorDiv(wall, SECS_PER_DAY);
+
+    switch (m_plan->freq) {
+    case QiCalRule::RR_WEEKLY:
+        return floorDiv(jd - m_week0, 7 * m_plan->interval);
+    case QiCalRule::RR_DAILY:
+        return floorDiv(jd - m_startJd, m_plan->interval);
+    case QiCalRule::RR_YEARLY:
+    case QiCalRule::RR_MONTHLY:
+        return firstPeriod(wall);
+    default:
+    {
+        const qint64 unit = subDailyUnit();
+        return floorDiv(floorDiv(wall, unit) - floorDiv(m_startWall, unit), m_plan->interval);
+    }
+    }
+}
+
+QDateTime QiCalRecurrence::occurrenceAt(qint64 index) const
+{
+    if (m_rDates.isEmpty() && m_exDates.isEmpty())
+    {
+        return ruleOccurrenceAt(index);
+    }
+
+    if (index < 0 || !m_start.isValid())
+    {
+        return QDateTime();
+    }
+
+    // RDATE instances before the answer shift it down in the RRULE set, EXDATE instances up to it shift it along
+    const QVector<qint64> extras = extraDates();
+    const QVector<qint64> excluded = excludedIndexes();
+    qint64 ruleIndex = index - extras.size();
+
+    for (int i = 0; i < extras.size(); i++)
+    {
+        qint64 before = ruleCountBefore(extras[i]);
+        before -= std::lower_bound(excluded.constBegin(), excluded.constEnd(), before) - excluded.constBegin();
+
+        if (before + i == index)
+        {
+            return toDateTime(extras[i]);
+        }
+
+        if (before + i > index)
+        {
+            ruleIndex = index - i;
+            break;
+        }
+    }
+
+    for (qint64 skipped : excluded)
+    {
+        if (skipped > ruleIndex)
+        {
+            break;
+        }
+        ruleIndex++;
+    }
+
+    return ruleOccurrenceAt(ruleIndex);
+}
+
+QDateTime QiCalRecurrence::ruleOccurrenceAt(qint64 index) const
+{
+    if (index < 0 || !m_start.isValid() || (m_plan->count >= 0 && index >= m_plan->count))
+    {
+        return QDateTime();
+    }
+
+    if (index == 0)
+    {
+        return m_start;
+    }
+
+    QiCalRecurrence probe(*this);
+    probe.m_limitWall = std::numeric_limits<qint64>::max();
+    qint64 wall = 0;
+    bool found = false;
+
+    if (probe.m_closedForm)
+    {
+        qint64 period = 0;
+        qint64 offset = index - 1;
+
+        if (offset >= probe.m_firstPeriodCount)
+        {
+            offset -= probe.m_firstPeriodCount;
+            period = 1 + offset / probe.m_perPeriod;
+            offset %= probe.m_perPeriod;
+        }
+        else
+        {
+            offset += probe.m_perPeriod - probe.m_firstPeriodCount;
+        }
+
+        if (probe.buildPeriod(period) >= 0 && offset < probe.m_buffer.size())
+        {
+            wall = probe.m_buffer[offset];
+            found = true;
+        }
+    }
+    else
+    {
+        qint64 remaining = index - 1;
+        for (qint64 p = 0; p >= 0 && !found;)
+        {
+            const qint64 next = probe.buildPeriod(p);
+            if (next < 0)
+            {
+                break;
+            }
+
+            const int count = probe.candidatesAfterStart();
+            if (remaining < count)
+            {
+                wall = probe.m_buffer[probe.m_buffer.size() - count + remaining];
+                found = true;
+            }
+
+            remaining -= count;
+            p = next;
+        }
+    }
+
+    if (!found || (m_hasUntil && wall > m_untilWall))
+    {
+        return QDateTime();
+    }
+
+    return toDateTime(wall);
+}
+
+qint64 QiCalRecurrence::indexOf(const QDateTime &occurrence) const
+{
+    if (!m_start.isValid() || !occurrence.isValid())
+    {
+        return -1;
+    }
+
+    const qint64 wall = instanceWall(occurrence);
+    if (std::binary_search(m_exDates.constBegin(), m_exDates.constEnd(), wall))
+    {
+        return -1;
+    }
+
+    qint64 index = ruleIndexOf(wall);
+    if (m_rDates.isEmpty() && m_exDates.isEmpty())
+    {
+        return index;
+    }
+
+    if (index < 0)
+    {
+        if (!std::binary_search(m_rDates.constBegin(), m_rDates.constEnd(), wall))
+        {
+            return -1;
+        }
+        index = ruleCountBefore(wall);
+    }
+
+    const QVector<qint64> extras = extraDates();
+    const QVector<qint64> excluded = excludedIndexes();
+
+    return index - (std::lower_bound(excluded.constBegin(), excluded.constEnd(), index) - excluded.constBegin())
+            + (std::lower_bound(extras.constBegin(), extras.constEnd(), wall) - extras.constBegin());
+}
+
+qint64 QiCalRecurrence::instanceWall(const QDateTime &occurrence) const
+{
+    const qint64 wall = toWall(occurrence);
+
+    // an instance generated inside a gap is known by the earlier of the two wall times
+    const qint32 gap = gapBefore(wall);
+    if (gap > 0 && wall - gap > m_startWall && isCandidate(wall - gap))
+    {
+        return wall - gap;
+    }
+
+    return wall;
+}
+
+qint64 QiCalRecurrence::ruleIndexOf(qint64 wall) const
+{
+    if (wall == m_startWall)
+    {
+        return m_plan->count == 0 ? -1 : 0;
+    }
+
+    if (wall < m_startWall || (m_hasUntil && wall > m_untilWall))
+    {
+        return -1;
+    }
+
+    QiCalRecurrence probe(*this);
+    probe.m_limitWall = std::numeric_limits<qint64>::max();
+
+    const qint64 period = periodOf(wall);
+    qint64 before = 0;
+
+    if (probe.m_closedForm)
+    {
+        before = probe.countBefore(period);
+        if (probe.buildPeriod(period) < 0)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        before = 1;
+        qint64 p = 0;
+        while (p >= 0 && p < period)
+        {
+            const qint64 next = probe.buildPeriod(p);
+            if (next < 0)
+            {
+                return -1;
+            }
+
+            before += probe.candidatesAfterStart();
+            p = next;
+        }
+
+        if (p != period || probe.buildPeriod(period) < 0)
+        {
+            return -1;
+        }
+    }
+
+    const QVector<qint64>& candidates = probe.m_buffer;
+    auto it = std::lower_bound(candidates.constBegin(), candidates.constEnd(), wall);
+    if (it == candidates.constEnd() || *it != wall)
+    {
+        return -1;
+    }
+
+    const qint64 index = before + (it - candidates.constBegin()) - (candidates.size() - probe.candidatesAfterStart());
+    if (m_plan->count >= 0 && index >= m_plan->count)
+    {
+        return -1;
+    }
+
+    return index;
+}
+
+qint64 QiCalRecurrence::ruleCountBefore(qint64 wall) const
+{
+    const qint64 limit = m_plan->count >= 0 ? m_plan->count : std::numeric_limits<qint64>::max();
+    if (m_hasUntil)
+    {
+        wall = std::min(wall, m_untilWall + 1);
+    }
+
+    if (wall <= m_startWall || limit == 0)
+    {
+        return 0;
+    }
+
+    QiCalRecurrence probe(*this);
+    probe.m_limitWall = std::numeric_limits<qint64>::max();
+
+    const qint64 period = periodOf(wall);
+    qint64 before = 1;
+    qint64 p = 0;
+
+    if (probe.m_closedForm)
+    {
+        before = probe.countBefore(period);
+        p = period;
+    }
+    else
+    {
+        while (p >= 0 && p < period && before < limit)
+        {
+            const qint64 next = probe.buildPeriod(p);
+            if (next < 0)
+            {
+                return std::min(before, limit);
+            }
+
+            before += probe.candidatesAfterStart();
+            p = next;
+        }
+    }
+
+    if (p == period && before < limit && probe.buildPeriod(period) >= 0)
+    {
+        const QVector<qint64>& candidates = probe.m_buffer;
+        before += std::max<qint64>(0, std::lower_bound(candidates.constBegin(), candidates.constEnd(), wall)
+                                      - std::upper_bound(candidates.constBegin(), candidates.constEnd(), m_startWall));
+    }
+
+    return std::min(before, limit);
+}
+
+QVector<qint64> QiCalRecurrence::extraDates() const
+{
+    QVector<qint64> extras;
+    for (int i = 0; i < m_rDates.size(); i++)
+    {
+        const qint64 wall = m_rDates[i];
+        if ((i == 0 || m_rDates[i - 1] != wall) && !std::binary_search(m_exDates.constBegin(), m_exDates.constEnd(), wall) && ruleIndexOf(wall) < 0)
+        {
+            extras.push_back(wall);
+        }
+    }
+
+    return extras;
+}
+
+QVector<qint64> QiCalRecurrence::excludedIndexes() const
+{
+    QVector<qint64> excluded;
+    for (int i = 0; i < m_exDates.size(); i++)
+    {
+        const qint64 index = i == 0 || m_exDates[i - 1] != m_exDates[i] ? ruleIndexOf(m_exDates[i]) : -1;
+        if (index >= 0)
+        {
+            excluded.push_back(index);
+        }
+    }
+
+    return excluded;
+}
+
+bool QiCalRecurrence::isOccurrence(const QDateTime &occurrence) const
+{
+    return indexOf(occurrence) >= 0;
+}
+
+QDateTime QiCalRecurrence::lastOccurrence() const
+{
+    QDateTime last = ruleLastOccurrence();
+    if ((m_rDates.isEmpty() && m_exDates.isEmpty()) || !m_start.isValid() || (m_plan->count < 0 && !m_hasUntil))
+    {
+        return last;
+    }
+
+    if (last.isValid() && !m_exDates.isEmpty())
+    {
+        const QVector<qint64> excluded = excludedIndexes();
+        qint64 index = ruleIndexOf(instanceWall(last));
+        while (index >= 0 && std::binary_search(excluded.constBegin(), excluded.constEnd(), index))
+        {
+            index--;
+        }
+        last = ruleOccurrenceAt(index);
+    }
+
+    const QVector<qint64> extras = extraDates();
+    if (!extras.isEmpty() && (!last.isValid() || extras.last() > instanceWall(last)))
+    {
+        last = toDateTime(extras.last());
+    }
+
+    return last;
+}
+
+QDateTime QiCalRecurrence::ruleLastOccurrence() const
+{
+    if (m_plan->count >= 0)
+    {
+        QDateTime last = ruleOccurrenceAt(m_plan->count - 1);
+        if (last.isValid() || !m_hasUntil)
+        {
+            return last;
+        }
+    }
+
+    if (!m_hasUntil || !m_start.isValid())
+    {
+        return QDateTime();
+    }
+
+    QiCalRecurrence probe(*this);
+    probe.m_limitWall = std::numeric_limits<qint64>::max();
+    probe.m_hasUntil = false;
+
+    for (qint64 p = periodOf(m_untilWall); p > 0; p--)
+    {
+        if (probe.buildPeriod(p) < 0)
+        {
+            continue;
+        }
+
+        auto it = std::upper_bound(probe.m_buffer.constBegin(), probe.m_buffer.constEnd(), m_untilWall);
+        if (it != probe.m_buffer.constBegin())
+        {
+            return toDateTime(*(it - 1));
+        }
+    }
+
+    probe.buildPeriod(0);
+    auto it = std::upper_bound(probe.m_buffer.constBegin(), probe.m_buffer.constEnd(), m_untilWall);
+    if (it != probe.m_buffer.constBegin() && *(it - 1) > m_startWall)
+    {
+        return toDateTime(*(it - 1));
+    }
+
+    return m_start;
+}
+
+bool QiCalRecurrence::dayMatches(const QDate &date, bool subDaily) const
+{
+    int year, month, day;
+    date.getDate(&year, &month, &day);
+
+    if (!dayMatches(year, month, day, date.dayOfWeek()))
+    {
+        return false;
+    }
+
+    if (subDaily && !m_plan->byYearDay.isEmpty())
+    {
+        const int day = date.dayOfYear();
+        const int negDay = day - date.daysInYear() - 1;
+        if (!std::binary_search(m_plan->byYearDay.begin(), m_plan->byYearDay.end(), day)
+                && !std::binary_search(m_plan->byYearDay.begin(), m_plan->byYearDay.end(), negDay))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool QiCalRecurrence::dayMatches(int year, int month, int day, int dayOfWeek) const
+{
+    if (m_plan->monthMask && !(m_plan->monthMask & (1 << month)))
+    {
+        return false;
+    }
+
+    if (m_plan->dayMask && !(m_plan->dayMask & (1 << (dayOfWeek - 1))))
+    {
+        return false;
+    }
+
+    if (!m_plan->byMonthDay.isEmpty())
+    {
+        const int negDay = day - QiCalCivil::daysInMonth(year, month) - 1;
+        if (!std::binary_search(m_plan->byMonthDay.begin(), m_plan->byMonthDay.end(), day)
+                && !std::binary_search(m_plan->byMonthDay.begin(), m_plan->byMonthDay.end(), negDay))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool QiCalRecurrence::dailyMatches(qint64 period)
+{
+    if (!m_plan->monthMask && !m_plan->dayMask && m_plan->byMonthDay.isEmpty())
+    {
+        return true;
+    }
+
+    const qint64 jd = m_startJd + period * m_plan->interval;
+    if (m_startJd < QiCalCivil::MIN_JULIAN_DAY || jd > std::numeric_limits<qint32>::max())
+    {
+        return dayMatches(QDate::fromJulianDay(jd), false);
+    }
+
+    if (m_civilPeriod < 0 || period < m_civilPeriod || period >= m_civilPeriod + CIVIL_BLOCK)
+    {
+        m_civilPeriod = period;
+        for (int i = 0; i < CIVIL_BLOCK; i++)
+        {
+            m_civilJd[i] = qint32(std::min<qint64>(jd + i * m_plan->interval, std::numeric_limits<qint32>::max()));
+        }
+
+        QiCalCivil::fromJulianDays(m_civilJd.data(), CIVIL_BLOCK, m_civilYear.data(), m_civilMonth.data(), m_civilDay.data(), m_civilDayOfWeek.data());
+    }
+
+    const int i = int(period - m_civilPeriod);
+    return dayMatches(m_civilYear[i], m_civilMonth[i], m_civilDay[i], m_civilDayOfWeek[i]);
+}
+
+void QiCalRecurrence::yearDays(int year)
+{
+    const QDate jan1(year, 1, 1);
+    const qint64 base = jan1.toJulianDay();
+    const int length = jan1.daysInYear();
+
+    if (m_plan->byWeekNo.isEmpty() && m_plan->byYearDay.isEmpty() && m_plan->byMonthDay.isEmpty() && m_plan->byDay.isEmpty())
+    {
+        for (int month = 1; month <= 12; month++)
+        {
+            if ((m_plan->monthMask && (m_plan->monthMask & (1 << month))) || (!m_plan->monthMask && month == m_startDate.month()))
+            {
+                QDate date(year, month, m_startDate.day());
+                if (date.isValid())
+                {
+                    m_days.push_back(date.toJulianDay());
+                }
+            }
+        }
+        return;
+    }
+
+    m_marks.assign(length, 1);
+
+    if (m_plan->monthMask)
+    {
+        for (int month = 1; month <= 12; month++)
+        {
+            if (!(m_plan->monthMask & (1 << month)))
+            {
+                QDate first(year, month, 1);
+                int offset = jan1.daysTo(first);
+                std::fill(m_marks.begin() + offset, m_marks.begin() + offset + first.daysInMonth(), 0);
+            }
+        }
+    }
+
+    if (!m_plan->byWeekNo.isEmpty())
+    {
+        const quint8 weekMask = m_plan->dayMask ? m_plan->dayMask : quint8(1 << (dayOfWeek(m_startJd) - 1));
+
+        m_scratch.assign(length, 0);
+        if (m_plan->weekStart == Qt::Monday && base >= QiCalCivil::MIN_JULIAN_DAY)
+        {
+            markIsoWeeks(year, base, length, weekMask);
+        }
+        else
+        {
+            for (int weekYear = year - 1; weekYear <= year + 1; weekYear++)
+            {
+                // edge weeks of the neighbouring week-numbering years may spill into this one
+                const qint64 weekOne = weekOneStart(weekYear, m_plan->weekStart);
+                const int weeks = int((weekOneStart(weekYear + 1, m_plan->weekStart) - weekOne) / 7);
+
+                for (int weekNo : m_plan->byWeekNo)
+                {
+                    int week = weekNo > 0 ? weekNo : weeks + weekNo + 1;
+                    if (weekNo == 0 || week < 1 || week > weeks)
+                    {
+                        continue;
+                    }
+
+                    for (int k = 0; k < 7; k++)
+                    {
+                        qint64 jd = weekOne + 7 * (week - 1) + k;
+                        if (jd >= base && jd < base + length && (weekMask & (1 << (dayOfWeek(jd) - 1))))
+                        {
+                            m_scratch[jd - base] = 1;
+                        }
+                    }
+                }
+            }
+        }
+        intersectMarks(0, length);
+    }
+
+    if (!m_plan->byYearDay.isEmpty())
+    {
+        m_scratch.assign(length, 0);
+        for (int yearDay : m_plan->byYearDay)
+        {
+            int k = yearDay > 0 ? yearDay - 1 : length + yearDay;
+            if (yearDay != 0 && k >= 0 && k < length)
+            {
+                m_scratch[k] = 1;
+            }
+        }
+        intersectMarks(0, length);
+    }
+
+    if (!m_plan->byMonthDay.isEmpty())
+    {
+        m_scratch.assign(length, 0);
+        for (int month = 1; month <= 12; month++)
+        {
+            QDate first(year, month, 1);
+            markMonthDays(jan1.daysTo(first), first.daysInMonth());
+        }
+        intersectMarks(0, length);
+    }
+
+    if (!m_plan->byDay.isEmpty() && m_plan->byWeekNo.isEmpty())
+    {
+        m_scratch.assign(length, 0);
+        if (m_plan->monthMask)
+        {
+            for (int month = 1; month <= 12; month++)
+            {
+                if (m_plan->monthMask & (1 << month))
+                {
+                    QDate first(year, month, 1);
+                    markWeekDays(jan1.daysTo(first), first.daysInMonth(), first.dayOfWeek(), true);
+                }
+            }
+        }
+        else
+        {
+            markWeekDays(0, length, jan1.dayOfWeek(), true);
+        }
+        intersectMarks(0, length);
+    }
+
+    collectMarks(base);
+}
+
+void QiCalRecurrence::monthDays(int year, int month)
+{
+    const QDate first(year, month, 1);
+    const qint64 base = first.toJulianDay();
+    const int length = first.daysInMonth();
+
+    if (m_plan->byMonthDay.isEmpty() && m_plan->byDay.isEmpty())
+    {
+        if (m_startDate.day() <= length)
+        {
+            m_days.push_back(base + m_startDate.day() - 1);
+        }
+        return;
+    }
+
+    m_marks.assign(length, 1);
+
+    if (!m_plan->byMonthDay.isEmpty())
+    {
+        m_scratch.assign(length, 0);
+        markMonthDays(0, length);
+        intersectMarks(0, length);
+    }
+
+    if (!m_plan->byDay.isEmpty())
+    {
+        m_scratch.assign(length, 0);
+        markWeekDays(0, length, first.dayOfWeek(), true);
+        intersectMarks(0, length);
+    }
+
+    collectMarks(base);
+}
+
+void QiCalRecurrence::weekDays(qint64 weekFirst)
+{
+    for (int i = 0; i < m_weekOffsetCount; i++)
+    {
+        const qint64 jd = weekFirst + m_weekOffsets[i];
+        if (m_plan->monthMask && !(m_plan->monthMask & (1 << QDate::fromJulianDay(jd).month())))
+        {
+            continue;
+        }
+
+        m_days.push_back(jd);
+    }
+}
+
+void QiCalRecurrence::markWeekDays(int offset, int length, int firstDow, bool ordinals)
+{
+    for (const QiCalRulePlan::ByDay& day : m_plan->byDay)
+    {
+        const int first = (day.dayOfWeek - firstDow + 7) % 7;
+
+        if (day.ordinal == 0 || !ordinals)
+        {
+            for (int k = first; k < length; k += 7)
+            {
+                m_scratch[offset + k] = 1;
+            }
+            continue;
+        }
+
+        const int last = first + 7 * ((length - 1 - first) / 7);
+        const int k = day.ordinal > 0 ? first + 7 * (day.ordinal - 1) : last + 7 * (day.ordinal + 1);
+        if (k >= 0 && k < length)
+        {
+            m_scratch[offset + k] = 1;
+        }
+    }
+}
+
+void QiCalRecurrence::markMonthDays(int offset, int length)
+{
+    for (int day : m_plan->byMonthDay)
+    {
+        const int k = day > 0 ? day - 1 : length + day;
+        if (day != 0 && k >= 0 && k < length)
+        {
+            m_scratch[offset + k] = 1;
+        }
+    }
+}
+
+void QiCalRecurrence::markIsoWeeks(int year, qint64 base, int length, quint8 weekMask)
+{
+    // with a Monday week start the week numbers are the ISO ones, so the whole year converts in one batch
+    m_civilPeriod = -1;
+    m_civilJd.resize(std::max(CIVIL_BLOCK, length));
+    m_isoWeek.resize(length);
+    m_isoWeekYear.resize(length);
+    for (int i = 0; i < length; i++)
+    {
+        m_civilJd[i] = qint32(base + i);
+    }
+
+    QiCalCivil::isoWeeks(m_civilJd.data(), length, m_isoWeek.data(), m_isoWeekYear.data());
+
+    int weeks[3];
+    for (int i = 0; i < 3; i++)
+    {
+        weeks[i] = int((weekOneStart(year + i, Qt::Monday) - weekOneStart(year + i - 1, Qt::Monday)) / 7);
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+        const int week = m_isoWeek[i];
+        const int negWeek = week - weeks[m_isoWeekYear[i] - year + 1] - 1;
+        if ((weekMask & (1 << (dayOfWeek(base + i) - 1)))
+                && (std::binary_search(m_plan->byWeekNo.begin(), m_plan->byWeekNo.end(), week)
+                    || std::binary_search(m_plan->byWeekNo.begin(), m_plan->byWeekNo.end(), negWeek)))
+        {
+            m_scratch[i] = 1;
+        }
+    }
+}
+
+void QiCalRecurrence::intersectMarks(int offset, int length)
+{
+    for (int i = offset; i < offset + length; i++)
+    {
+        m_marks[i] = m_marks[i] && m_scratch[i];
+    }
+}
+
+void QiCalRecurrence::collectMarks(qint64 base)
+{
+    for (size_t i = 0; i < m_marks.size(); i++)
+    {
+        if (m_marks[i])
+        {
+            m_days.push_back(base + qint64(i));
+        }
+    }
+}
+
+void QiCalRecurrence::expandDays()
+{
+    for (qint64 jd : m_days)
+    {
+        for (int time : m_times)
+        {
+            m_buffer.push_back(jd * SECS_PER_DAY + time);
+        }
+    }
+}
+
+void QiCalRecurrence::applySetPos()
+{
+    if (m_plan->bySetPos.isEmpty() || m_buffer.isEmpty())
+    {
+        return;
+    }
+
+    const int size = m_buffer.size();
+    QVector<qint64> selected;
+
+    for (int pos : m_plan->bySetPos)
+    {
+        const int idx = pos > 0 ? pos - 1 : size + pos;
+        if (pos != 0 && idx >= 0 && idx < size)
+        {
+            selected.push_back(m_buffer[idx]);
+        }
+    }
+
+    std::sort(selected.begin(), selected.end());
+    selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+    m_buffer = selected;
+}
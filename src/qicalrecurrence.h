@@ -0,0 +1,130 @@
+#ifndef QICALRECURRENCE_H
+#define QICALRECURRENCE_H
+
+#include <QDateTime>
+#include <QList>
+#include <QVector>
+#include <QSharedPointer>
+
+#include <vector>
+
+#include "qicalrule.h"
+#include "qicalruleplan.h"
+#include "qicalzonetable.h"
+#include "qicalendar_global.h"
+
+class QICALENDARSHARED_EXPORT QiCalRecurrence
+{
+public:
+    explicit QiCalRecurrence(const QiCalRule* rule);
+    QiCalRecurrence(const QiCalRule* rule, const QDateTime& dtStart);
+
+    void reset(const QDateTime& from = QDateTime());
+    void skipTo(const QDateTime& from);
+    void setLimit(const QDateTime& limit);
+
+    bool hasNext();
+    QDateTime peek();
+    QDateTime next();
+
+    QList<QDateTime> between(const QDateTime& from, const QDateTime& to);
+
+    QDateTime occurrenceAt(qint64 index) const;
+    qint64 indexOf(const QDateTime& occurrence) const;
+    bool isOccurrence(const QDateTime& occurrence) const;
+    QDateTime lastOccurrence() const;
+
+    QDateTime dtStart() const;
+
+    QDateTime toDateTime(qint64 wall) const;
+    qint64 toWall(const QDateTime& dateTime) const;
+
+private:
+    void init(const QiCalRule* rule);
+    bool fetch();
+    bool fetchRule();
+    void consume();
+    qint64 firstPeriod(qint64 fromWall) const;
+    void nextPeriod();
+    qint64 buildPeriod(qint64 period);
+    qint64 buildSubDailyPeriod(qint64 period);
+    qint64 subDailyUnit() const;
+    bool outOfRange(qint64 lower) const;
+    void dropGapDuplicates();
+    qint32 gapBefore(qint64 wall) const;
+    bool isCandidate(qint64 wall) const;
+
+    void initClosedForm();
+    int candidatesAfterStart() const;
+    qint64 countBefore(qint64 period);
+    qint64 periodOf(qint64 wall) const;
+
+    QDateTime ruleOccurrenceAt(qint64 index) const;
+    qint64 ruleIndexOf(qint64 wall) const;
+    qint64 ruleCountBefore(qint64 wall) const;
+    QDateTime ruleLastOccurrence() const;
+    qint64 instanceWall(const QDateTime& occurrence) const;
+    QVector<qint64> extraDates() const;
+    QVector<qint64> excludedIndexes() const;
+
+    bool dayMatches(const QDate& date, bool subDaily) const;
+    bool dayMatches(int year, int month, int day, int dayOfWeek) const;
+    bool dailyMatches(qint64 period);
+    void yearDays(int year);
+    void monthDays(int year, int month);
+    void weekDays(qint64 weekFirst);
+    void markWeekDays(int offset, int length, int firstDow, bool ordinals);
+    void markMonthDays(int offset, int length);
+    void markIsoWeeks(int year, qint64 base, int length, quint8 weekMask);
+    void intersectMarks(int offset, int length);
+    void collectMarks(qint64 base);
+    void expandDays();
+    void applySetPos();
+
+    QSharedPointer<const QiCalRulePlan> m_plan;
+    bool m_hasUntil;
+    qint64 m_untilWall;
+
+    int m_weekOffsets[7];
+    int m_weekOffsetCount;
+    QVector<int> m_times;
+    bool m_closedForm;
+    qint64 m_perPeriod;
+    qint64 m_firstPeriodCount;
+
+    QDateTime m_start;
+    QSharedPointer<const QiCalZoneTable> m_zone;
+    qint64 m_startWall;
+    qint64 m_startJd;
+    QDate m_startDate;
+    qint64 m_week0;
+
+    qint64 m_period;
+    qint64 m_index;
+    qint64 m_fromWall;
+    qint64 m_fromCut;
+    qint64 m_limitWall;
+    qint64 m_lastWall;
+    bool m_done;
+    bool m_checkGaps;
+    QVector<qint64> m_buffer;
+    int m_pos;
+    qint64 m_nextWall;
+    QVector<qint64> m_rDates;
+    QVector<qint64> m_exDates;
+    int m_rDatePos;
+    int m_exDatePos;
+    QVector<qint64> m_days;
+    std::vector<char> m_marks;
+    std::vector<char> m_scratch;
+    qint64 m_civilPeriod;
+    std::vector<qint32> m_civilJd;
+    std::vector<qint32> m_civilYear;
+    std::vector<qint32> m_civilMonth;
+    std::vector<qint32> m_civilDay;
+    std::vector<qint32> m_civilDayOfWeek;
+    std::vector<qint32> m_isoWeek;
+    std::vector<qint32> m_isoWeekYear;
+};
+
+#endif // QICALRECURRENCE_H
@@ -1,10 +1,25 @@
 #include "qicalrule.h"
+#include "qicalrecurrence.h"
+#include "qicalruleplan.h"
+#include "qicalevent.h"
 
 QiCalRule::QiCalRule(QObject *parent) : QObject(parent),
     m_count(-1),
     m_interval(1),
-    m_event(nullptr)
-{
+    m_event(nullptr),
+    m_byDayMask(0),
+    m_weekStart(Qt::Monday)
+{
+    for (auto changed : { &QiCalRule::freqChanged, &QiCalRule::untilChanged, &QiCalRule::countChanged,
+                          &QiCalRule::intervalChanged, &QiCalRule::bySecondChanged, &QiCalRule::byMinuteChanged,
+                          &QiCalRule::byHourChanged, &QiCalRule::byDayChanged, &QiCalRule::byMonthDayChanged,
+                          &QiCalRule::byYearDayChanged, &QiCalRule::byWeekNoChanged, &QiCalRule::byMonthChanged,
+                          &QiCalRule::bySetPosChanged, &QiCalRule::wkstChanged })
+    {
+        connect(this, changed, this, &QiCalRule::invalidatePlan);
+    }
+
+    connect(this, &QiCalRule::calEventChanged, this, &QiCalRule::invalidateOccurrences);
 }
 
 QiCalRule::Freq QiCalRule::freq() const
@@ -125,12 +140,14 @@ QList<QString> QiCalRule::byDay() const
 void QiCalRule::setByDay(const QList<QString> &byDay)
 {
     m_byDay = byDay;
+    updateByDayMask();
     emit byDayChanged();
 }
 
 void QiCalRule::setDayList(const QString &day)
 {
     m_byDay = day.split(",");
+    updateByDayMask();
     emit byDayChanged();
 }
 
@@ -257,9 +274,27 @@ QString QiCalRule::wkst() const
 void QiCalRule::setWkst(const QString &Wkst)
 {
     m_wkst = Wkst;
+    int day = weekDayNumber(m_wkst);
+    m_weekStart = day > 0 ? (Qt::DayOfWeek)day : Qt::Monday;
     emit wkstChanged();
 }
 
+quint8 QiCalRule::byDayMask() const
+{
+    return m_byDayMask;
+}
+
+Qt::DayOfWeek QiCalRule::weekStart() const
+{
+    return m_weekStart;
+}
+
+int QiCalRule::weekDayNumber(const QString &day)
+{
+    static const QStringList names = { "MO", "TU", "WE", "TH", "FR", "SA", "SU" };
+    return names.indexOf(day.right(2)) + 1;
+}
+
 QiCalEvent *QiCalRule::calEvent() const
 {
     return m_event;
@@ -267,10 +302,112 @@ QiCalEvent *QiCalRule::calEvent() const
 
 void QiCalRule::setCalEvent(QiCalEvent *event)
 {
+    for (const QMetaObject::Connection& connection : m_eventConnections)
+    {
+        disconnect(connection);
+    }
+
+    m_eventConnections.clear();
     m_event = event;
+
+    if (m_event != nullptr)
+    {
+        for (auto changed : { &QiCalEvent::dtStartChanged, &QiCalEvent::exDatesChanged, &QiCalEvent::rDatesChanged, &QiCalEvent::zoneChanged })
+        {
+            m_eventConnections.push_back(connect(m_event, changed, this, &QiCalRule::invalidateOccurrences));
+        }
+    }
+
     emit calEventChanged();
 }
 
+QSharedPointer<const QiCalRulePlan> QiCalRule::plan() const
+{
+    if (m_plan.isNull())
+    {
+        m_plan = QiCalRulePlan::compile(this);
+    }
+
+    return m_plan;
+}
+
+void QiCalRule::setPlan(const QSharedPointer<const QiCalRulePlan> &plan)
+{
+    m_plan = plan;
+    invalidateOccurrences();
+}
+
+QiCalRecurrence QiCalRule::occurrences(const QDateTime &from) const
+{
+    QiCalRecurrence recurrence(this);
+    recurrence.reset(from);
+
+    return recurrence;
+}
+
+QVector<qint64> QiCalRule::occurrencesBetween(const QDateTime &from, const QDateTime &to)
+{
+    if (m_event == nullptr)
+    {
+        return QVector<qint64>();
+    }
+
+    return m_occurrences.range(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch(), [this](qint64 rangeFrom, qint64 rangeTo) {
+        QVector<qint64> ret;
+        QiCalRecurrence recurrence(this);
+        for (const QDateTime& occurrence : recurrence.between(QDateTime::fromMSecsSinceEpoch(rangeFrom), QDateTime::fromMSecsSinceEpoch(rangeTo)))
+        {
+            ret.push_back(occurrence.toMSecsSinceEpoch());
+        }
+
+        return ret;
+    });
+}
+
+QDateTime QiCalRule::occurrenceAt(qint64 index) const
+{
+    return QiCalRecurrence(this).occurrenceAt(index);
+}
+
+qint64 QiCalRule::occurrenceIndex(const QDateTime &occurrence) const
+{
+    return QiCalRecurrence(this).indexOf(occurrence);
+}
+
+bool QiCalRule::isOccurrence(const QDateTime &occurrence) const
+{
+    return occurrenceIndex(occurrence) >= 0;
+}
+
+QDateTime QiCalRule::lastOccurrence() const
+{
+    return QiCalRecurrence(this).lastOccurrence();
+}
+
+void QiCalRule::invalidateOccurrences()
+{
+    m_occurrences.clear();
+}
+
+void QiCalRule::invalidatePlan()
+{
+    m_plan.reset();
+    invalidateOccurrences();
+}
+
+void QiCalRule::updateByDayMask()
+{
+    m_byDayMask = 0;
+    for (const QString& day : m_byDay)
+    {
+        int num = weekDayNumber(day);
+        if (num > 0)
+        {
+            m_byDayMask |= 1 << (num - 1);
+        }
+    }
+}
+
 void QiCalRule::fillIntList(const QString &strList, QList<qint32> &list)
 {
     list.clear();
@@ -5,8 +5,15 @@
 #include <QDateTime>
 #include <QString>
 #include <QList>
+#include <QVector>
+#include <QMetaObject>
+#include <QSharedPointer>
+
+#include "qicaloccurrencecache.h"
 
 class QiCalEvent;
+class QiCalRecurrence;
+struct QiCalRulePlan;
 
 class QiCalRule : public QObject
 {
@@ -110,9 +117,25 @@ public:
     QString wkst() const;
     void setWkst(const QString &wkst);
 
+    quint8 byDayMask() const;
+    Qt::DayOfWeek weekStart() const;
+
+    static int weekDayNumber(const QString& day);
+
     QiCalEvent *calEvent() const;
     void setCalEvent(QiCalEvent *event);
 
+    QSharedPointer<const QiCalRulePlan> plan() const;
+    void setPlan(const QSharedPointer<const QiCalRulePlan>& plan);
+
+    QiCalRecurrence occurrences(const QDateTime& from = QDateTime()) const;
+    QVector<qint64> occurrencesBetween(const QDateTime& from, const QDateTime& to);
+    QDateTime occurrenceAt(qint64 index) const;
+    qint64 occurrenceIndex(const QDateTime& occurrence) const;
+    bool isOccurrence(const QDateTime& occurrence) const;
+    QDateTime lastOccurrence() const;
+    void invalidateOccurrences();
+
 signals:
     void freqChanged();
     void untilChanged();
@@ -146,6 +169,14 @@ private:
     QList<qint32> m_bySetPos;
     QString m_wkst;
     QiCalEvent *m_event;
+    quint8 m_byDayMask;
+    Qt::DayOfWeek m_weekStart;
+    mutable QSharedPointer<const QiCalRulePlan> m_plan;
+    QiCalOccurrenceCache m_occurrences;
+    QList<QMetaObject::Connection> m_eventConnections;
+
+    void updateByDayMask();
+    void invalidatePlan();
 
     void fillIntList(const QString& strList, QList<qint32>& list);
     QString getIntList(const QList<qint32>& list) const;
@@ -0,0 +1,73 @@
+#include "qicalruleplan.h"
+
+#include <algorithm>
+
+namespace
+{
+
+QVector<int> sortedList(const QList<qint32>& list)
+{
+    QVector<int> ret;
+    for (qint32 val : list)
+    {
+        ret.push_back(val);
+    }
+
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+
+    return ret;
+}
+
+template<typename T>
+T bitMask(const QVector<int>& list, int maxValue)
+{
+    T mask = 0;
+    for (int val : list)
+    {
+        if (val >= 0 && val <= maxValue)
+        {
+            mask |= T(1) << val;
+        }
+    }
+
+    return mask;
+}
+
+}
+
+QSharedPointer<const QiCalRulePlan> QiCalRulePlan::compile(const QiCalRule *rule)
+{
+    QSharedPointer<QiCalRulePlan> plan(new QiCalRulePlan());
+
+    plan->freq = rule->freq();
+    plan->interval = std::max(rule->interval(), 1);
+    plan->count = rule->count();
+    plan->until = rule->until();
+
+    plan->bySecond = sortedList(rule->bySecond());
+    plan->byMinute = sortedList(rule->byMinute());
+    plan->byHour = sortedList(rule->byHour());
+    plan->byMonthDay = sortedList(rule->byMonthDay());
+    plan->byYearDay = sortedList(rule->byYearDay());
+    plan->byWeekNo = sortedList(rule->byWeekNo());
+    plan->bySetPos = sortedList(rule->bySetPos());
+
+    for (const QString& day : rule->byDay())
+    {
+        int dow = QiCalRule::weekDayNumber(day);
+        if (dow > 0)
+        {
+            plan->byDay.push_back({ day.left(day.size() - 2).toInt(), dow });
+        }
+    }
+
+    plan->monthMask = bitMask<quint16>(sortedList(rule->byMonth()), 12) & ~quint16(1);
+    plan->dayMask = rule->byDayMask();
+    plan->hourMask = bitMask<quint32>(plan->byHour, 23);
+    plan->minuteMask = bitMask<quint64>(plan->byMinute, 59);
+    plan->secondMask = bitMask<quint64>(plan->bySecond, 60);
+    plan->weekStart = rule->weekStart();
+
+    return plan;
+}
@@ -0,0 +1,43 @@
+#ifndef QICALRULEPLAN_H
+#define QICALRULEPLAN_H
+
+#include <QDateTime>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "qicalrule.h"
+#include "qicalendar_global.h"
+
+struct QICALENDARSHARED_EXPORT QiCalRulePlan
+{
+    struct ByDay
+    {
+        int ordinal;
+        int dayOfWeek;
+    };
+
+    static QSharedPointer<const QiCalRulePlan> compile(const QiCalRule* rule);
+
+    QiCalRule::Freq freq;
+    qint64 interval;
+    qint32 count;
+    QDateTime until;
+
+    QVector<int> bySecond;
+    QVector<int> byMinute;
+    QVector<int> byHour;
+    QVector<int> byMonthDay;
+    QVector<int> byYearDay;
+    QVector<int> byWeekNo;
+    QVector<int> bySetPos;
+    QVector<ByDay> byDay;
+
+    quint16 monthMask;
+    quint8 dayMask;
+    quint32 hourMask;
+    quint64 minuteMask;
+    quint64 secondMask;
+    int weekStart;
+};
+
+#endif // QICALRULEPLAN_H
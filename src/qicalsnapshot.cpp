@@ -0,0 +1,762 @@
+#include "qicalsnapshot.h"
+#include "qicalzoneregistry.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+const char MAGIC[4] = { 'Q', 'I', 'C', 'S' };
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+const qint32 NO_INDEX = -1;
+const quint32 FLAG_ALL_DAY = 0x1;
+
+QiCalSnapshot::DateTime fromDateTime(const QDateTime& dateTime)
+{
+    QiCalSnapshot::DateTime record = { 0, 0, -1 };
+    if (!dateTime.isValid())
+    {
+        return record;
+    }
+
+    switch (dateTime.timeSpec()) {
+    case Qt::LocalTime:
+        record.msecs = QDateTime(dateTime.date(), dateTime.time(), Qt::UTC).toMSecsSinceEpoch();
+        record.spec = Qt::LocalTime;
+        break;
+    case Qt::UTC:
+        record.msecs = dateTime.toMSecsSinceEpoch();
+        record.spec = Qt::UTC;
+        break;
+    default:
+        record.msecs = dateTime.toMSecsSinceEpoch();
+        record.offset = dateTime.offsetFromUtc();
+        record.spec = Qt::OffsetFromUTC;
+        break;
+    }
+
+    return record;
+}
+
+template <typename T>
+QiCalSnapshot::Table appendTable(QByteArray& data, const T* records, int count)
+{
+    data.append(QByteArray((8 - data.size() % 8) % 8, '\0'));
+
+    QiCalSnapshot::Table table = { quint32(data.size()), quint32(count) };
+    data.append(reinterpret_cast<const char*>(records), int(sizeof(T)) * count);
+
+    return table;
+}
+
+struct Builder
+{
+    QVector<QiCalSnapshot::EventRecord> events;
+    QVector<QiCalSnapshot::RuleRecord> rules;
+    QVector<QiCalSnapshot::ZoneRecord> zones;
+    QVector<QiCalSnapshot::TzInfoRecord> tzInfos;
+    QVector<QiCalZoneTable::Transition> transitions;
+    QVector<QiCalSnapshot::AlarmRecord> alarms;
+    QVector<qint64> dates;
+    QVector<qint32> ints;
+    QByteArray strings;
+    QHash<QString, QiCalSnapshot::StringRef> stringIndex;
+    QHash<const QiCalZoneTable*, qint32> zoneIndex;
+
+    QiCalSnapshot::StringRef string(const QString& value)
+    {
+        QiCalSnapshot::StringRef ref = { 0, 0 };
+        if (value.isEmpty())
+        {
+            return ref;
+        }
+
+        auto found = stringIndex.constFind(value);
+        if (found != stringIndex.constEnd())
+        {
+            return found.value();
+        }
+
+        const QByteArray utf8 = value.toUtf8();
+        ref.offset = quint32(strings.size());
+        ref.length = quint32(utf8.size());
+        strings.append(utf8);
+        stringIndex.insert(value, ref);
+
+        return ref;
+    }
+
+    QiCalSnapshot::ListRef dateList(const QVector<qint64>& values)
+    {
+        QiCalSnapshot::ListRef ref = { quint32(dates.size()), quint32(values.size()) };
+        dates += values;
+
+        return ref;
+    }
+
+    QiCalSnapshot::ListRef intList(const QList<qint32>& values)
+    {
+        QiCalSnapshot::ListRef ref = { quint32(ints.size()), quint32(values.size()) };
+        for (qint32 value : values)
+        {
+            ints.push_back(value);
+        }
+
+        return ref;
+    }
+
+    qint32 rule(const QiCalRule* rule)
+    {
+        if (rule == nullptr)
+        {
+            return NO_INDEX;
+        }
+
+        QiCalSnapshot::RuleRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.until = fromDateTime(rule->until());
+        record.freq = rule->freq();
+        record.count = rule->count();
+        record.interval = rule->interval();
+        record.bySecond = intList(rule->bySecond());
+        record.byMinute = intList(rule->byMinute());
+        record.byHour = intList(rule->byHour());
+        record.byMonthDay = intList(rule->byMonthDay());
+        record.byYearDay = intList(rule->byYearDay());
+        record.byWeekNo = intList(rule->byWeekNo());
+        record.byMonth = intList(rule->byMonth());
+        record.bySetPos = intList(rule->bySetPos());
+        record.byDay = string(rule->dayList());
+        record.wkst = string(rule->wkst());
+
+        rules.push_back(record);
+
+        return rules.size() - 1;
+    }
+
+    qint32 zone(const QSharedPointer<const QiCalZoneTable>& table, const QiCalTimeZone* timeZone)
+    {
+        if (table.isNull())
+        {
+            return NO_INDEX;
+        }
+
+        auto found = zoneIndex.constFind(table.data());
+        if (found != zoneIndex.constEnd())
+        {
+            return found.value();
+        }
+
+        QiCalSnapshot::ZoneRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.tzId = string(table->tzId());
+        record.fromYear = table->fromYear();
+        record.toYear = table->toYear();
+        record.initialOffset = table->initialOffset();
+        record.embedded = timeZone != nullptr;
+        record.transitions.first = quint32(transitions.size());
+        record.transitions.count = quint32(table->transitions().size());
+        transitions += table->transitions();
+
+        record.tzInfos.first = quint32(tzInfos.size());
+        if (timeZone != nullptr)
+        {
+            for (const QiCalTzInfo* info : timeZone->observances())
+            {
+                QiCalSnapshot::TzInfoRecord infoRecord;
+                std::memset(&infoRecord, 0, sizeof(infoRecord));
+                infoRecord.dtStart = fromDateTime(info->dtStart());
+                infoRecord.offsetFrom = info->offsetFrom();
+                infoRecord.offsetTo = info->offsetTo();
+                infoRecord.tzName = string(info->tzName());
+                infoRecord.rDates = dateList(info->rDates());
+                infoRecord.rule = rule(info->rule());
+                infoRecord.dayLight = info->isDayLight();
+
+                tzInfos.push_back(infoRecord);
+            }
+        }
+        record.tzInfos.count = quint32(tzInfos.size()) - record.tzInfos.first;
+
+        zones.push_back(record);
+        zoneIndex.insert(table.data(), zones.size() - 1);
+
+        return zones.size() - 1;
+    }
+
+    void event(const QiCalEvent* event)
+    {
+        QiCalSnapshot::EventRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.dtStart = fromDateTime(event->dtStart());
+        record.dtEnd = fromDateTime(event->dtEnd());
+        record.dtStamp = fromDateTime(event->dtStamp());
+        record.created = fromDateTime(event->created());
+        record.lastModified = fromDateTime(event->lastModified());
+        record.uid = string(event->uid());
+        record.summary = string(event->summary());
+        record.description = string(event->description());
+        record.location = string(event->location());
+        record.exDates = dateList(event->exDates());
+        record.rDates = dateList(event->rDates());
+        record.rule = rule(event->rule());
+        record.zone = zone(event->zone(), nullptr);
+        record.status = event->status();
+        record.transp = event->transp();
+        record.sequence = event->sequence();
+        record.flags = event->isAllDay() ? FLAG_ALL_DAY : 0;
+
+        record.alarms.first = quint32(alarms.size());
+        for (const QiCalAlarm* alarm : event->alarms())
+        {
+            QiCalSnapshot::AlarmRecord alarmRecord;
+            std::memset(&alarmRecord, 0, sizeof(alarmRecord));
+            alarmRecord.description = string(alarm->description());
+            alarmRecord.trigger = string(alarm->trigger());
+            alarmRecord.action = alarm->action();
+            alarmRecord.related = alarm->triggerRelated();
+
+            alarms.push_back(alarmRecord);
+        }
+        record.alarms.count = quint32(alarms.size()) - record.alarms.first;
+
+        const qint64 duration = event->dtEnd().isValid() ? event->dtStart().msecsTo(event->dtEnd()) : 0;
+        record.lastEnd = event->dtStart().toMSecsSinceEpoch() + duration;
+
+        const QiCalRule* eventRule = event->rule();
+        if (eventRule != nullptr)
+        {
+            if (eventRule->count() > 0 || eventRule->until().isValid())
+            {
+                const QDateTime last = eventRule->lastOccurrence();
+                if (last.isValid())
+                {
+                    record.lastEnd = qMax(record.lastEnd, last.toMSecsSinceEpoch() + duration);
+                }
+            }
+            else
+            {
+                record.lastEnd = std::numeric_limits<qint64>::max();
+            }
+        }
+
+        for (qint64 rDate : event->rDates())
+        {
+            record.lastEnd = qMax(record.lastEnd, rDate + duration);
+        }
+
+        events.push_back(record);
+    }
+};
+
+}
+
+template <typename T>
+const T *QiCalSnapshot::table(const Table &table) const
+{
+    return reinterpret_cast<const T*>(m_data + table.offset);
+}
+
+QiCalSnapshot::QiCalSnapshot() :
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+QiCalSnapshot::~QiCalSnapshot()
+{
+    close();
+}
+
+bool QiCalSnapshot::open(const QString &path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size >= qint64(sizeof(Header)))
+    {
+        m_data = m_file.map(0, m_size);
+    }
+
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    const Header& head = header();
+    const auto fits = [&](const Table& table, size_t recordSize) {
+        return table.offset % 8 == 0 && quint64(table.offset) + quint64(table.count) * recordSize <= quint64(m_size);
+    };
+
+    const bool valid = std::memcmp(head.magic, MAGIC, sizeof(MAGIC)) == 0
+            && head.version == VERSION
+            && head.byteOrder == BYTE_ORDER_MARK
+            && head.size == m_size
+            && fits(head.events, sizeof(EventRecord))
+            && fits(head.rules, sizeof(RuleRecord))
+            && fits(head.zones, sizeof(ZoneRecord))
+            && fits(head.tzInfos, sizeof(TzInfoRecord))
+            && fits(head.transitions, sizeof(QiCalZoneTable::Transition))
+            && fits(head.alarms, sizeof(AlarmRecord))
+            && fits(head.dates, sizeof(qint64))
+            && fits(head.ints, sizeof(qint32))
+            && fits(head.strings, 1);
+
+    if (!valid || !validate())
+    {
+        close();
+        return false;
+    }
+
+    m_zoneTables.resize(int(head.zones.count));
+
+    return true;
+}
+
+bool QiCalSnapshot::validate() const
+{
+    // every reference between tables is checked once here, so the accessors can index the mapping without bounds checks
+    const Header& head = header();
+    const auto stringFits = [&](const StringRef& ref) {
+        return quint64(ref.offset) + ref.length <= head.strings.count;
+    };
+    const auto listFits = [](const ListRef& ref, const Table& table) {
+        return quint64(ref.first) + ref.count <= table.count;
+    };
+    const auto indexFits = [](qint32 index, const Table& table) {
+        return index == NO_INDEX || (index >= 0 && quint32(index) < table.count);
+    };
+
+    if (!stringFits(head.prodId) || !stringFits(head.calendarVersion) || !stringFits(head.method))
+    {
+        return false;
+    }
+
+    for (quint32 i = 0; i < head.events.count; i++)
+    {
+        const EventRecord& record = table<EventRecord>(head.events)[i];
+        if (!stringFits(record.uid) || !stringFits(record.summary) || !stringFits(record.description) || !stringFits(record.location)
+                || !listFits(record.exDates, head.dates) || !listFits(record.rDates, head.dates) || !listFits(record.alarms, head.alarms)
+                || !indexFits(record.rule, head.rules) || !indexFits(record.zone, head.zones)
+                || record.status > quint32(QiCalEvent::STAT_CANCELLED) || record.transp > quint32(QiCalEvent::TRANS_TRANSPARENT))
+        {
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < head.alarms.count; i++)
+    {
+        const AlarmRecord& record = table<AlarmRecord>(head.alarms)[i];
+        if (!stringFits(record.description) || !stringFits(record.trigger)
+                || record.action > quint32(QiCalAlarm::ACT_EMAIL) || record.related > quint32(QiCalAlarm::REL_END))
+        {
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < head.rules.count; i++)
+    {
+        const RuleRecord& record = table<RuleRecord>(head.rules)[i];
+        const ListRef lists[] = { record.bySecond, record.byMinute, record.byHour, record.byMonthDay,
+                                  record.byYearDay, record.byWeekNo, record.byMonth, record.bySetPos };
+        for (const ListRef& list : lists)
+        {
+            if (!listFits(list, head.ints))
+            {
+                return false;
+            }
+        }
+
+        if (!stringFits(record.byDay) || !stringFits(record.wkst)
+                || record.freq < QiCalRule::RR_SECONDLY || record.freq > QiCalRule::RR_YEARLY)
+        {
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < head.zones.count; i++)
+    {
+        const ZoneRecord& record = table<ZoneRecord>(head.zones)[i];
+        if (!stringFits(record.tzId) || !listFits(record.transitions, head.transitions) || !listFits(record.tzInfos, head.tzInfos))
+        {
+            return false;
+        }
+    }
+
+    for (quint32 i = 0; i < head.tzInfos.count; i++)
+    {
+        const TzInfoRecord& record = table<TzInfoRecord>(head.tzInfos)[i];
+        if (!stringFits(record.tzName) || !listFits(record.rDates, head.dates) || !indexFits(record.rule, head.rules))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QiCalSnapshot::close()
+{
+    if (m_data != nullptr)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        m_data = nullptr;
+    }
+
+    m_file.close();
+    m_size = 0;
+    m_zoneTables.clear();
+}
+
+bool QiCalSnapshot::isValid() const
+{
+    return m_data != nullptr;
+}
+
+bool QiCalSnapshot::isStale(const QString &sourcePath) const
+{
+    if (!isValid())
+    {
+        return true;
+    }
+
+    const QFileInfo info(sourcePath);
+
+    return !info.exists()
+            || info.size() != header().sourceSize
+            || info.lastModified().toMSecsSinceEpoch() != header().sourceModified;
+}
+
+const QiCalSnapshot::Header &QiCalSnapshot::header() const
+{
+    return *reinterpret_cast<const Header*>(m_data);
+}
+
+int QiCalSnapshot::eventCount() const
+{
+    return isValid() ? int(header().events.count) : 0;
+}
+
+const QiCalSnapshot::EventRecord &QiCalSnapshot::event(int index) const
+{
+    return table<EventRecord>(header().events)[index];
+}
+
+const QiCalSnapshot::AlarmRecord &QiCalSnapshot::alarm(int index) const
+{
+    return table<AlarmRecord>(header().alarms)[index];
+}
+
+const QiCalSnapshot::RuleRecord &QiCalSnapshot::rule(int index) const
+{
+    return table<RuleRecord>(header().rules)[index];
+}
+
+const QiCalSnapshot::ZoneRecord &QiCalSnapshot::zone(int index) const
+{
+    return table<ZoneRecord>(header().zones)[index];
+}
+
+const QiCalSnapshot::TzInfoRecord &QiCalSnapshot::tzInfo(int index) const
+{
+    return table<TzInfoRecord>(header().tzInfos)[index];
+}
+
+const qint64 *QiCalSnapshot::dates(const ListRef &list) const
+{
+    if (quint64(list.first) + list.count > header().dates.count)
+    {
+        return nullptr;
+    }
+
+    return table<qint64>(header().dates) + list.first;
+}
+
+const qint32 *QiCalSnapshot::ints(const ListRef &list) const
+{
+    if (quint64(list.first) + list.count > header().ints.count)
+    {
+        return nullptr;
+    }
+
+    return table<qint32>(header().ints) + list.first;
+}
+
+QString QiCalSnapshot::string(const StringRef &ref) const
+{
+    if (ref.length == 0 || quint64(ref.offset) + ref.length > header().strings.count)
+    {
+        return QString();
+    }
+
+    return QString::fromUtf8(table<char>(header().strings) + ref.offset, int(ref.length));
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalSnapshot::zoneTable(int index) const
+{
+    if (index < 0 || index >= m_zoneTables.size())
+    {
+        return QSharedPointer<const QiCalZoneTable>();
+    }
+
+    if (m_zoneTables[index].isNull())
+    {
+        const ZoneRecord& record = zone(index);
+        m_zoneTables[index] = QiCalZoneRegistry::instance()->zoneTable(string(record.tzId), record.fromYear, record.toYear, record.initialOffset,
+                                                                       table<QiCalZoneTable::Transition>(header().transitions) + record.transitions.first,
+                                                                       int(record.transitions.count));
+    }
+
+    return m_zoneTables[index];
+}
+
+QVector<int> QiCalSnapshot::eventsBetween(const QDateTime &from, const QDateTime &to) const
+{
+    QVector<int> result;
+    const qint64 fromMsecs = from.toMSecsSinceEpoch();
+    const qint64 toMsecs = to.toMSecsSinceEpoch();
+
+    for (int i = 0; i < eventCount(); i++)
+    {
+        const EventRecord& record = event(i);
+        if (record.dtStart.spec >= 0 && record.dtStart.msecs < toMsecs && record.lastEnd >= fromMsecs)
+        {
+            result.push_back(i);
+        }
+    }
+
+    return result;
+}
+
+QiCalCalendar *QiCalSnapshot::toCalendar(QObject *parent) const
+{
+    if (!isValid())
+    {
+        return nullptr;
+    }
+
+    const auto dateVector = [&](const ListRef& ref) {
+        QVector<qint64> values;
+        const qint64* data = dates(ref);
+        for (quint32 i = 0; data != nullptr && i < ref.count; i++)
+        {
+            values.push_back(data[i]);
+        }
+        return values;
+    };
+
+    const Header& head = header();
+    QiCalCalendar* calendar = new QiCalCalendar(parent);
+    calendar->setProdId(string(head.prodId));
+    calendar->setVersion(string(head.calendarVersion));
+    calendar->setMethod(string(head.method));
+
+    for (int i = 0; i < int(head.zones.count); i++)
+    {
+        const ZoneRecord& record = zone(i);
+        if (!record.embedded)
+        {
+            continue;
+        }
+
+        QiCalTimeZone* timeZone = new QiCalTimeZone();
+        timeZone->setTzId(string(record.tzId));
+        timeZone->setHorizon(record.fromYear, record.toYear);
+
+        for (quint32 j = 0; j < record.tzInfos.count; j++)
+        {
+            const TzInfoRecord& infoRecord = tzInfo(int(record.tzInfos.first + j));
+            QiCalTzInfo* info = new QiCalTzInfo();
+            info->setDtStart(toDateTime(infoRecord.dtStart));
+            info->setOffsetFrom(infoRecord.offsetFrom);
+            info->setOffsetTo(infoRecord.offsetTo);
+            info->setTzName(string(infoRecord.tzName));
+            info->setRDates(dateVector(infoRecord.rDates));
+            if (infoRecord.rule != NO_INDEX)
+            {
+                info->setRule(createRule(infoRecord.rule));
+            }
+
+            if (infoRecord.dayLight)
+            {
+                timeZone->setDayLight(info);
+            }
+            else
+            {
+                timeZone->setStandard(info);
+            }
+        }
+
+        calendar->addTimeZone(timeZone);
+    }
+
+    for (int i = 0; i < eventCount(); i++)
+    {
+        const EventRecord& record = event(i);
+        QiCalEvent* event = new QiCalEvent();
+        event->setZone(zoneTable(record.zone));
+        event->setDtStart(toDateTime(record.dtStart));
+        event->setDtEnd(toDateTime(record.dtEnd));
+        event->setDtStamp(toDateTime(record.dtStamp));
+        event->setCreated(toDateTime(record.created));
+        event->setLastModified(toDateTime(record.lastModified));
+        event->setUid(string(record.uid));
+        event->setSummary(string(record.summary));
+        event->setDescription(string(record.description));
+        event->setLocation(string(record.location));
+        event->setStatus(QiCalEvent::Status(record.status));
+        event->setTransp(QiCalEvent::Transp(record.transp));
+        event->setSequence(record.sequence);
+        event->setAllDay(record.flags & FLAG_ALL_DAY);
+
+        event->setExDates(dateVector(record.exDates));
+        event->setRDates(dateVector(record.rDates));
+
+        for (quint32 j = 0; j < record.alarms.count; j++)
+        {
+            const AlarmRecord& alarmRecord = alarm(int(record.alarms.first + j));
+            QiCalAlarm* alarm = new QiCalAlarm();
+            alarm->setAction(QiCalAlarm::Action(alarmRecord.action));
+            alarm->setDescription(string(alarmRecord.description));
+            alarm->setTriggerRelated(QiCalAlarm::Related(alarmRecord.related));
+            alarm->setTrigger(string(alarmRecord.trigger));
+            event->addAlarm(alarm);
+        }
+
+        if (record.rule != NO_INDEX)
+        {
+            QiCalRule* rule = createRule(record.rule);
+            event->setRule(rule);
+            rule->setCalEvent(event);
+            calendar->addRule(rule);
+        }
+
+        calendar->addEvent(event);
+    }
+
+    return calendar;
+}
+
+QDateTime QiCalSnapshot::toDateTime(const DateTime &dateTime)
+{
+    switch (dateTime.spec) {
+    case Qt::LocalTime:
+    {
+        const QDateTime wall = QDateTime::fromMSecsSinceEpoch(dateTime.msecs, Qt::UTC);
+        return QDateTime(wall.date(), wall.time());
+    }
+    case Qt::UTC:
+        return QDateTime::fromMSecsSinceEpoch(dateTime.msecs, Qt::UTC);
+    case Qt::OffsetFromUTC:
+        return QDateTime::fromMSecsSinceEpoch(dateTime.msecs, Qt::OffsetFromUTC, dateTime.offset);
+    default:
+        return QDateTime();
+    }
+}
+
+bool QiCalSnapshot::save(const QiCalCalendar *calendar, const QString &path, const QString &sourcePath)
+{
+    if (calendar == nullptr)
+    {
+        return false;
+    }
+
+    Builder builder;
+    Header head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic, MAGIC, sizeof(MAGIC));
+    head.version = VERSION;
+    head.byteOrder = BYTE_ORDER_MARK;
+
+    if (!sourcePath.isEmpty())
+    {
+        const QFileInfo info(sourcePath);
+        head.sourceSize = info.size();
+        head.sourceModified = info.lastModified().toMSecsSinceEpoch();
+    }
+
+    head.prodId = builder.string(calendar->prodId());
+    head.calendarVersion = builder.string(calendar->version());
+    head.method = builder.string(calendar->method());
+
+    for (const QiCalTimeZone* timeZone : calendar->timeZones())
+    {
+        builder.zone(timeZone->zoneTable(), timeZone);
+    }
+
+    for (const QiCalEvent* event : calendar->events())
+    {
+        builder.event(event);
+    }
+
+    QByteArray data(int(sizeof(Header)), '\0');
+    head.events = appendTable(data, builder.events.constData(), builder.events.size());
+    head.rules = appendTable(data, builder.rules.constData(), builder.rules.size());
+    head.zones = appendTable(data, builder.zones.constData(), builder.zones.size());
+    head.tzInfos = appendTable(data, builder.tzInfos.constData(), builder.tzInfos.size());
+    head.transitions = appendTable(data, builder.transitions.constData(), builder.transitions.size());
+    head.alarms = appendTable(data, builder.alarms.constData(), builder.alarms.size());
+    head.dates = appendTable(data, builder.dates.constData(), builder.dates.size());
+    head.ints = appendTable(data, builder.ints.constData(), builder.ints.size());
+    head.strings = appendTable(data, builder.strings.constData(), builder.strings.size());
+    head.size = quint32(data.size());
+    std::memcpy(data.data(), &head, sizeof(head));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+    {
+        return false;
+    }
+
+    return file.commit();
+}
+
+QiCalRule *QiCalSnapshot::createRule(int index) const
+{
+    const RuleRecord& record = rule(index);
+    const auto list = [&](const ListRef& ref) {
+        QList<qint32> values;
+        const qint32* data = ints(ref);
+        for (quint32 i = 0; data != nullptr && i < ref.count; i++)
+        {
+            values.push_back(data[i]);
+        }
+        return values;
+    };
+
+    QiCalRule* rule = new QiCalRule();
+    rule->setFreq(QiCalRule::Freq(record.freq));
+    rule->setUntil(toDateTime(record.until));
+    rule->setCount(record.count);
+    rule->setInterval(record.interval);
+    rule->setBySecond(list(record.bySecond));
+    rule->setByMinute(list(record.byMinute));
+    rule->setByHour(list(record.byHour));
+    rule->setByMonthDay(list(record.byMonthDay));
+    rule->setByYearDay(list(record.byYearDay));
+    rule->setByWeekNo(list(record.byWeekNo));
+    rule->setByMonth(list(record.byMonth));
+    rule->setBySetPos(list(record.bySetPos));
+    if (record.byDay.length > 0)
+    {
+        rule->setDayList(string(record.byDay));
+    }
+    if (record.wkst.length > 0)
+    {
+        rule->setWkst(string(record.wkst));
+    }
+
+    return rule;
+}
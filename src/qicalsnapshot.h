@@ -0,0 +1,179 @@
+#ifndef QICALSNAPSHOT_H
+#define QICALSNAPSHOT_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "qicalcalendar.h"
+#include "qicalzonetable.h"
+#include "qicalendar_global.h"
+
+// Versioned binary image of a parsed calendar. The file is memory-mapped and its records are read in place.
+class QICALENDARSHARED_EXPORT QiCalSnapshot
+{
+public:
+    struct StringRef
+    {
+        quint32 offset;
+        quint32 length;
+    };
+
+    struct ListRef
+    {
+        quint32 first;
+        quint32 count;
+    };
+
+    struct Table
+    {
+        quint32 offset;
+        quint32 count;
+    };
+
+    struct DateTime
+    {
+        qint64 msecs;
+        qint32 offset;
+        qint32 spec;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 size;
+        qint64 sourceSize;
+        qint64 sourceModified;
+        StringRef prodId;
+        StringRef calendarVersion;
+        StringRef method;
+        Table events;
+        Table rules;
+        Table zones;
+        Table tzInfos;
+        Table transitions;
+        Table alarms;
+        Table dates;
+        Table ints;
+        Table strings;
+    };
+
+    struct EventRecord
+    {
+        DateTime dtStart;
+        DateTime dtEnd;
+        DateTime dtStamp;
+        DateTime created;
+        DateTime lastModified;
+        qint64 lastEnd;
+        StringRef uid;
+        StringRef summary;
+        StringRef description;
+        StringRef location;
+        ListRef exDates;
+        ListRef rDates;
+        ListRef alarms;
+        qint32 rule;
+        qint32 zone;
+        quint32 status;
+        quint32 transp;
+        qint32 sequence;
+        quint32 flags;
+    };
+
+    struct AlarmRecord
+    {
+        StringRef description;
+        StringRef trigger;
+        quint32 action;
+        quint32 related;
+    };
+
+    struct RuleRecord
+    {
+        DateTime until;
+        qint32 freq;
+        qint32 count;
+        qint32 interval;
+        qint32 reserved;
+        ListRef bySecond;
+        ListRef byMinute;
+        ListRef byHour;
+        ListRef byMonthDay;
+        ListRef byYearDay;
+        ListRef byWeekNo;
+        ListRef byMonth;
+        ListRef bySetPos;
+        StringRef byDay;
+        StringRef wkst;
+    };
+
+    struct ZoneRecord
+    {
+        StringRef tzId;
+        qint32 fromYear;
+        qint32 toYear;
+        qint32 initialOffset;
+        quint32 embedded;
+        ListRef transitions;
+        ListRef tzInfos;
+    };
+
+    struct TzInfoRecord
+    {
+        DateTime dtStart;
+        qint32 offsetFrom;
+        qint32 offsetTo;
+        StringRef tzName;
+        ListRef rDates;
+        qint32 rule;
+        quint32 dayLight;
+    };
+
+    QiCalSnapshot();
+    ~QiCalSnapshot();
+
+    bool open(const QString& path);
+    void close();
+    bool isValid() const;
+    bool isStale(const QString& sourcePath) const;
+
+    const Header& header() const;
+    int eventCount() const;
+    const EventRecord& event(int index) const;
+    const AlarmRecord& alarm(int index) const;
+    const RuleRecord& rule(int index) const;
+    const ZoneRecord& zone(int index) const;
+    const TzInfoRecord& tzInfo(int index) const;
+    const qint64* dates(const ListRef& list) const;
+    const qint32* ints(const ListRef& list) const;
+    QString string(const StringRef& ref) const;
+
+    QSharedPointer<const QiCalZoneTable> zoneTable(int index) const;
+    QVector<int> eventsBetween(const QDateTime& from, const QDateTime& to) const;
+    QiCalCalendar* toCalendar(QObject* parent = nullptr) const;
+
+    static QDateTime toDateTime(const DateTime& dateTime);
+    static bool save(const QiCalCalendar* calendar, const QString& path, const QString& sourcePath = QString());
+
+    static const quint32 VERSION = 3;
+
+private:
+    Q_DISABLE_COPY(QiCalSnapshot)
+
+    template <typename T>
+    const T* table(const Table& table) const;
+    bool validate() const;
+    QiCalRule* createRule(int index) const;
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    mutable QVector<QSharedPointer<const QiCalZoneTable> > m_zoneTables;
+};
+
+#endif // QICALSNAPSHOT_H
@@ -1,8 +1,11 @@
 #include "qicaltimezone.h"
+#include "qicalzoneregistry.h"
 
 QiCalTimeZone::QiCalTimeZone(QObject *parent) : QObject(parent),
     m_standard(nullptr),
-    m_dayLight(nullptr)
+    m_dayLight(nullptr),
+    m_fromYear(QiCalZoneTable::DEFAULT_FROM_YEAR),
+    m_toYear(QiCalZoneTable::DEFAULT_TO_YEAR)
 {
 }
 
@@ -14,6 +17,8 @@ QString QiCalTimeZone::tzId() const
 void QiCalTimeZone::setTzId(const QString &tzId)
 {
     m_tzId = tzId;
+    m_fingerprint.clear();
+    m_zoneTable.reset();
     emit tzIdChanged();
 }
 
@@ -24,8 +29,8 @@ QiCalTzInfo *QiCalTimeZone::standard() const
 
 void QiCalTimeZone::setStandard(QiCalTzInfo *standard)
 {
-    standard->setParent(this);
     m_standard = standard;
+    addObservance(standard);
     emit standardChanged();
 }
 
@@ -36,14 +41,71 @@ QiCalTzInfo *QiCalTimeZone::dayLight() const
 
 void QiCalTimeZone::setDayLight(QiCalTzInfo *dayLight)
 {
-    dayLight->setParent(this);
+    dayLight->setDayLight(true);
     m_dayLight = dayLight;
+    addObservance(dayLight);
     emit dayLightChanged();
 }
 
+QList<QiCalTzInfo *> QiCalTimeZone::observances() const
+{
+    return m_observances;
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalTimeZone::zoneTable() const
+{
+    if (m_zoneTable.isNull())
+    {
+        m_zoneTable = QiCalZoneRegistry::instance()->zoneTable(this, m_fromYear, m_toYear);
+    }
+
+    return m_zoneTable;
+}
+
+void QiCalTimeZone::setHorizon(int fromYear, int toYear)
+{
+    m_fromYear = fromYear;
+    m_toYear = toYear;
+    m_zoneTable.reset();
+}
+
+QByteArray QiCalTimeZone::fingerprint() const
+{
+    return m_fingerprint;
+}
+
+void QiCalTimeZone::setFingerprint(const QByteArray &fingerprint)
+{
+    // identifies the raw definition this zone was parsed from; any later edit of the zone or its observances drops it
+    m_fingerprint = fingerprint;
+    m_zoneTable.reset();
+}
+
+void QiCalTimeZone::invalidateTable()
+{
+    m_fingerprint.clear();
+    m_zoneTable.reset();
+}
+
+void QiCalTimeZone::addObservance(QiCalTzInfo *info)
+{
+    info->setParent(this);
+    m_observances.push_back(info);
+
+    for (auto changed : { &QiCalTzInfo::offsetFromChanged, &QiCalTzInfo::offsetToChanged, &QiCalTzInfo::tzNameChanged,
+                          &QiCalTzInfo::dtStartChanged, &QiCalTzInfo::ruleChanged, &QiCalTzInfo::rDatesChanged })
+    {
+        connect(info, changed, this, &QiCalTimeZone::invalidateTable);
+    }
+
+    invalidateTable();
+}
+
 QiCalTzInfo::QiCalTzInfo(QObject *parent) : QObject(parent),
     m_offsetFrom(0),
-    m_offsetTo(0)
+    m_offsetTo(0),
+    m_rule(nullptr),
+    m_dayLight(false)
 {
 }
 
@@ -100,5 +162,38 @@ void QiCalTzInfo::setRule(QiCalRule *rule)
 {
     rule->setParent(this);
     m_rule = rule;
+
+    // edits of the rule itself count as a change of the observance
+    for (auto changed : { &QiCalRule::freqChanged, &QiCalRule::untilChanged, &QiCalRule::countChanged,
+                          &QiCalRule::intervalChanged, &QiCalRule::bySecondChanged, &QiCalRule::byMinuteChanged,
+                          &QiCalRule::byHourChanged, &QiCalRule::byDayChanged, &QiCalRule::byMonthDayChanged,
+                          &QiCalRule::byYearDayChanged, &QiCalRule::byWeekNoChanged, &QiCalRule::byMonthChanged,
+                          &QiCalRule::bySetPosChanged, &QiCalRule::wkstChanged })
+    {
+        connect(rule, changed, this, &QiCalTzInfo::ruleChanged);
+    }
+
     emit ruleChanged();
 }
+
+QVector<qint64> QiCalTzInfo::rDates() const
+{
+    return m_rDates;
+}
+
+void QiCalTzInfo::setRDates(const QVector<qint64> &rDates)
+{
+    m_rDates = rDates;
+    emit rDatesChanged();
+}
+
+bool QiCalTzInfo::isDayLight() const
+{
+    return m_dayLight;
+}
+
+void QiCalTzInfo::setDayLight(bool dayLight)
+{
+    m_dayLight = dayLight;
+    emit dayLightChanged();
+}
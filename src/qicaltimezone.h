@@ -1,11 +1,15 @@
 #ifndef QICALTIMEZONE_H
 #define QICALTIMEZONE_H
 
+#include <QByteArray>
 #include <QObject>
 #include <QString>
 #include <QDateTime>
+#include <QList>
+#include <QSharedPointer>
 
 #include "qicalrule.h"
+#include "qicalzonetable.h"
 
 class QiCalTzInfo : public QObject
 {
@@ -15,6 +19,8 @@ class QiCalTzInfo : public QObject
     Q_PROPERTY(QString tzName READ tzName WRITE setTzName NOTIFY tzNameChanged)
     Q_PROPERTY(QDateTime dtStart READ dtStart WRITE setDtStart NOTIFY dtStartChanged)
     Q_PROPERTY(QiCalRule* rule READ rule WRITE setRule NOTIFY ruleChanged)
+    Q_PROPERTY(QVector<qint64> rDates READ rDates WRITE setRDates NOTIFY rDatesChanged)
+    Q_PROPERTY(bool dayLight READ isDayLight WRITE setDayLight NOTIFY dayLightChanged)
 public:
     explicit QiCalTzInfo(QObject *parent = nullptr);
 
@@ -33,12 +39,21 @@ public:
     QiCalRule *rule() const;
     void setRule(QiCalRule *rule);
 
+    // onsets as wall clock time in offsetFrom, encoded as msecs since 1970-01-01T00:00:00
+    QVector<qint64> rDates() const;
+    void setRDates(const QVector<qint64> &rDates);
+
+    bool isDayLight() const;
+    void setDayLight(bool dayLight);
+
 signals:
     void offsetFromChanged();
     void offsetToChanged();
     void tzNameChanged();
     void dtStartChanged();
     void ruleChanged();
+    void rDatesChanged();
+    void dayLightChanged();
 
 private:
     int m_offsetFrom;
@@ -46,6 +61,8 @@ private:
     QString m_tzName;
     QDateTime m_dtStart;
     QiCalRule* m_rule;
+    QVector<qint64> m_rDates;
+    bool m_dayLight;
 };
 
 class QiCalTimeZone : public QObject
@@ -66,15 +83,31 @@ public:
     QiCalTzInfo *dayLight() const;
     void setDayLight(QiCalTzInfo *dayLight);
 
+    QList<QiCalTzInfo*> observances() const;
+
+    QSharedPointer<const QiCalZoneTable> zoneTable() const;
+    void setHorizon(int fromYear, int toYear);
+
+    QByteArray fingerprint() const;
+    void setFingerprint(const QByteArray &fingerprint);
+
 signals:
     void tzIdChanged();
     void standardChanged();
     void dayLightChanged();
 
 private:
+    void invalidateTable();
+    void addObservance(QiCalTzInfo* info);
+
     QString m_tzId;
     QiCalTzInfo* m_standard;
     QiCalTzInfo* m_dayLight;
+    QList<QiCalTzInfo*> m_observances;
+    int m_fromYear;
+    int m_toYear;
+    QByteArray m_fingerprint;
+    mutable QSharedPointer<const QiCalZoneTable> m_zoneTable;
 };
 
 #endif // QICALTIMEZONE_H
@@ -0,0 +1,56 @@
+#ifndef QICALUTIL_P_H
+#define QICALUTIL_P_H
+
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+
+// Internal helpers shared by the recurrence engine, the zone tables and the writers. Not installed.
+namespace QiCalUtil
+{
+
+const qint64 SECS_PER_DAY = 86400;
+const qint64 EPOCH_JULIAN_DAY = 2440588;
+
+// indexed by QiCalRule::Freq, QiCalEvent::Status, QiCalEvent::Transp and QiCalAlarm::Action
+const char* const FREQ_NAMES[] = { "SECONDLY", "MINUTELY", "HOURLY", "DAILY", "WEEKLY", "MONTHLY", "YEARLY" };
+const char* const STATUS_NAMES[] = { "TENTATIVE", "CONFIRMED", "CANCELLED" };
+const char* const TRANSP_NAMES[] = { "OPAQUE", "TRANSPARENT" };
+const char* const ACTION_NAMES[] = { "AUDIO", "DISPLAY", "EMAIL" };
+
+inline qint64 floorDiv(qint64 value, qint64 divisor)
+{
+    qint64 result = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0)))
+    {
+        result--;
+    }
+
+    return result;
+}
+
+// wall clock seconds since 1970-01-01T00:00:00, ignoring the time spec
+inline qint64 localSeconds(const QDate& date, const QTime& time)
+{
+    return (date.toJulianDay() - EPOCH_JULIAN_DAY) * SECS_PER_DAY + time.msecsSinceStartOfDay() / 1000;
+}
+
+inline qint64 localSeconds(const QDateTime& dateTime)
+{
+    return localSeconds(dateTime.date(), dateTime.time());
+}
+
+inline char* putDigits(char* out, int value, int width)
+{
+    for (int i = width - 1; i >= 0; i--)
+    {
+        out[i] = char('0' + value % 10);
+        value /= 10;
+    }
+
+    return out + width;
+}
+
+}
+
+#endif // QICALUTIL_P_H
@@ -0,0 +1,689 @@
+#include "qicalwriter.h"
+#include "qicalutil_p.h"
+
+#include <cstring>
+
+using namespace QiCalUtil;
+
+QiCalWriter::QiCalWriter(QIODevice *device) :
+    m_device(device),
+    m_lineLength(0),
+    m_ok(true)
+{
+    m_buffer.reserve(FLUSH_SIZE);
+}
+
+QIODevice *QiCalWriter::device() const
+{
+    return m_device;
+}
+
+void QiCalWriter::setDevice(QIODevice *device)
+{
+    m_device = device;
+}
+
+bool QiCalWriter::writeCalendar(const QiCalCalendar *calendar)
+{
+    if (calendar == nullptr)
+    {
+        return false;
+    }
+
+    beginCalendar(calendar);
+
+    for (const QiCalEvent* event : calendar->events())
+    {
+        writeEvent(event);
+    }
+
+    endCalendar();
+
+    return flush();
+}
+
+bool QiCalWriter::writeOccurrences(const QiCalCalendar *calendar, const QList<QiCalEvent *> &occurrences)
+{
+    if (calendar == nullptr)
+    {
+        return false;
+    }
+
+    beginCalendar(calendar);
+
+    for (const QiCalEvent* event : occurrences)
+    {
+        writeEvent(event);
+    }
+
+    endCalendar();
+
+    return flush();
+}
+
+const QByteArray &QiCalWriter::buffer() const
+{
+    return m_buffer;
+}
+
+void QiCalWriter::clear()
+{
+    m_buffer.resize(0);
+    m_lineLength = 0;
+    m_ok = true;
+}
+
+bool QiCalWriter::flush()
+{
+    if (m_device == nullptr || m_buffer.isEmpty())
+    {
+        return m_ok;
+    }
+
+    if (m_device->write(m_buffer.constData(), m_buffer.size()) != m_buffer.size())
+    {
+        m_ok = false;
+    }
+    m_buffer.resize(0);
+
+    return m_ok;
+}
+
+void QiCalWriter::beginCalendar(const QiCalCalendar *calendar)
+{
+    m_ok = true;
+    m_tzIds.clear();
+
+    writeLine("BEGIN", "VCALENDAR");
+
+    beginProperty("VERSION");
+    appendLatin1(":", 1);
+    if (calendar->version().isEmpty())
+    {
+        appendLatin1("2.0");
+    }
+    else
+    {
+        appendUtf8(calendar->version(), false);
+    }
+    endProperty();
+
+    if (calendar->prodId().isEmpty())
+    {
+        writeLine("PRODID", "-//qiCalendar//qiCalendar//EN");
+    }
+    else
+    {
+        writeText("PRODID", calendar->prodId());
+    }
+
+    if (!calendar->method().isEmpty())
+    {
+        beginProperty("METHOD");
+        appendLatin1(":", 1);
+        appendUtf8(calendar->method(), false);
+        endProperty();
+    }
+
+    for (const QiCalTimeZone* timeZone : calendar->timeZones())
+    {
+        m_tzIds.insert(timeZone->tzId());
+        writeTimeZone(timeZone);
+    }
+}
+
+void QiCalWriter::endCalendar()
+{
+    writeLine("END", "VCALENDAR");
+}
+
+void QiCalWriter::writeTimeZone(const QiCalTimeZone *timeZone)
+{
+    writeLine("BEGIN", "VTIMEZONE");
+
+    beginProperty("TZID");
+    appendLatin1(":", 1);
+    appendUtf8(timeZone->tzId(), false);
+    endProperty();
+
+    for (const QiCalTzInfo* info : timeZone->observances())
+    {
+        writeTzInfo(info->isDayLight() ? "DAYLIGHT" : "STANDARD", info);
+    }
+
+    writeLine("END", "VTIMEZONE");
+}
+
+void QiCalWriter::writeTzInfo(const char *name, const QiCalTzInfo *info)
+{
+    writeLine("BEGIN", name);
+
+    if (info->dtStart().isValid())
+    {
+        beginProperty("DTSTART");
+        appendLatin1(":", 1);
+        appendStamp(localSeconds(info->dtStart()), false);
+        endProperty();
+    }
+
+    writeUtcOffset("TZOFFSETFROM", info->offsetFrom());
+    writeUtcOffset("TZOFFSETTO", info->offsetTo());
+
+    if (!info->tzName().isEmpty())
+    {
+        writeText("TZNAME", info->tzName());
+    }
+
+    if (info->rule() != nullptr)
+    {
+        writeRule(info->rule());
+    }
+
+    if (!info->rDates().isEmpty())
+    {
+        beginProperty("RDATE");
+        appendLatin1(":", 1);
+        for (int i = 0; i < info->rDates().size(); i++)
+        {
+            if (i > 0)
+            {
+                appendLatin1(",", 1);
+            }
+            appendStamp(floorDiv(info->rDates().at(i), 1000), false);
+        }
+        endProperty();
+    }
+
+    writeLine("END", name);
+}
+
+void QiCalWriter::writeEvent(const QiCalEvent *event)
+{
+    const QiCalEvent* master = event->masterEvent();
+
+    writeLine("BEGIN", "VEVENT");
+
+    writeText("UID", event->uid());
+    writeDateTime("DTSTAMP", event->dtStamp(), nullptr);
+    writeDateTime("DTSTART", event->dtStart(), event);
+    writeDateTime("DTEND", event->dtEnd(), event);
+
+    if (master != nullptr)
+    {
+        writeDateTime("RECURRENCE-ID", event->dtStart(), event);
+    }
+
+    writeDateTime("CREATED", event->created(), nullptr);
+    writeDateTime("LAST-MODIFIED", event->lastModified(), nullptr);
+
+    if (!event->summary().isEmpty())
+    {
+        writeText("SUMMARY", event->summary());
+    }
+
+    if (!event->description().isEmpty())
+    {
+        writeText("DESCRIPTION", event->description());
+    }
+
+    if (!event->location().isEmpty())
+    {
+        writeText("LOCATION", event->location());
+    }
+
+    writeLine("STATUS", STATUS_NAMES[event->status()]);
+    writeLine("TRANSP", TRANSP_NAMES[event->transp()]);
+
+    if (event->sequence() > 0)
+    {
+        beginProperty("SEQUENCE");
+        appendLatin1(":", 1);
+        appendNumber(event->sequence());
+        endProperty();
+    }
+
+    if (master == nullptr)
+    {
+        if (event->rule() != nullptr)
+        {
+            writeRule(event->rule());
+        }
+
+        writeDateList("RDATE", event->rDates(), event);
+        writeDateList("EXDATE", event->exDates(), event);
+    }
+
+    for (const QiCalAlarm* alarm : (master != nullptr ? master : event)->alarms())
+    {
+        writeAlarm(alarm);
+    }
+
+    writeLine("END", "VEVENT");
+}
+
+void QiCalWriter::writeAlarm(const QiCalAlarm *alarm)
+{
+    writeLine("BEGIN", "VALARM");
+    writeLine("ACTION", ACTION_NAMES[alarm->action()]);
+
+    if (!alarm->description().isEmpty())
+    {
+        writeText("DESCRIPTION", alarm->description());
+    }
+
+    if (alarm->isTriggerValid())
+    {
+        beginProperty("TRIGGER");
+        if (alarm->isTriggerAbsolute())
+        {
+            appendLatin1(";VALUE=DATE-TIME");
+        }
+        else if (alarm->triggerRelated() == QiCalAlarm::REL_END)
+        {
+            appendLatin1(";RELATED=END");
+        }
+        appendLatin1(":", 1);
+        appendUtf8(alarm->trigger(), false);
+        endProperty();
+    }
+
+    writeLine("END", "VALARM");
+}
+
+void QiCalWriter::writeRule(const QiCalRule *rule)
+{
+    beginProperty("RRULE");
+    appendLatin1(":FREQ=");
+    appendLatin1(FREQ_NAMES[rule->freq()]);
+
+    if (rule->until().isValid())
+    {
+        appendLatin1(";UNTIL=");
+        if (rule->until().timeSpec() == Qt::LocalTime)
+        {
+            appendStamp(localSeconds(rule->until()), false);
+        }
+        else
+        {
+            appendStamp(floorDiv(rule->until().toMSecsSinceEpoch(), 1000), true);
+        }
+    }
+
+    if (rule->count() > 0)
+    {
+        appendLatin1(";COUNT=");
+        appendNumber(rule->count());
+    }
+
+    if (rule->interval() > 1)
+    {
+        appendLatin1(";INTERVAL=");
+        appendNumber(rule->interval());
+    }
+
+    appendIntList(";BYSECOND=", rule->bySecond());
+    appendIntList(";BYMINUTE=", rule->byMinute());
+    appendIntList(";BYHOUR=", rule->byHour());
+
+    const QList<QString> byDay = rule->byDay();
+    for (int i = 0; i < byDay.size(); i++)
+    {
+        appendLatin1(i == 0 ? ";BYDAY=" : ",");
+        appendUtf8(byDay.at(i), false);
+    }
+
+    appendIntList(";BYMONTHDAY=", rule->byMonthDay());
+    appendIntList(";BYYEARDAY=", rule->byYearDay());
+    appendIntList(";BYWEEKNO=", rule->byWeekNo());
+    appendIntList(";BYMONTH=", rule->byMonth());
+    appendIntList(";BYSETPOS=", rule->bySetPos());
+
+    if (!rule->wkst().isEmpty())
+    {
+        appendLatin1(";WKST=");
+        appendUtf8(rule->wkst(), false);
+    }
+
+    endProperty();
+}
+
+void QiCalWriter::writeText(const char *name, const QString &text)
+{
+    beginProperty(name);
+    appendLatin1(":", 1);
+    appendUtf8(text, true);
+    endProperty();
+}
+
+void QiCalWriter::writeDateTime(const char *name, const QDateTime &dateTime, const QiCalEvent *event)
+{
+    if (!dateTime.isValid())
+    {
+        return;
+    }
+
+    beginProperty(name);
+
+    const QString* tzId = dateTime.timeSpec() == Qt::OffsetFromUTC ? zoneId(event) : nullptr;
+    if (event != nullptr && event->isAllDay())
+    {
+        appendLatin1(";VALUE=DATE:");
+        appendDate(dateTime.date());
+    }
+    else if (tzId != nullptr)
+    {
+        appendParam("TZID", *tzId);
+        appendLatin1(":", 1);
+        appendStamp(floorDiv(dateTime.toMSecsSinceEpoch(), 1000) + dateTime.offsetFromUtc(), false);
+    }
+    else if (dateTime.timeSpec() == Qt::LocalTime)
+    {
+        appendLatin1(":", 1);
+        appendStamp(localSeconds(dateTime), false);
+    }
+    else
+    {
+        appendLatin1(":", 1);
+        appendStamp(floorDiv(dateTime.toMSecsSinceEpoch(), 1000), true);
+    }
+
+    endProperty();
+}
+
+void QiCalWriter::writeDateList(const char *name, const QVector<qint64> &dates, const QiCalEvent *event)
+{
+    if (dates.isEmpty())
+    {
+        return;
+    }
+
+    beginProperty(name);
+
+    const QString* tzId = zoneId(event);
+    if (event->isAllDay())
+    {
+        appendLatin1(";VALUE=DATE");
+    }
+    else if (tzId != nullptr)
+    {
+        appendParam("TZID", *tzId);
+    }
+    appendLatin1(":", 1);
+
+    for (int i = 0; i < dates.size(); i++)
+    {
+        if (i > 0)
+        {
+            appendLatin1(",", 1);
+        }
+
+        const qint64 utc = floorDiv(dates.at(i), 1000);
+        if (event->isAllDay())
+        {
+            // DATE items were read as local midnight, or as midnight in the event zone
+            const qint64 wall = event->zone().isNull() ? localSeconds(QDateTime::fromMSecsSinceEpoch(dates.at(i))) : event->zone()->toLocal(utc);
+            appendDate(QDate::fromJulianDay(floorDiv(wall, SECS_PER_DAY) + EPOCH_JULIAN_DAY));
+        }
+        else if (tzId != nullptr)
+        {
+            appendStamp(event->zone()->toLocal(utc), false);
+        }
+        else
+        {
+            appendStamp(utc, true);
+        }
+    }
+
+    endProperty();
+}
+
+void QiCalWriter::writeUtcOffset(const char *name, int offset)
+{
+    char text[8];
+    char* out = text;
+    const int seconds = qAbs(offset);
+
+    *out++ = offset < 0 ? '-' : '+';
+    out = putDigits(out, seconds / 3600, 2);
+    out = putDigits(out, seconds / 60 % 60, 2);
+    if (seconds % 60 != 0)
+    {
+        out = putDigits(out, seconds % 60, 2);
+    }
+
+    beginProperty(name);
+    appendLatin1(":", 1);
+    appendLatin1(text, int(out - text));
+    endProperty();
+}
+
+void QiCalWriter::writeLine(const char *name, const char *value)
+{
+    beginProperty(name);
+    appendLatin1(":", 1);
+    appendLatin1(value);
+    endProperty();
+}
+
+const QString *QiCalWriter::zoneId(const QiCalEvent *event) const
+{
+    if (event == nullptr || event->zone().isNull())
+    {
+        return nullptr;
+    }
+
+    auto found = m_tzIds.constFind(event->zone()->tzId());
+
+    return found != m_tzIds.constEnd() ? &*found : nullptr;
+}
+
+void QiCalWriter::beginProperty(const char *name)
+{
+    m_lineLength = 0;
+    appendLatin1(name);
+}
+
+void QiCalWriter::endProperty()
+{
+    m_buffer.append("\r\n", 2);
+    m_lineLength = 0;
+
+    if (m_device != nullptr && m_buffer.size() >= FLUSH_SIZE)
+    {
+        flush();
+    }
+}
+
+void QiCalWriter::appendParam(const char *name, const QString &value)
+{
+    bool quote = false;
+    for (const QChar& c : value)
+    {
+        if (c == ':' || c == ';' || c == ',')
+        {
+            quote = true;
+            break;
+        }
+    }
+
+    appendLatin1(";", 1);
+    appendLatin1(name);
+    appendLatin1(quote ? "=\"" : "=");
+    appendUtf8(value, false);
+    if (quote)
+    {
+        appendLatin1("\"", 1);
+    }
+}
+
+void QiCalWriter::appendLatin1(const char *text)
+{
+    appendLatin1(text, int(std::strlen(text)));
+}
+
+void QiCalWriter::appendLatin1(const char *text, int length)
+{
+    while (length > 0)
+    {
+        if (m_lineLength >= FOLD_OCTETS)
+        {
+            m_buffer.append("\r\n ", 3);
+            m_lineLength = 1;
+        }
+
+        const int chunk = qMin(length, FOLD_OCTETS - m_lineLength);
+        m_buffer.append(text, chunk);
+        m_lineLength += chunk;
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+void QiCalWriter::appendUtf8(const QString &text, bool escape)
+{
+    const int length = text.size();
+    const int start = m_buffer.size();
+
+    // Worst case is three octets per UTF-16 unit plus one fold for every 71 octets.
+    m_buffer.resize(start + length * 4 + 8);
+
+    const QChar* data = text.constData();
+    char* out = m_buffer.data() + start;
+    int lineLength = m_lineLength;
+
+    for (int i = 0; i < length; i++)
+    {
+        uint code = data[i].unicode();
+        char octets[4];
+        int count = 0;
+
+        if (code < 0x80)
+        {
+            if (escape && (code == '\\' || code == ';' || code == ',' || code == '\n'))
+            {
+                octets[count++] = '\\';
+                octets[count++] = code == '\n' ? 'n' : char(code);
+            }
+            else if (code < 0x20 && code != '\t')
+            {
+                continue;
+            }
+            else
+            {
+                octets[count++] = char(code);
+            }
+        }
+        else if (code < 0x800)
+        {
+            octets[count++] = char(0xc0 | (code >> 6));
+            octets[count++] = char(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            if (QChar::isHighSurrogate(code) && i + 1 < length && data[i + 1].isLowSurrogate())
+            {
+                code = QChar::surrogateToUcs4(ushort(code), data[++i].unicode());
+            }
+            else if (QChar::isSurrogate(code))
+            {
+                code = QChar::ReplacementCharacter;
+            }
+
+            if (code >= 0x10000)
+            {
+                octets[count++] = char(0xf0 | (code >> 18));
+                octets[count++] = char(0x80 | ((code >> 12) & 0x3f));
+            }
+            else
+            {
+                octets[count++] = char(0xe0 | (code >> 12));
+            }
+            octets[count++] = char(0x80 | ((code >> 6) & 0x3f));
+            octets[count++] = char(0x80 | (code & 0x3f));
+        }
+
+        if (lineLength + count > FOLD_OCTETS)
+        {
+            *out++ = '\r';
+            *out++ = '\n';
+            *out++ = ' ';
+            lineLength = 1;
+        }
+
+        for (int j = 0; j < count; j++)
+        {
+            *out++ = octets[j];
+        }
+        lineLength += count;
+    }
+
+    m_buffer.resize(int(out - m_buffer.constData()));
+    m_lineLength = lineLength;
+}
+
+void QiCalWriter::appendNumber(qint64 value)
+{
+    char text[24];
+    char* end = text + sizeof(text);
+    char* out = end;
+    quint64 magnitude = value < 0 ? quint64(0) - quint64(value) : quint64(value);
+
+    do
+    {
+        *--out = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        *--out = '-';
+    }
+
+    appendLatin1(out, int(end - out));
+}
+
+void QiCalWriter::appendIntList(const char *name, const QList<qint32> &values)
+{
+    for (int i = 0; i < values.size(); i++)
+    {
+        appendLatin1(i == 0 ? name : ",");
+        appendNumber(values.at(i));
+    }
+}
+
+void QiCalWriter::appendDate(const QDate &date)
+{
+    char text[8];
+    char* out = text;
+    out = putDigits(out, date.year(), 4);
+    out = putDigits(out, date.month(), 2);
+    out = putDigits(out, date.day(), 2);
+
+    appendLatin1(text, int(out - text));
+}
+
+void QiCalWriter::appendStamp(qint64 seconds, bool utc)
+{
+    const qint64 days = floorDiv(seconds, SECS_PER_DAY);
+    const int secs = int(seconds - days * SECS_PER_DAY);
+    int year;
+    int month;
+    int day;
+    QDate::fromJulianDay(days + EPOCH_JULIAN_DAY).getDate(&year, &month, &day);
+
+    char text[16];
+    char* out = text;
+    out = putDigits(out, year, 4);
+    out = putDigits(out, month, 2);
+    out = putDigits(out, day, 2);
+    *out++ = 'T';
+    out = putDigits(out, secs / 3600, 2);
+    out = putDigits(out, secs / 60 % 60, 2);
+    out = putDigits(out, secs % 60, 2);
+    if (utc)
+    {
+        *out++ = 'Z';
+    }
+
+    appendLatin1(text, int(out - text));
+}
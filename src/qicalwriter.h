@@ -0,0 +1,67 @@
+#ifndef QICALWRITER_H
+#define QICALWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QIODevice>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "qicalcalendar.h"
+#include "qicalendar_global.h"
+
+// Streams iCalendar (RFC 5545) text into a reusable buffer, optionally flushing it to a device.
+class QICALENDARSHARED_EXPORT QiCalWriter
+{
+public:
+    explicit QiCalWriter(QIODevice* device = nullptr);
+
+    QIODevice* device() const;
+    void setDevice(QIODevice* device);
+
+    bool writeCalendar(const QiCalCalendar* calendar);
+    bool writeOccurrences(const QiCalCalendar* calendar, const QList<QiCalEvent*>& occurrences);
+
+    const QByteArray& buffer() const;
+    void clear();
+    bool flush();
+
+    static const int FOLD_OCTETS = 75;
+    static const int FLUSH_SIZE = 64 * 1024;
+
+private:
+    void beginCalendar(const QiCalCalendar* calendar);
+    void endCalendar();
+    void writeTimeZone(const QiCalTimeZone* timeZone);
+    void writeTzInfo(const char* name, const QiCalTzInfo* info);
+    void writeEvent(const QiCalEvent* event);
+    void writeAlarm(const QiCalAlarm* alarm);
+    void writeRule(const QiCalRule* rule);
+    void writeText(const char* name, const QString& text);
+    void writeDateTime(const char* name, const QDateTime& dateTime, const QiCalEvent* event);
+    void writeDateList(const char* name, const QVector<qint64>& dates, const QiCalEvent* event);
+    void writeUtcOffset(const char* name, int offset);
+    void writeLine(const char* name, const char* value);
+
+    const QString* zoneId(const QiCalEvent* event) const;
+
+    void beginProperty(const char* name);
+    void endProperty();
+    void appendParam(const char* name, const QString& value);
+    void appendLatin1(const char* text);
+    void appendLatin1(const char* text, int length);
+    void appendUtf8(const QString& text, bool escape);
+    void appendNumber(qint64 value);
+    void appendIntList(const char* name, const QList<qint32>& values);
+    void appendDate(const QDate& date);
+    void appendStamp(qint64 seconds, bool utc);
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    int m_lineLength;
+    bool m_ok;
+    QSet<QString> m_tzIds;
+};
+
+#endif // QICALWRITER_H
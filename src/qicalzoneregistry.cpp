@@ -0,0 +1,194 @@
+#include "qicalzoneregistry.h"
+#include "qicaltimezone.h"
+
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTimeZone>
+
+#include <algorithm>
+
+namespace
+{
+
+const int MIN_SWEEP = 64;
+
+QString observanceKey(const QiCalTzInfo* info)
+{
+    QStringList fields;
+    fields << QString::number(info->offsetFrom())
+           << QString::number(info->offsetTo())
+           << info->dtStart().date().toString(Qt::ISODate)
+           << info->dtStart().time().toString(Qt::ISODate);
+
+    for (qint64 rDate : info->rDates())
+    {
+        fields << QString::number(rDate);
+    }
+
+    const QiCalRule* rule = info->rule();
+    if (rule != nullptr)
+    {
+        fields << QString::number(int(rule->freq()))
+               << QString::number(rule->until().isValid() ? rule->until().toMSecsSinceEpoch() : 0)
+               << QString::number(rule->count())
+               << QString::number(rule->interval())
+               << rule->secondList()
+               << rule->minuteList()
+               << rule->hourList()
+               << rule->dayList()
+               << rule->monthDayList()
+               << rule->yearDayList()
+               << rule->weekList()
+               << rule->monthList()
+               << rule->setposList()
+               << rule->wkst();
+    }
+
+    return fields.join(';');
+}
+
+}
+
+QiCalZoneRegistry::QiCalZoneRegistry() :
+    m_sweepAt(MIN_SWEEP)
+{
+}
+
+QiCalZoneRegistry *QiCalZoneRegistry::instance()
+{
+    static QiCalZoneRegistry registry;
+    return &registry;
+}
+
+QByteArray QiCalZoneRegistry::fingerprint(const QiCalTimeZone *timeZone, int fromYear, int toYear)
+{
+    QStringList observances;
+    for (const QiCalTzInfo* info : timeZone->observances())
+    {
+        observances << observanceKey(info);
+    }
+    std::sort(observances.begin(), observances.end());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QString("VTIMEZONE|%1|%2|%3|").arg(timeZone->tzId()).arg(fromYear).arg(toYear).toUtf8());
+    hash.addData(observances.join('|').toUtf8());
+
+    return hash.result();
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneRegistry::zoneTable(const QiCalTimeZone *timeZone, int fromYear, int toYear)
+{
+    // a zone read from a file carries the hash of its raw VTIMEZONE block, so a hit skips both fingerprinting and compilation
+    const QByteArray key = timeZone->fingerprint().isEmpty()
+            ? fingerprint(timeZone, fromYear, toYear)
+            : "BLOCK|" + timeZone->fingerprint() + "|" + QByteArray::number(fromYear) + "|" + QByteArray::number(toYear);
+
+    QSharedPointer<const QiCalZoneTable> table = find(key);
+    if (!table.isNull())
+    {
+        return table;
+    }
+
+    return insert(key, QiCalZoneTable::compile(timeZone, fromYear, toYear));
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneRegistry::zoneTable(const QString &tzId, int fromYear, int toYear, qint32 initialOffset,
+                                                                  const QiCalZoneTable::Transition *transitions, int count)
+{
+    // precompiled tables (e.g. from a snapshot) are keyed by their content
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QString("TABLE|%1|%2|%3|%4|").arg(tzId).arg(fromYear).arg(toYear).arg(initialOffset).toUtf8());
+    hash.addData(reinterpret_cast<const char*>(transitions), int(sizeof(QiCalZoneTable::Transition)) * count);
+    const QByteArray key = hash.result();
+
+    QSharedPointer<const QiCalZoneTable> table = find(key);
+    if (!table.isNull())
+    {
+        return table;
+    }
+
+    return insert(key, QiCalZoneTable::fromTransitions(tzId, fromYear, toYear, initialOffset, transitions, count));
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneRegistry::systemZone(const QByteArray &ianaId, int fromYear, int toYear)
+{
+    const QByteArray key = "IANA|" + ianaId + "|" + QByteArray::number(fromYear) + "|" + QByteArray::number(toYear);
+
+    QSharedPointer<const QiCalZoneTable> table = find(key);
+    if (!table.isNull())
+    {
+        return table;
+    }
+
+    if (!QTimeZone::isTimeZoneIdAvailable(ianaId))
+    {
+        return QSharedPointer<const QiCalZoneTable>();
+    }
+
+    return insert(key, QiCalZoneTable::fromTimeZone(QTimeZone(ianaId), fromYear, toYear));
+}
+
+int QiCalZoneRegistry::count() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    int live = 0;
+    for (const QWeakPointer<const QiCalZoneTable>& table : m_tables)
+    {
+        if (!table.isNull())
+        {
+            live++;
+        }
+    }
+
+    return live;
+}
+
+void QiCalZoneRegistry::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_tables.clear();
+    m_sweepAt = MIN_SWEEP;
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneRegistry::find(const QByteArray &key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_tables.value(key).toStrongRef();
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneRegistry::insert(const QByteArray &key, const QSharedPointer<const QiCalZoneTable> &table)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const QSharedPointer<const QiCalZoneTable> existing = m_tables.value(key).toStrongRef();
+    if (!existing.isNull())
+    {
+        return existing;
+    }
+
+    // entries only hold weak references; the ones whose tables are gone are dropped each time the
+    // hash has doubled since the last sweep, which keeps inserts amortized constant
+    if (m_tables.size() >= m_sweepAt)
+    {
+        auto it = m_tables.begin();
+        while (it != m_tables.end())
+        {
+            if (it.value().isNull())
+            {
+                it = m_tables.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        m_sweepAt = std::max(MIN_SWEEP, 2 * m_tables.size());
+    }
+
+    m_tables.insert(key, table);
+
+    return table;
+}
@@ -0,0 +1,42 @@
+#ifndef QICALZONEREGISTRY_H
+#define QICALZONEREGISTRY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+#include "qicalzonetable.h"
+#include "qicalendar_global.h"
+
+class QiCalTimeZone;
+
+// Process-wide cache of compiled zones. Identical VTIMEZONE definitions share one QiCalZoneTable while any user holds it.
+class QICALENDARSHARED_EXPORT QiCalZoneRegistry
+{
+public:
+    static QiCalZoneRegistry* instance();
+
+    static QByteArray fingerprint(const QiCalTimeZone* timeZone, int fromYear, int toYear);
+
+    QSharedPointer<const QiCalZoneTable> zoneTable(const QiCalTimeZone* timeZone, int fromYear = QiCalZoneTable::DEFAULT_FROM_YEAR, int toYear = QiCalZoneTable::DEFAULT_TO_YEAR);
+    QSharedPointer<const QiCalZoneTable> zoneTable(const QString& tzId, int fromYear, int toYear, qint32 initialOffset,
+                                                   const QiCalZoneTable::Transition* transitions, int count);
+    QSharedPointer<const QiCalZoneTable> systemZone(const QByteArray& ianaId, int fromYear = QiCalZoneTable::DEFAULT_FROM_YEAR, int toYear = QiCalZoneTable::DEFAULT_TO_YEAR);
+
+    int count() const;
+    void clear();
+
+private:
+    QiCalZoneRegistry();
+
+    QSharedPointer<const QiCalZoneTable> find(const QByteArray& key) const;
+    QSharedPointer<const QiCalZoneTable> insert(const QByteArray& key, const QSharedPointer<const QiCalZoneTable>& table);
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, QWeakPointer<const QiCalZoneTable> > m_tables;
+    int m_sweepAt;
+};
+
+#endif // QICALZONEREGISTRY_H
@@ -0,0 +1,244 @@
+#include "qicalzonetable.h"
+#include "qicaltimezone.h"
+#include "qicalrecurrence.h"
+#include "qicalutil_p.h"
+
+#include <algorithm>
+
+using namespace QiCalUtil;
+
+QiCalZoneTable::QiCalZoneTable() :
+    m_fromYear(DEFAULT_FROM_YEAR),
+    m_toYear(DEFAULT_TO_YEAR),
+    m_initialOffset(0)
+{
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneTable::compile(const QiCalTimeZone *timeZone, int fromYear, int toYear)
+{
+    QSharedPointer<QiCalZoneTable> table(new QiCalZoneTable());
+    table->m_tzId = timeZone->tzId();
+    table->m_fromYear = fromYear;
+    table->m_toYear = toYear;
+
+    const QDateTime horizonStart(QDate(fromYear, 1, 1), QTime(0, 0), Qt::UTC);
+    const QDateTime horizonEnd(QDate(toYear + 1, 1, 1), QTime(0, 0), Qt::UTC);
+    QVector<Transition> transitions;
+
+    for (QiCalTzInfo* info : timeZone->observances())
+    {
+        if (!info->dtStart().isValid())
+        {
+            continue;
+        }
+
+        const QDateTime start(info->dtStart().date(), info->dtStart().time(), Qt::OffsetFromUTC, info->offsetFrom());
+
+        // RDATE onsets are wall clock time in the offset being left
+        for (qint64 rDate : info->rDates())
+        {
+            transitions.push_back({ floorDiv(rDate, 1000) - info->offsetFrom(), 0, info->offsetFrom(), info->offsetTo() });
+        }
+
+        if (info->rule() == nullptr)
+        {
+            transitions.push_back({ start.toMSecsSinceEpoch() / 1000, 0, info->offsetFrom(), info->offsetTo() });
+            continue;
+        }
+
+        QiCalRecurrence recurrence(info->rule(), start);
+        recurrence.reset(horizonStart.addDays(-366));
+        recurrence.setLimit(horizonEnd);
+
+        while (recurrence.hasNext())
+        {
+            const QDateTime occurrence = recurrence.next();
+            if (occurrence >= horizonEnd)
+            {
+                break;
+            }
+
+            transitions.push_back({ occurrence.toMSecsSinceEpoch() / 1000, 0, info->offsetFrom(), info->offsetTo() });
+        }
+    }
+
+    std::stable_sort(transitions.begin(), transitions.end(), [](const Transition& a, const Transition& b) {
+        return a.utc < b.utc;
+    });
+
+    qint32 offset = 0;
+    if (!transitions.isEmpty())
+    {
+        offset = transitions.first().offsetBefore;
+    }
+    else if (timeZone->standard() != nullptr)
+    {
+        offset = timeZone->standard()->offsetTo();
+    }
+    else if (!timeZone->observances().isEmpty())
+    {
+        offset = timeZone->observances().first()->offsetTo();
+    }
+
+    const qint64 firstUtc = horizonStart.toMSecsSinceEpoch() / 1000;
+    int i = 0;
+    for (; i < transitions.size() && transitions[i].utc < firstUtc; i++)
+    {
+        offset = transitions[i].offsetAfter;
+    }
+
+    table->m_initialOffset = offset;
+
+    for (; i < transitions.size(); i++)
+    {
+        const Transition& transition = transitions[i];
+        if ((i + 1 < transitions.size() && transitions[i + 1].utc == transition.utc) || transition.offsetAfter == offset)
+        {
+            continue;
+        }
+
+        table->m_transitions.push_back({ transition.utc, transition.utc + offset, offset, transition.offsetAfter });
+        offset = transition.offsetAfter;
+    }
+
+    return table;
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneTable::fromTimeZone(const QTimeZone &timeZone, int fromYear, int toYear)
+{
+    QSharedPointer<QiCalZoneTable> table(new QiCalZoneTable());
+    table->m_tzId = QString::fromUtf8(timeZone.id());
+    table->m_fromYear = fromYear;
+    table->m_toYear = toYear;
+
+    const QDateTime horizonStart(QDate(fromYear, 1, 1), QTime(0, 0), Qt::UTC);
+    const QDateTime horizonEnd(QDate(toYear + 1, 1, 1), QTime(0, 0), Qt::UTC);
+    qint32 offset = timeZone.offsetFromUtc(horizonStart);
+    table->m_initialOffset = offset;
+
+    for (const QTimeZone::OffsetData& data : timeZone.transitions(horizonStart, horizonEnd))
+    {
+        if (data.offsetFromUtc == offset)
+        {
+            continue;
+        }
+
+        const qint64 utc = data.atUtc.toMSecsSinceEpoch() / 1000;
+        table->m_transitions.push_back({ utc, utc + offset, offset, data.offsetFromUtc });
+        offset = data.offsetFromUtc;
+    }
+
+    return table;
+}
+
+QSharedPointer<const QiCalZoneTable> QiCalZoneTable::fromTransitions(const QString &tzId, int fromYear, int toYear, qint32 initialOffset,
+                                                                     const Transition *transitions, int count)
+{
+    QSharedPointer<QiCalZoneTable> table(new QiCalZoneTable());
+    table->m_tzId = tzId;
+    table->m_fromYear = fromYear;
+    table->m_toYear = toYear;
+    table->m_initialOffset = initialOffset;
+    table->m_transitions.reserve(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        table->m_transitions.push_back(transitions[i]);
+    }
+
+    return table;
+}
+
+QString QiCalZoneTable::tzId() const
+{
+    return m_tzId;
+}
+
+int QiCalZoneTable::fromYear() const
+{
+    return m_fromYear;
+}
+
+int QiCalZoneTable::toYear() const
+{
+    return m_toYear;
+}
+
+qint32 QiCalZoneTable::initialOffset() const
+{
+    return m_initialOffset;
+}
+
+const QVector<QiCalZoneTable::Transition> &QiCalZoneTable::transitions() const
+{
+    return m_transitions;
+}
+
+bool QiCalZoneTable::isFixed() const
+{
+    return m_transitions.isEmpty();
+}
+
+qint32 QiCalZoneTable::offsetAtUtc(qint64 utc) const
+{
+    auto it = std::upper_bound(m_transitions.constBegin(), m_transitions.constEnd(), utc, [](qint64 value, const Transition& transition) {
+        return value < transition.utc;
+    });
+
+    return it == m_transitions.constBegin() ? m_initialOffset : (it - 1)->offsetAfter;
+}
+
+qint32 QiCalZoneTable::offsetAtLocal(qint64 local) const
+{
+    auto it = std::upper_bound(m_transitions.constBegin(), m_transitions.constEnd(), local, [](qint64 value, const Transition& transition) {
+        return value < transition.localStart;
+    });
+
+    if (it == m_transitions.constBegin())
+    {
+        return m_initialOffset;
+    }
+
+    const Transition& transition = *(it - 1);
+    return local < transition.utc + transition.offsetAfter ? transition.offsetBefore : transition.offsetAfter;
+}
+
+qint32 QiCalZoneTable::gapBefore(qint64 local) const
+{
+    // local - gap names the same instant when local lies within one gap length after a spring-forward gap
+    auto it = std::upper_bound(m_transitions.constBegin(), m_transitions.constEnd(), local, [](qint64 value, const Transition& transition) {
+        return value < transition.localStart;
+    });
+
+    if (it == m_transitions.constBegin())
+    {
+        return 0;
+    }
+
+    const Transition& transition = *(it - 1);
+    const qint32 gap = transition.offsetAfter - transition.offsetBefore;
+    if (gap <= 0 || local < transition.localStart + gap || local >= transition.localStart + 2 * qint64(gap))
+    {
+        return 0;
+    }
+
+    return gap;
+}
+
+qint64 QiCalZoneTable::toUtc(qint64 local) const
+{
+    return local - offsetAtLocal(local);
+}
+
+qint64 QiCalZoneTable::toLocal(qint64 utc) const
+{
+    return utc + offsetAtUtc(utc);
+}
+
+QDateTime QiCalZoneTable::toDateTime(const QDate &date, const QTime &time) const
+{
+    const qint64 local = localSeconds(date, time);
+    const qint32 offset = offsetAtLocal(local);
+
+    return QDateTime::fromMSecsSinceEpoch((local - offset) * 1000, Qt::OffsetFromUTC, offset);
+}
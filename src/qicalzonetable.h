@@ -0,0 +1,58 @@
+#ifndef QICALZONETABLE_H
+#define QICALZONETABLE_H
+
+#include <QDateTime>
+#include <QSharedPointer>
+#include <QString>
+#include <QTimeZone>
+#include <QVector>
+
+#include "qicalendar_global.h"
+
+class QiCalTimeZone;
+
+class QICALENDARSHARED_EXPORT QiCalZoneTable
+{
+public:
+    struct Transition
+    {
+        qint64 utc;
+        qint64 localStart;
+        qint32 offsetBefore;
+        qint32 offsetAfter;
+    };
+
+    static QSharedPointer<const QiCalZoneTable> compile(const QiCalTimeZone* timeZone, int fromYear = DEFAULT_FROM_YEAR, int toYear = DEFAULT_TO_YEAR);
+    static QSharedPointer<const QiCalZoneTable> fromTimeZone(const QTimeZone& timeZone, int fromYear = DEFAULT_FROM_YEAR, int toYear = DEFAULT_TO_YEAR);
+    static QSharedPointer<const QiCalZoneTable> fromTransitions(const QString& tzId, int fromYear, int toYear, qint32 initialOffset,
+                                                                const Transition* transitions, int count);
+
+    QString tzId() const;
+    int fromYear() const;
+    int toYear() const;
+    qint32 initialOffset() const;
+    const QVector<Transition>& transitions() const;
+    bool isFixed() const;
+
+    qint32 offsetAtUtc(qint64 utc) const;
+    qint32 offsetAtLocal(qint64 local) const;
+    qint32 gapBefore(qint64 local) const;
+    qint64 toUtc(qint64 local) const;
+    qint64 toLocal(qint64 utc) const;
+
+    QDateTime toDateTime(const QDate& date, const QTime& time) const;
+
+    static const int DEFAULT_FROM_YEAR = 1970;
+    static const int DEFAULT_TO_YEAR = 2100;
+
+private:
+    QiCalZoneTable();
+
+    QString m_tzId;
+    int m_fromYear;
+    int m_toYear;
+    qint32 m_initialOffset;
+    QVector<Transition> m_transitions;
+};
+
+#endif // QICALZONETABLE_H
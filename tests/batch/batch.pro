@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_batch
+
+SOURCES += \
+    tst_batch.cpp
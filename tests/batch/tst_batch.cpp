@@ -0,0 +1,271 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "qicalbatchparser.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+// a calendar with 'events' events whose UIDs name the file they came from
+QByteArray calendar(int file, int events)
+{
+    QByteArray text = "BEGIN:VCALENDAR\r\n"
+                      "VERSION:2.0\r\n"
+                      "PRODID:-//qiCalendar//tests//EN\r\n";
+    for (int i = 0; i < events; i++)
+    {
+        text += "BEGIN:VEVENT\r\n"
+                "UID:file" + QByteArray::number(file) + "-" + QByteArray::number(i) + "\r\n"
+                "DTSTART:20240702T120000Z\r\n"
+                "DTEND:20240702T130000Z\r\n"
+                "SUMMARY:Event\r\n"
+                "END:VEVENT\r\n";
+    }
+
+    return text + "END:VCALENDAR\r\n";
+}
+
+bool fromFile(const QiCalCalendar* calendar, int file, int events)
+{
+    if (calendar->events().size() != events)
+    {
+        return false;
+    }
+
+    for (const QiCalEvent* event : calendar->events())
+    {
+        if (!event->uid().startsWith(QString("file%1-").arg(file)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+class TestBatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void backpressure_data();
+    void backpressure();
+    void errors();
+    void ownerThread();
+    void parserReuse();
+
+private:
+    QString path(int file) const;
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestBatch::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+}
+
+QString TestBatch::path(int file) const
+{
+    return m_dir->filePath(QString("cal%1.ics").arg(file, 3, 10, QChar('0')));
+}
+
+void TestBatch::backpressure_data()
+{
+    QTest::addColumn<int>("maxPending");
+
+    QTest::newRow("one") << 1;
+    QTest::newRow("three") << 3;
+    QTest::newRow("eight") << 8;
+}
+
+// no file is opened before the callback has consumed enough results to make room for it: each file only
+// comes into existence once the result 'maxPending' places ahead of it has been delivered
+void TestBatch::backpressure()
+{
+    QFETCH(int, maxPending);
+
+    const int count = 24;
+    QStringList paths;
+    for (int file = 0; file < count; file++)
+    {
+        paths.append(path(file));
+        if (file < maxPending)
+        {
+            QVERIFY(writeFile(path(file), calendar(file, 2)));
+        }
+    }
+
+    QiCalBatchParser batch;
+    batch.setMaxThreads(4);
+    batch.setMaxPending(maxPending);
+    QCOMPARE(batch.maxPending(), maxPending);
+
+    int delivered = 0;
+    QStringList failed;
+    const int parsed = batch.parse(paths, [&](const QiCalBatchResult& result) {
+        if (result.calendar == nullptr)
+        {
+            failed.append(result.error);
+        }
+        delete result.calendar;
+
+        const int next = delivered + maxPending;
+        if (next < count)
+        {
+            writeFile(path(next), calendar(next, 2));
+        }
+        delivered++;
+
+        // a slow consumer: workers would run ahead here if nothing held them back
+        QThread::msleep(2);
+    });
+
+    QCOMPARE(failed, QStringList());
+    QCOMPARE(delivered, count);
+    QCOMPARE(parsed, count);
+}
+
+// unreadable and invalid files come back as error results; the rest of the batch is unaffected
+void TestBatch::errors()
+{
+    QVERIFY(writeFile(path(0), calendar(0, 3)));
+    QVERIFY(writeFile(path(1), "this is not a calendar\r\n"));
+    QVERIFY(writeFile(path(3), calendar(3, 1)));
+    const QStringList paths = { path(0), path(1), path(2), path(3) };
+
+    QiCalBatchParser batch;
+    QHash<QString, QiCalBatchResult> results;
+    const int parsed = batch.parse(paths, [&](const QiCalBatchResult& result) {
+        results.insert(result.path, result);
+    });
+
+    QCOMPARE(parsed, 2);
+    QCOMPARE(results.size(), 4);
+
+    QVERIFY(results.value(path(0)).error.isEmpty());
+    QVERIFY(fromFile(results.value(path(0)).calendar, 0, 3));
+    QVERIFY(fromFile(results.value(path(3)).calendar, 3, 1));
+
+    QVERIFY(results.value(path(1)).calendar == nullptr);
+    QCOMPARE(results.value(path(1)).error, QString("%1 is not a valid iCalendar file").arg(path(1)));
+    QVERIFY(results.value(path(2)).calendar == nullptr);
+    QCOMPARE(results.value(path(2)).error, QString("Cannot open %1").arg(path(2)));
+
+    const QiCalBatchResult missing = batch.parseFile(path(2)).result();
+    QVERIFY(missing.calendar == nullptr);
+    QCOMPARE(missing.error, QString("Cannot open %1").arg(path(2)));
+
+    for (const QiCalBatchResult& result : results)
+    {
+        delete result.calendar;
+    }
+}
+
+// calendars are parsed on pool threads but handed over belonging to the thread that asked for them
+void TestBatch::ownerThread()
+{
+    QStringList paths;
+    for (int file = 0; file < 8; file++)
+    {
+        QVERIFY(writeFile(path(file), calendar(file, 2)));
+        paths.append(path(file));
+    }
+
+    QiCalBatchParser batch;
+    batch.setMaxThreads(4);
+
+    QList<QThread*> owners;
+    QList<QThread*> eventOwners;
+    batch.parse(paths, [&](const QiCalBatchResult& result) {
+        owners.append(result.calendar->thread());
+        eventOwners.append(result.calendar->events().first()->thread());
+        delete result.calendar;
+    });
+
+    QCOMPARE(owners.size(), paths.size());
+    QCOMPARE(owners.count(QThread::currentThread()), paths.size());
+    QCOMPARE(eventOwners.count(QThread::currentThread()), paths.size());
+
+    QiCalBatchResult single = batch.parseFile(path(0)).result();
+    QCOMPARE(single.calendar->thread(), QThread::currentThread());
+    delete single.calendar;
+
+    // the owner is whoever called, not the thread the batch parser was created on
+    QThread caller;
+    QThread* owner = nullptr;
+    QObject* context = new QObject();
+    context->moveToThread(&caller);
+    connect(&caller, &QThread::started, context, [&]() {
+        QiCalBatchResult result = batch.parseFile(path(1)).result();
+        owner = result.calendar->thread();
+        delete result.calendar;
+        caller.quit();
+    });
+    caller.start();
+    QVERIFY(caller.wait(10000));
+    delete context;
+    QCOMPARE(owner, &caller);
+}
+
+// a handful of parsers serve the whole batch; each result only holds what its own file contained
+void TestBatch::parserReuse()
+{
+    const int count = 40;
+    QStringList paths;
+    for (int file = 0; file < count; file++)
+    {
+        QVERIFY(writeFile(path(file), file % 7 == 3 ? QByteArray("not a calendar\r\n") : calendar(file, file % 5 + 1)));
+        paths.append(path(file));
+    }
+
+    QiCalBatchParser batch;
+    batch.setMaxThreads(2);
+    QCOMPARE(batch.maxThreads(), 2);
+
+    QSet<QiCalCalendar*> calendars;
+    QStringList mismatched;
+    int failed = 0;
+    const int parsed = batch.parse(paths, [&](const QiCalBatchResult& result) {
+        const int file = paths.indexOf(result.path);
+        if (result.calendar == nullptr)
+        {
+            failed++;
+            return;
+        }
+
+        if (!fromFile(result.calendar, file, file % 5 + 1))
+        {
+            mismatched.append(result.path);
+        }
+        calendars.insert(result.calendar);
+    });
+
+    QCOMPARE(mismatched, QStringList());
+    QCOMPARE(failed, 6);
+    QCOMPARE(parsed, count - failed);
+    QCOMPARE(calendars.size(), parsed);
+    qDeleteAll(calendars);
+
+    // sequential requests go through the same idle parser and still start from scratch
+    QiCalBatchResult first = batch.parseFile(path(4)).result();
+    QiCalBatchResult second = batch.parseFile(path(1)).result();
+    QVERIFY(fromFile(first.calendar, 4, 5));
+    QVERIFY(fromFile(second.calendar, 1, 2));
+    QVERIFY(first.calendar != second.calendar);
+    delete first.calendar;
+    delete second.calendar;
+}
+
+QTEST_GUILESS_MAIN(TestBatch)
+
+#include "tst_batch.moc"
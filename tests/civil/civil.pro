@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_civil
+
+SOURCES += \
+    tst_civil.cpp
@@ -0,0 +1,104 @@
+#include <QtTest>
+
+#include <limits>
+
+#include "qicalcivil.h"
+
+Q_DECLARE_METATYPE(QiCalCivil::Isa)
+
+namespace
+{
+
+// odd, so every kernel also runs its scalar tail
+const int BLOCK = 1021;
+
+}
+
+class TestCivil : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+    void kernels_data();
+    void kernels();
+};
+
+void TestCivil::cleanup()
+{
+    QiCalCivil::setIsa(QiCalCivil::supportedIsa());
+}
+
+void TestCivil::kernels_data()
+{
+    QTest::addColumn<QiCalCivil::Isa>("isa");
+    QTest::addColumn<qint32>("first");
+    QTest::addColumn<qint32>("last");
+
+    const qint32 bottom = QiCalCivil::MIN_JULIAN_DAY;
+    const qint32 top = std::numeric_limits<qint32>::max() - 7;
+    const qint32 tenThousandYears = 3652425;
+
+    QTest::newRow("scalar") << QiCalCivil::ISA_SCALAR << bottom << bottom + tenThousandYears;
+    QTest::newRow("sse4.1") << QiCalCivil::ISA_SSE41 << bottom << bottom + tenThousandYears;
+    QTest::newRow("avx2") << QiCalCivil::ISA_AVX2 << bottom << bottom + tenThousandYears;
+    QTest::newRow("scalar top") << QiCalCivil::ISA_SCALAR << top - 2 * BLOCK << top;
+    QTest::newRow("sse4.1 top") << QiCalCivil::ISA_SSE41 << top - 2 * BLOCK << top;
+    QTest::newRow("avx2 top") << QiCalCivil::ISA_AVX2 << top - 2 * BLOCK << top;
+}
+
+// every kernel agrees with QDate over the whole range, whichever instruction set it runs on
+void TestCivil::kernels()
+{
+    QFETCH(QiCalCivil::Isa, isa);
+    QFETCH(qint32, first);
+    QFETCH(qint32, last);
+
+    if (QiCalCivil::supportedIsa() < isa)
+    {
+        QSKIP("instruction set not supported by this CPU");
+    }
+
+    QiCalCivil::setIsa(isa);
+    QCOMPARE(QiCalCivil::isa(), isa);
+
+    QVector<qint32> jd(BLOCK);
+    QVector<qint32> year(BLOCK);
+    QVector<qint32> month(BLOCK);
+    QVector<qint32> day(BLOCK);
+    QVector<qint32> dayOfWeek(BLOCK);
+    QVector<qint32> back(BLOCK);
+    QVector<qint32> week(BLOCK);
+    QVector<qint32> weekYear(BLOCK);
+
+    for (qint64 start = first; start < last; start += BLOCK)
+    {
+        const int count = int(std::min<qint64>(BLOCK, last - start));
+        for (int i = 0; i < count; i++)
+        {
+            jd[i] = qint32(start + i);
+        }
+
+        QiCalCivil::fromJulianDays(jd.constData(), count, year.data(), month.data(), day.data(), dayOfWeek.data());
+        QiCalCivil::toJulianDays(year.constData(), month.constData(), day.constData(), count, back.data());
+        QiCalCivil::isoWeeks(jd.constData(), count, week.data(), weekYear.data());
+
+        for (int i = 0; i < count; i++)
+        {
+            const QDate date = QDate::fromJulianDay(jd[i]);
+            int expectedWeekYear = 0;
+            const int expectedWeek = date.weekNumber(&expectedWeekYear);
+
+            if (year[i] != date.year() || month[i] != date.month() || day[i] != date.day()
+                    || dayOfWeek[i] != date.dayOfWeek() || back[i] != jd[i]
+                    || week[i] != expectedWeek || weekYear[i] != expectedWeekYear)
+            {
+                QFAIL(qPrintable(QString("mismatch at JD %1 (%2)").arg(jd[i]).arg(date.toString(Qt::ISODate))));
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestCivil)
+
+#include "tst_civil.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_conflicts
+
+SOURCES += \
+    tst_conflicts.cpp
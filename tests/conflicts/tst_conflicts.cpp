@@ -0,0 +1,258 @@
+#include <QtTest>
+
+#include "qicalconflicts.h"
+
+namespace
+{
+
+QDateTime at(const QString& time)
+{
+    return QDateTime(QDate(2024, 5, 6), QTime::fromString(time, "hh:mm"), Qt::UTC);
+}
+
+// "name hh:mm-hh:mm" is an interval, "name hh:mm" an event without DTEND
+QList<QiCalEvent*> events(QObject* owner, const QStringList& specs)
+{
+    QList<QiCalEvent*> result;
+    for (const QString& spec : specs)
+    {
+        QiCalEvent* event = new QiCalEvent(owner);
+        event->setUid(spec.section(' ', 0, 0));
+
+        const QString range = spec.section(' ', 1, 1);
+        event->setDtStart(at(range.section('-', 0, 0)));
+        if (range.contains('-'))
+        {
+            event->setDtEnd(at(range.section('-', 1, 1)));
+        }
+        result.append(event);
+    }
+
+    return result;
+}
+
+QStringList pairs(const QList<QiCalConflict>& conflicts)
+{
+    QStringList result;
+    for (const QiCalConflict& conflict : conflicts)
+    {
+        QStringList pair{ conflict.first->uid(), conflict.second->uid() };
+        pair.sort();
+        result.append(pair.join('+'));
+    }
+    result.sort();
+
+    return result;
+}
+
+QStringList groups(const QList<QList<QiCalEvent*> >& clusters)
+{
+    QStringList result;
+    for (const QList<QiCalEvent*>& cluster : clusters)
+    {
+        QStringList names;
+        for (const QiCalEvent* event : cluster)
+        {
+            names.append(event->uid());
+        }
+        names.sort();
+        result.append(names.join(','));
+    }
+    result.sort();
+
+    return result;
+}
+
+// an instant t overlaps [s, e) when s <= t < e, and other instants at t
+bool overlaps(qint64 s1, qint64 e1, qint64 s2, qint64 e2)
+{
+    if (s1 == e1 && s2 == e2)
+    {
+        return s1 == s2;
+    }
+
+    if (s1 == e1)
+    {
+        return s2 <= s1 && s1 < e2;
+    }
+
+    if (s2 == e2)
+    {
+        return s1 <= s2 && s2 < e1;
+    }
+
+    return s1 < e2 && s2 < e1;
+}
+
+}
+
+class TestConflicts : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void conflicts_data();
+    void conflicts();
+    void clusters_data();
+    void clusters();
+    void blocking();
+    void bruteForce();
+};
+
+void TestConflicts::conflicts_data()
+{
+    QTest::addColumn<QStringList>("specs");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("touching") << QStringList{ "a 09:00-10:00", "b 10:00-11:00" } << QStringList();
+    QTest::newRow("overlapping") << QStringList{ "a 09:00-10:00", "b 09:30-10:30" } << QStringList{ "a+b" };
+    QTest::newRow("nested") << QStringList{ "a 09:00-12:00", "b 10:00-11:00", "c 10:30-10:45", "d 11:00-11:30" }
+                            << QStringList{ "a+b", "a+c", "a+d", "b+c" };
+    QTest::newRow("same start") << QStringList{ "a 09:00-09:30", "b 09:00-10:00" } << QStringList{ "a+b" };
+    QTest::newRow("instant inside") << QStringList{ "a 09:00-10:00", "m 09:30" } << QStringList{ "a+m" };
+    QTest::newRow("instant at start") << QStringList{ "a 09:00-10:00", "m 09:00-09:00" } << QStringList{ "a+m" };
+    QTest::newRow("instant at end") << QStringList{ "a 09:00-10:00", "m 10:00" } << QStringList();
+    QTest::newRow("instants together") << QStringList{ "m 09:00", "n 09:00", "o 09:00-09:00" } << QStringList{ "m+n", "m+o", "n+o" };
+    QTest::newRow("instants apart") << QStringList{ "m 09:00", "n 09:01" } << QStringList();
+    QTest::newRow("end before start") << QStringList{ "a 10:00-09:00", "b 09:30-10:30" } << QStringList{ "a+b" };
+}
+
+void TestConflicts::conflicts()
+{
+    QFETCH(QStringList, specs);
+    QFETCH(QStringList, expected);
+
+    QObject owner;
+    QCOMPARE(pairs(QiCalConflictDetector().conflicts(events(&owner, specs))), expected);
+}
+
+void TestConflicts::clusters_data()
+{
+    QTest::addColumn<QStringList>("specs");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("chain") << QStringList{ "a 09:00-10:00", "b 09:30-11:00", "c 10:30-12:00", "d 13:00-14:00" }
+                           << QStringList{ "a,b,c" };
+    QTest::newRow("touching") << QStringList{ "a 09:00-10:00", "b 10:00-11:00" } << QStringList();
+    QTest::newRow("instant at end") << QStringList{ "a 09:00-10:00", "m 10:00" } << QStringList();
+    QTest::newRow("instants") << QStringList{ "m 09:00", "n 09:00", "a 10:00-11:00", "b 10:30-11:00" }
+                              << QStringList{ "a,b", "m,n" };
+    QTest::newRow("instant then interval") << QStringList{ "m 09:00", "a 09:00-10:00", "b 09:45-10:15" }
+                                           << QStringList{ "a,b,m" };
+}
+
+void TestConflicts::clusters()
+{
+    QFETCH(QStringList, specs);
+    QFETCH(QStringList, expected);
+
+    QObject owner;
+    QCOMPARE(groups(QiCalConflictDetector().clusters(events(&owner, specs))), expected);
+}
+
+// transparent and cancelled events never block; tentative ones only when asked to
+void TestConflicts::blocking()
+{
+    QObject owner;
+    const QList<QiCalEvent*> list = events(&owner, { "a 09:00-10:00", "b 09:00-10:00", "c 09:00-10:00", "d 09:00-10:00" });
+    list.at(1)->setTransp(QiCalEvent::TRANS_TRANSPARENT);
+    list.at(2)->setStatus(QiCalEvent::STAT_CANCELLED);
+    list.at(3)->setStatus(QiCalEvent::STAT_TENTATIVE);
+
+    QiCalConflictDetector detector;
+    QVERIFY(detector.isBlocking(list.at(0)));
+    QVERIFY(!detector.isBlocking(list.at(1)));
+    QVERIFY(!detector.isBlocking(list.at(2)));
+    QVERIFY(detector.isBlocking(list.at(3)));
+    QVERIFY(!detector.isBlocking(nullptr));
+    QCOMPARE(pairs(detector.conflicts(list)), QStringList{ "a+d" });
+
+    detector.setIncludeTentative(false);
+    QVERIFY(!detector.isBlocking(list.at(3)));
+    QVERIFY(detector.conflicts(list).isEmpty());
+}
+
+// the sweep must agree with checking every pair, and clusters with the connected components
+void TestConflicts::bruteForce()
+{
+    quint32 seed = 3;
+    const auto random = [&seed](int range) {
+        seed = seed * 1103515245u + 12345u;
+        return int((seed >> 16) % quint32(range));
+    };
+
+    for (int round = 0; round < 2000; round++)
+    {
+        QObject owner;
+        QList<QiCalEvent*> list;
+        const int count = random(8) + 1;
+        for (int i = 0; i < count; i++)
+        {
+            const int start = random(10);
+            const int length = random(3) == 0 ? 0 : random(4);
+            QiCalEvent* event = new QiCalEvent(&owner);
+            event->setUid(QString::number(i));
+            event->setDtStart(at("09:00").addSecs(start * 60));
+            event->setDtEnd(at("09:00").addSecs((start + length) * 60));
+            list.append(event);
+        }
+
+        QStringList expected;
+        QVector<int> component(count);
+        for (int i = 0; i < count; i++)
+        {
+            component[i] = i;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            for (int j = i + 1; j < count; j++)
+            {
+                const QiCalEvent* a = list.at(i);
+                const QiCalEvent* b = list.at(j);
+                if (overlaps(a->dtStart().toMSecsSinceEpoch(), a->dtEnd().toMSecsSinceEpoch(),
+                             b->dtStart().toMSecsSinceEpoch(), b->dtEnd().toMSecsSinceEpoch()))
+                {
+                    expected.append(QString("%1+%2").arg(i).arg(j));
+
+                    const int from = component[j];
+                    const int to = component[i];
+                    for (int k = 0; k < count; k++)
+                    {
+                        if (component[k] == from)
+                        {
+                            component[k] = to;
+                        }
+                    }
+                }
+            }
+        }
+        expected.sort();
+
+        QStringList expectedGroups;
+        for (int root = 0; root < count; root++)
+        {
+            QStringList names;
+            for (int k = 0; k < count; k++)
+            {
+                if (component[k] == root)
+                {
+                    names.append(QString::number(k));
+                }
+            }
+            if (names.size() > 1)
+            {
+                names.sort();
+                expectedGroups.append(names.join(','));
+            }
+        }
+        expectedGroups.sort();
+
+        QiCalConflictDetector detector;
+        QCOMPARE(pairs(detector.conflicts(list)), expected);
+        QCOMPARE(groups(detector.clusters(list)), expectedGroups);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestConflicts)
+
+#include "tst_conflicts.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_decompressor
+
+SOURCES += \
+    tst_decompressor.cpp
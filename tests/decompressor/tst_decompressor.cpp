@@ -0,0 +1,228 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "qicaldecompressor.h"
+#include "qicalendar.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+// incompressible enough to span several input blocks once deflated
+QByteArray payload(int size)
+{
+    QByteArray data;
+    data.reserve(size);
+    quint32 state = 12345;
+    while (data.size() < size)
+    {
+        state = state * 1103515245u + 12345u;
+        data.append(char('A' + (state >> 16) % 26));
+        if ((state >> 8) % 61 == 0)
+        {
+            data.append("\r\n");
+        }
+    }
+    data.resize(size);
+
+    return data;
+}
+
+QByteArray readAll(QiCalDecompressor& decompressor, int chunk)
+{
+    QByteArray data;
+    QByteArray buffer(chunk, '\0');
+    for (;;)
+    {
+        const qint64 read = decompressor.read(buffer.data(), chunk);
+        if (read <= 0)
+        {
+            break;
+        }
+        data.append(buffer.constData(), int(read));
+    }
+
+    return data;
+}
+
+}
+
+class TestDecompressor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void detect_data();
+    void detect();
+    void inflate_data();
+    void inflate();
+    void multipleMembers();
+    void truncated();
+    void corrupt();
+    void readOnly();
+    void parseCompressedFile();
+};
+
+void TestDecompressor::detect_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("plain") << QByteArray("BEGIN:VCALENDAR\r\n") << int(QiCalDecompressor::FMT_PLAIN);
+    QTest::newRow("empty") << QByteArray() << int(QiCalDecompressor::FMT_PLAIN);
+    QTest::newRow("gzip") << gzip("BEGIN:VCALENDAR\r\n") << int(QiCalDecompressor::FMT_GZIP);
+    QTest::newRow("zstd") << QByteArray("\x28\xb5\x2f\xfd\x00\x00", 6) << int(QiCalDecompressor::FMT_ZSTD);
+    QTest::newRow("short gzip") << QByteArray("\x1f", 1) << int(QiCalDecompressor::FMT_PLAIN);
+}
+
+void TestDecompressor::detect()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, format);
+
+    QBuffer source(&data);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QCOMPARE(int(QiCalDecompressor::detect(&source)), format);
+    // detection only peeks, the source stays at the start
+    QCOMPARE(source.pos(), qint64(0));
+}
+
+void TestDecompressor::inflate_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("chunk");
+
+    QTest::newRow("small") << 100 << 4096;
+    QTest::newRow("tiny reads") << 5000 << 7;
+    QTest::newRow("one block") << int(QiCalDecompressor::BLOCK_SIZE) << 4096;
+    QTest::newRow("several blocks") << 5 * int(QiCalDecompressor::BLOCK_SIZE) + 17 << 4096;
+    QTest::newRow("large reads") << 3 * int(QiCalDecompressor::BLOCK_SIZE) << (1 << 20);
+}
+
+void TestDecompressor::inflate()
+{
+    QFETCH(int, size);
+    QFETCH(int, chunk);
+
+    const QByteArray original = payload(size);
+    QByteArray compressed = gzip(original);
+    QBuffer source(&compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QiCalDecompressor decompressor(&source);
+    QCOMPARE(decompressor.format(), QiCalDecompressor::FMT_GZIP);
+    QVERIFY(decompressor.open(QIODevice::ReadOnly));
+
+    QCOMPARE(readAll(decompressor, chunk), original);
+    QVERIFY(decompressor.atEnd());
+    QVERIFY(!decompressor.hasError());
+}
+
+void TestDecompressor::multipleMembers()
+{
+    const QByteArray first = payload(1000);
+    const QByteArray second = payload(3 * int(QiCalDecompressor::BLOCK_SIZE)).mid(7);
+    QByteArray compressed = gzip(first) + gzip(second);
+    QBuffer source(&compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QiCalDecompressor decompressor(&source);
+    QVERIFY(decompressor.open(QIODevice::ReadOnly));
+
+    QCOMPARE(readAll(decompressor, 4096), first + second);
+    QVERIFY(!decompressor.hasError());
+}
+
+void TestDecompressor::truncated()
+{
+    QByteArray compressed = gzip(payload(2 * int(QiCalDecompressor::BLOCK_SIZE)));
+    compressed.chop(compressed.size() / 3);
+    QBuffer source(&compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QiCalDecompressor decompressor(&source);
+    QVERIFY(decompressor.open(QIODevice::ReadOnly));
+
+    readAll(decompressor, 4096);
+    QVERIFY(decompressor.hasError());
+    QVERIFY(!decompressor.errorString().isEmpty());
+}
+
+void TestDecompressor::corrupt()
+{
+    QByteArray compressed = gzip(payload(10000));
+    // past the 10 byte header, inside the deflate stream
+    for (int i = 12; i < 40; i++)
+    {
+        compressed[i] = char(compressed[i] ^ 0x5a);
+    }
+    QBuffer source(&compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QiCalDecompressor decompressor(&source);
+    QVERIFY(decompressor.open(QIODevice::ReadOnly));
+
+    readAll(decompressor, 4096);
+    QVERIFY(decompressor.hasError());
+}
+
+void TestDecompressor::readOnly()
+{
+    QByteArray compressed = gzip("BEGIN:VCALENDAR\r\n");
+    QBuffer source(&compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly));
+
+    QiCalDecompressor decompressor(&source);
+    QVERIFY(!decompressor.open(QIODevice::ReadWrite));
+    QVERIFY(decompressor.isSequential());
+}
+
+void TestDecompressor::parseCompressedFile()
+{
+    QByteArray ics("BEGIN:VCALENDAR\r\n"
+                   "VERSION:2.0\r\n"
+                   "PRODID:-//qiCalendar//tests//EN\r\n");
+    for (int i = 0; i < 2000; i++)
+    {
+        ics += "BEGIN:VEVENT\r\n"
+               "UID:event-" + QByteArray::number(i) + "@example.com\r\n"
+               "DTSTART:20240101T090000Z\r\n"
+               "DTEND:20240101T100000Z\r\n"
+               "SUMMARY:Event " + QByteArray::number(i) + "\r\n"
+               "END:VEVENT\r\n";
+    }
+    ics += "END:VCALENDAR\r\n";
+    QVERIFY(ics.size() > QiCalDecompressor::BLOCK_SIZE);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("calendar.ics.gz");
+    QFile file(path);
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(gzip(ics));
+    file.close();
+
+    QiCalendarParser parser;
+    QVERIFY(parser.parseFile(path));
+    const QList<QiCalEvent*>& events = parser.calendar()->events();
+    QCOMPARE(events.size(), 2000);
+    QCOMPARE(events.first()->uid(), QString("event-0@example.com"));
+    QCOMPARE(events.last()->uid(), QString("event-1999@example.com"));
+
+    // a damaged archive fails the parse instead of yielding a partial calendar
+    QByteArray damaged = gzip(ics);
+    damaged.chop(damaged.size() / 2);
+    QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+    file.write(damaged);
+    file.close();
+    QVERIFY(!parser.parseFile(path));
+}
+
+QTEST_GUILESS_MAIN(TestDecompressor)
+
+#include "tst_decompressor.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_diff
+
+SOURCES += \
+    tst_diff.cpp
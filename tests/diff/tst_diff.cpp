@@ -0,0 +1,256 @@
+#include <QtTest>
+
+#include "qicaldiff.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+QiCalEvent* event(QObject* owner, const QString& uid, const QString& summary = QString())
+{
+    QiCalEvent* result = new QiCalEvent(owner);
+    result->setUid(uid);
+    result->setSummary(summary.isEmpty() ? uid : summary);
+    result->setDtStart(utc(2024, 5, 6, 9, 0));
+    result->setDtEnd(utc(2024, 5, 6, 10, 0));
+    return result;
+}
+
+QiCalEvent* copy(QObject* owner, const QiCalEvent* source)
+{
+    QiCalEvent* result = event(owner, source->uid(), source->summary());
+    result->setDtStart(source->dtStart());
+    result->setDtEnd(source->dtEnd());
+    result->setSequence(source->sequence());
+    result->setLastModified(source->lastModified());
+    result->setMasterEvent(source->masterEvent());
+    return result;
+}
+
+QStringList uids(const QList<QiCalEvent*>& events)
+{
+    QStringList result;
+    for (const QiCalEvent* event : events)
+    {
+        result << event->uid();
+    }
+
+    return result;
+}
+
+}
+
+class TestDiff : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addedRemovedModified();
+    void sequence();
+    void lastModified();
+    void overrides();
+    void duplicateUids();
+    void fingerprint_data();
+    void fingerprint();
+};
+
+void TestDiff::addedRemovedModified()
+{
+    QObject owner;
+    QiCalEvent* a = event(&owner, "a");
+    QiCalEvent* b = event(&owner, "b");
+    QiCalEvent* c = event(&owner, "c");
+    QiCalEvent* a2 = copy(&owner, a);
+    QiCalEvent* b2 = copy(&owner, b);
+    b2->setSummary("b, moved");
+    QiCalEvent* d = event(&owner, "d");
+
+    const QiCalDiff diff = QiCalDiffer().diff(QList<QiCalEvent*>{ a, b, c }, QList<QiCalEvent*>{ d, b2, a2 });
+
+    QCOMPARE(uids(diff.added), QStringList{ "d" });
+    QCOMPARE(uids(diff.removed), QStringList{ "c" });
+    QCOMPARE(diff.modified.size(), 1);
+    QCOMPARE(diff.modified.at(0).before, b);
+    QCOMPARE(diff.modified.at(0).after, b2);
+}
+
+// a SEQUENCE bump is a change even if nothing else differs
+void TestDiff::sequence()
+{
+    QObject owner;
+    QiCalEvent* before = event(&owner, "a");
+    QiCalEvent* after = copy(&owner, before);
+
+    QiCalDiffer differ;
+    QVERIFY(!differ.isModified(before, after));
+
+    after->setSequence(1);
+    QVERIFY(differ.isModified(before, after));
+}
+
+// LAST-MODIFIED is trusted when both sides have it, unless content comparison is requested
+void TestDiff::lastModified()
+{
+    QObject owner;
+    QiCalEvent* before = event(&owner, "a");
+    before->setLastModified(utc(2024, 1, 1, 12, 0));
+    QiCalEvent* after = copy(&owner, before);
+    after->setLocation("Room 2");
+
+    QiCalDiffer differ;
+    QVERIFY(!differ.isModified(before, after));
+
+    differ.setCompareContent(true);
+    QVERIFY(differ.isModified(before, after));
+
+    differ.setCompareContent(false);
+    after->setLocation(QString());
+    after->setLastModified(utc(2024, 1, 2, 12, 0));
+    QVERIFY(differ.isModified(before, after));
+
+    after->setLastModified(QDateTime());
+    QVERIFY(!differ.isModified(before, after));
+}
+
+// overridden occurrences are keyed by UID and RECURRENCE-ID
+void TestDiff::overrides()
+{
+    QObject owner;
+    QiCalEvent* master = event(&owner, "series");
+    QiCalEvent* first = event(&owner, "series", "moved");
+    first->setMasterEvent(master);
+    first->setDtStart(utc(2024, 5, 13, 9, 0));
+    QiCalEvent* second = event(&owner, "series", "moved");
+    second->setMasterEvent(master);
+    second->setDtStart(utc(2024, 5, 20, 9, 0));
+
+    QiCalEvent* master2 = copy(&owner, master);
+    QiCalEvent* second2 = copy(&owner, second);
+    second2->setMasterEvent(master2);
+    second2->setSummary("moved again");
+
+    QCOMPARE(QiCalDiffer::key(master), QString("series"));
+    QVERIFY(QiCalDiffer::key(first) != QiCalDiffer::key(second));
+
+    const QiCalDiff diff = QiCalDiffer().diff(QList<QiCalEvent*>{ master, first, second }, QList<QiCalEvent*>{ master2, second2 });
+
+    QVERIFY(diff.added.isEmpty());
+    QCOMPARE(diff.removed, QList<QiCalEvent*>{ first });
+    QCOMPARE(diff.modified.size(), 1);
+    QCOMPARE(diff.modified.at(0).before, second);
+    QCOMPARE(diff.modified.at(0).after, second2);
+}
+
+// events sharing a UID are paired in document order
+void TestDiff::duplicateUids()
+{
+    QObject owner;
+    QiCalEvent* first = event(&owner, "dup", "first");
+    QiCalEvent* second = event(&owner, "dup", "second");
+    QiCalEvent* first2 = copy(&owner, first);
+    QiCalEvent* second2 = copy(&owner, second);
+
+    QiCalDiff diff = QiCalDiffer().diff(QList<QiCalEvent*>{ first, second }, QList<QiCalEvent*>{ first2, second2 });
+    QVERIFY(diff.added.isEmpty());
+    QVERIFY(diff.removed.isEmpty());
+    QVERIFY(diff.modified.isEmpty());
+
+    diff = QiCalDiffer().diff(QList<QiCalEvent*>{ first, second }, QList<QiCalEvent*>{ first2 });
+    QCOMPARE(diff.removed, QList<QiCalEvent*>{ second });
+}
+
+// every property that ends up in the file changes the fingerprint
+void TestDiff::fingerprint_data()
+{
+    QTest::addColumn<QString>("property");
+
+    for (const char* property : { "dtStart", "dtEnd", "allDay", "zone", "summary", "description", "location", "status",
+                                  "transp", "exDates", "rDates", "rule", "alarm", "separator" })
+    {
+        QTest::newRow(property) << QString(property);
+    }
+}
+
+void TestDiff::fingerprint()
+{
+    QFETCH(QString, property);
+
+    QObject owner;
+    QiCalEvent* before = event(&owner, "a");
+    QiCalEvent* after = copy(&owner, before);
+    QCOMPARE(QiCalDiffer::fingerprint(after), QiCalDiffer::fingerprint(before));
+
+    if (property == "dtStart")
+    {
+        after->setDtStart(after->dtStart().addSecs(60));
+    }
+    else if (property == "dtEnd")
+    {
+        after->setDtEnd(after->dtEnd().addSecs(60));
+    }
+    else if (property == "allDay")
+    {
+        after->setAllDay(true);
+    }
+    else if (property == "zone")
+    {
+        after->setZone(QiCalZoneTable::fromTransitions("Etc/Test", 2000, 2030, 3600, nullptr, 0));
+    }
+    else if (property == "summary")
+    {
+        after->setSummary("other");
+    }
+    else if (property == "description")
+    {
+        after->setDescription("other");
+    }
+    else if (property == "location")
+    {
+        after->setLocation("other");
+    }
+    else if (property == "status")
+    {
+        after->setStatus(QiCalEvent::STAT_CANCELLED);
+    }
+    else if (property == "transp")
+    {
+        after->setTransp(QiCalEvent::TRANS_TRANSPARENT);
+    }
+    else if (property == "exDates")
+    {
+        after->setExDates({ utc(2024, 5, 13, 9, 0).toMSecsSinceEpoch() });
+    }
+    else if (property == "rDates")
+    {
+        after->setRDates({ utc(2024, 5, 14, 9, 0).toMSecsSinceEpoch() });
+    }
+    else if (property == "rule")
+    {
+        QiCalRule* rule = new QiCalRule();
+        rule->setFreq(QiCalRule::RR_WEEKLY);
+        after->setRule(rule);
+    }
+    else if (property == "alarm")
+    {
+        QiCalAlarm* alarm = new QiCalAlarm();
+        alarm->setTrigger("-PT5M");
+        after->addAlarm(alarm);
+    }
+    else if (property == "separator")
+    {
+        // the same text with the boundary between two fields moved
+        before->setSummary("A|");
+        before->setDescription("B");
+        after->setSummary("A");
+        after->setDescription("|B");
+    }
+
+    QVERIFY(QiCalDiffer::fingerprint(after) != QiCalDiffer::fingerprint(before));
+    QVERIFY(QiCalDiffer().isModified(before, after));
+}
+
+QTEST_GUILESS_MAIN(TestDiff)
+
+#include "tst_diff.moc"
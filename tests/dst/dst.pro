@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_dst
+
+SOURCES += \
+    tst_dst.cpp
@@ -0,0 +1,231 @@
+#include <QtTest>
+
+#include "qicalevent.h"
+#include "qicalrecurrence.h"
+#include "qicalrule.h"
+#include "qicaltimezone.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+QSharedPointer<const QiCalZoneTable> centralEuropeTable()
+{
+    QiCalTimeZone timeZone;
+    centralEurope(&timeZone);
+    timeZone.setHorizon(2000, 2030);
+    return timeZone.zoneTable();
+}
+
+}
+
+class TestDst : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void offsets();
+    void localToUtc_data();
+    void localToUtc();
+    void expansion_data();
+    void expansion();
+    void subDaily_data();
+    void subDaily();
+    void randomAccess();
+
+private:
+    QSharedPointer<const QiCalZoneTable> m_zone;
+};
+
+void TestDst::initTestCase()
+{
+    m_zone = centralEuropeTable();
+    QVERIFY(!m_zone.isNull());
+    QVERIFY(!m_zone->isFixed());
+}
+
+void TestDst::offsets()
+{
+    const qint64 springForward = wall(2024, 3, 31, 1, 0);
+    const qint64 fallBack = wall(2024, 10, 27, 1, 0);
+
+    QCOMPARE(m_zone->offsetAtUtc(wall(2024, 1, 15, 12, 0)), 3600);
+    QCOMPARE(m_zone->offsetAtUtc(springForward - 1), 3600);
+    QCOMPARE(m_zone->offsetAtUtc(springForward), 7200);
+    QCOMPARE(m_zone->offsetAtUtc(wall(2024, 7, 1, 12, 0)), 7200);
+    QCOMPARE(m_zone->offsetAtUtc(fallBack - 1), 7200);
+    QCOMPARE(m_zone->offsetAtUtc(fallBack), 3600);
+    QCOMPARE(m_zone->toLocal(wall(2024, 10, 27, 1, 30)), wall(2024, 10, 27, 2, 30));
+}
+
+// local times in the spring gap move forward by the gap, ambiguous ones take the earlier (daylight) offset
+void TestDst::localToUtc_data()
+{
+    QTest::addColumn<qint64>("local");
+    QTest::addColumn<qint64>("expected");
+
+    QTest::newRow("before gap") << wall(2024, 3, 31, 1, 59) << wall(2024, 3, 31, 0, 59);
+    QTest::newRow("in gap") << wall(2024, 3, 31, 2, 30) << wall(2024, 3, 31, 1, 30);
+    QTest::newRow("after gap") << wall(2024, 3, 31, 3, 0) << wall(2024, 3, 31, 1, 0);
+    QTest::newRow("before overlap") << wall(2024, 10, 27, 1, 59) << wall(2024, 10, 26, 23, 59);
+    QTest::newRow("in overlap") << wall(2024, 10, 27, 2, 30) << wall(2024, 10, 27, 0, 30);
+    QTest::newRow("after overlap") << wall(2024, 10, 27, 3, 0) << wall(2024, 10, 27, 2, 0);
+}
+
+void TestDst::localToUtc()
+{
+    QFETCH(qint64, local);
+    QFETCH(qint64, expected);
+
+    QCOMPARE(m_zone->toUtc(local), expected);
+}
+
+// occurrences keep DTSTART's wall clock time on both sides of a transition
+void TestDst::expansion_data()
+{
+    QTest::addColumn<QDate>("startDate");
+    QTest::addColumn<QTime>("startTime");
+    QTest::addColumn<QList<QDateTime>>("expected");
+    QTest::addColumn<QList<int>>("offsets");
+
+    QTest::newRow("spring forward")
+        << QDate(2024, 3, 29) << QTime(9, 0)
+        << QList<QDateTime>{ utc(2024, 3, 29, 8, 0), utc(2024, 3, 30, 8, 0), utc(2024, 3, 31, 7, 0), utc(2024, 4, 1, 7, 0) }
+        << QList<int>{ 3600, 3600, 7200, 7200 };
+    QTest::newRow("fall back")
+        << QDate(2024, 10, 25) << QTime(9, 0)
+        << QList<QDateTime>{ utc(2024, 10, 25, 7, 0), utc(2024, 10, 26, 7, 0), utc(2024, 10, 27, 8, 0), utc(2024, 10, 28, 8, 0) }
+        << QList<int>{ 7200, 7200, 3600, 3600 };
+    QTest::newRow("inside the gap")
+        << QDate(2024, 3, 30) << QTime(2, 30)
+        << QList<QDateTime>{ utc(2024, 3, 30, 1, 30), utc(2024, 3, 31, 1, 30), utc(2024, 4, 1, 0, 30), utc(2024, 4, 2, 0, 30) }
+        << QList<int>{ 3600, 7200, 7200, 7200 };
+    QTest::newRow("inside the overlap")
+        << QDate(2024, 10, 26) << QTime(2, 30)
+        << QList<QDateTime>{ utc(2024, 10, 26, 0, 30), utc(2024, 10, 27, 0, 30), utc(2024, 10, 28, 1, 30), utc(2024, 10, 29, 1, 30) }
+        << QList<int>{ 7200, 7200, 3600, 3600 };
+}
+
+void TestDst::expansion()
+{
+    QFETCH(QDate, startDate);
+    QFETCH(QTime, startTime);
+    QFETCH(QList<QDateTime>, expected);
+    QFETCH(QList<int>, offsets);
+
+    QiCalEvent event;
+    event.setZone(m_zone);
+    event.setDtStart(m_zone->toDateTime(startDate, startTime));
+
+    QiCalRule rule;
+    rule.setFreq(QiCalRule::RR_DAILY);
+    rule.setCount(expected.size());
+    rule.setCalEvent(&event);
+
+    QiCalRecurrence recurrence(&rule);
+    for (int i = 0; i < expected.size(); i++)
+    {
+        QVERIFY(recurrence.hasNext());
+        const QDateTime occurrence = recurrence.next();
+        QCOMPARE(occurrence, expected[i]);
+        QCOMPARE(occurrence.offsetFromUtc(), offsets[i]);
+    }
+    QVERIFY(!recurrence.hasNext());
+}
+
+// wall times in the gap resolve one hour later; a later candidate at that same instant is not repeated
+void TestDst::subDaily_data()
+{
+    QTest::addColumn<int>("freq");
+    QTest::addColumn<int>("interval");
+    QTest::addColumn<QDateTime>("start");
+    QTest::addColumn<QList<QDateTime>>("expected");
+    QTest::addColumn<QList<int>>("offsets");
+
+    QTest::newRow("hourly")
+        << int(QiCalRule::RR_HOURLY) << 1 << m_zone->toDateTime(QDate(2024, 3, 31), QTime(0, 0))
+        << QList<QDateTime>{ utc(2024, 3, 30, 23, 0), utc(2024, 3, 31, 0, 0), utc(2024, 3, 31, 1, 0), utc(2024, 3, 31, 2, 0), utc(2024, 3, 31, 3, 0) }
+        << QList<int>{ 3600, 3600, 7200, 7200, 7200 };
+    QTest::newRow("every other hour")
+        << int(QiCalRule::RR_HOURLY) << 2 << m_zone->toDateTime(QDate(2024, 3, 31), QTime(0, 0))
+        << QList<QDateTime>{ utc(2024, 3, 30, 23, 0), utc(2024, 3, 31, 1, 0), utc(2024, 3, 31, 2, 0), utc(2024, 3, 31, 4, 0) }
+        << QList<int>{ 3600, 7200, 7200, 7200 };
+    QTest::newRow("hourly fall back")
+        << int(QiCalRule::RR_HOURLY) << 1 << m_zone->toDateTime(QDate(2024, 10, 27), QTime(0, 0))
+        << QList<QDateTime>{ utc(2024, 10, 26, 22, 0), utc(2024, 10, 26, 23, 0), utc(2024, 10, 27, 0, 0), utc(2024, 10, 27, 2, 0), utc(2024, 10, 27, 3, 0) }
+        << QList<int>{ 7200, 7200, 7200, 3600, 3600 };
+    QTest::newRow("every 30 minutes")
+        << int(QiCalRule::RR_MINUTELY) << 30 << m_zone->toDateTime(QDate(2024, 3, 31), QTime(1, 0))
+        << QList<QDateTime>{ utc(2024, 3, 31, 0, 0), utc(2024, 3, 31, 0, 30), utc(2024, 3, 31, 1, 0), utc(2024, 3, 31, 1, 30), utc(2024, 3, 31, 2, 0) }
+        << QList<int>{ 3600, 3600, 7200, 7200, 7200 };
+    QTest::newRow("every 20 minutes")
+        << int(QiCalRule::RR_MINUTELY) << 20 << m_zone->toDateTime(QDate(2024, 3, 31), QTime(1, 40))
+        << QList<QDateTime>{ utc(2024, 3, 31, 0, 40), utc(2024, 3, 31, 1, 0), utc(2024, 3, 31, 1, 20), utc(2024, 3, 31, 1, 40), utc(2024, 3, 31, 2, 0),
+                             utc(2024, 3, 31, 2, 20) }
+        << QList<int>{ 3600, 7200, 7200, 7200, 7200, 7200 };
+}
+
+void TestDst::subDaily()
+{
+    QFETCH(int, freq);
+    QFETCH(int, interval);
+    QFETCH(QDateTime, start);
+    QFETCH(QList<QDateTime>, expected);
+    QFETCH(QList<int>, offsets);
+
+    QiCalEvent event;
+    event.setZone(m_zone);
+    event.setDtStart(start);
+
+    QiCalRule rule;
+    rule.setFreq(QiCalRule::Freq(freq));
+    rule.setInterval(interval);
+    rule.setCount(expected.size());
+    rule.setCalEvent(&event);
+
+    QiCalRecurrence recurrence(&rule);
+    for (int i = 0; i < expected.size(); i++)
+    {
+        QVERIFY(recurrence.hasNext());
+        const QDateTime occurrence = recurrence.next();
+        QCOMPARE(occurrence, expected[i]);
+        QCOMPARE(occurrence.offsetFromUtc(), offsets[i]);
+        QCOMPARE(recurrence.occurrenceAt(i), expected[i]);
+        QCOMPARE(recurrence.indexOf(expected[i]), qint64(i));
+    }
+    QVERIFY(!recurrence.hasNext());
+    QCOMPARE(recurrence.lastOccurrence(), expected.last());
+
+    recurrence.reset(expected[2]);
+    QCOMPARE(recurrence.next(), expected[2]);
+}
+
+void TestDst::randomAccess()
+{
+    QiCalEvent event;
+    event.setZone(m_zone);
+    event.setDtStart(m_zone->toDateTime(QDate(2024, 1, 1), QTime(9, 0)));
+
+    QiCalRule rule;
+    rule.setFreq(QiCalRule::RR_WEEKLY);
+    rule.setDayList("SU");
+    rule.setCalEvent(&event);
+
+    QiCalRecurrence recurrence(&rule);
+    const QList<QDateTime> all = recurrence.between(utc(2024, 1, 1, 0, 0), utc(2025, 1, 1, 0, 0));
+    QCOMPARE(all.size(), 53);
+
+    for (int i = 0; i < all.size(); i++)
+    {
+        QCOMPARE(all[i].toOffsetFromUtc(all[i].offsetFromUtc()).time(), QTime(9, 0));
+        QCOMPARE(recurrence.occurrenceAt(i), all[i]);
+        QCOMPARE(recurrence.indexOf(all[i]), qint64(i));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestDst)
+
+#include "tst_dst.moc"
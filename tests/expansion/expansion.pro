@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_expansion
+
+SOURCES += \
+    tst_expansion.cpp
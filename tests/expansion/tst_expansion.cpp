@@ -0,0 +1,150 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "qicalendar.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+// enough rules for five workers, since each worker needs at least 64 of them
+const int RULES = 5 * 64;
+const int SINGLES = 20;
+
+// many rules start at the same wall time, so the merge has plenty of ties to order
+QByteArray fixture()
+{
+    static const char* const rules[] = {
+        "FREQ=DAILY;INTERVAL=%1",
+        "FREQ=WEEKLY;BYDAY=MO,WE,FR",
+        "FREQ=MONTHLY;BYMONTHDAY=1,15,-1",
+        "FREQ=HOURLY;INTERVAL=%1;COUNT=50"
+    };
+
+    QByteArray text = "BEGIN:VCALENDAR\r\n"
+                      "VERSION:2.0\r\n"
+                      "PRODID:-//qiCalendar//tests//EN\r\n"
+                      "BEGIN:VTIMEZONE\r\n"
+                      "TZID:Europe/Prague\r\n"
+                      "BEGIN:STANDARD\r\n"
+                      "DTSTART:19701025T030000\r\n"
+                      "TZOFFSETFROM:+0200\r\n"
+                      "TZOFFSETTO:+0100\r\n"
+                      "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n"
+                      "END:STANDARD\r\n"
+                      "BEGIN:DAYLIGHT\r\n"
+                      "DTSTART:19700329T020000\r\n"
+                      "TZOFFSETFROM:+0100\r\n"
+                      "TZOFFSETTO:+0200\r\n"
+                      "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"
+                      "END:DAYLIGHT\r\n"
+                      "END:VTIMEZONE\r\n";
+
+    for (int i = 0; i < RULES; i++)
+    {
+        const QByteArray day = QDate(2024, 1, 1 + i % 28).toString("yyyyMMdd").toLatin1();
+        const QByteArray zone = i % 3 == 0 ? ";TZID=Europe/Prague" : "";
+        const QByteArray suffix = i % 3 == 0 ? "" : "Z";
+
+        text += "BEGIN:VEVENT\r\n"
+                "UID:rule-" + QByteArray::number(i) + "\r\n"
+                "DTSTART" + zone + ":" + day + "T090000" + suffix + "\r\n"
+                "DTEND" + zone + ":" + day + "T100000" + suffix + "\r\n"
+                "RRULE:" + QByteArray(rules[i % 4]).replace("%1", QByteArray::number(i % 5 + 1)) + "\r\n";
+        if (i % 7 == 0)
+        {
+            text += "EXDATE" + zone + ":" + QDate(2024, 2, 1 + i % 28).toString("yyyyMMdd").toLatin1() + "T090000" + suffix + "\r\n";
+        }
+        text += "END:VEVENT\r\n";
+    }
+
+    for (int i = 0; i < SINGLES; i++)
+    {
+        text += "BEGIN:VEVENT\r\n"
+                "UID:single-" + QByteArray::number(i) + "\r\n"
+                "DTSTART:" + QDate(2024, 3, 1 + i).toString("yyyyMMdd").toLatin1() + "T090000Z\r\n"
+                "END:VEVENT\r\n";
+    }
+
+    return text + "END:VCALENDAR\r\n";
+}
+
+QStringList describe(const QList<QiCalEvent*>& events)
+{
+    QStringList lines;
+    for (const QiCalEvent* event : events)
+    {
+        lines.append(QString("%1 %2 %3 %4").arg(event->uid(), event->dtStart().toString(Qt::ISODate),
+                                                 event->dtEnd().toString(Qt::ISODate))
+                     .arg(event->dtStart().offsetFromUtc()));
+    }
+
+    return lines;
+}
+
+}
+
+class TestExpansion : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void parallel_data();
+    void parallel();
+
+private:
+    QTemporaryDir m_dir;
+    QiCalendarParser m_parser;
+    QStringList m_sequential;
+};
+
+void TestExpansion::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    const QString path = m_dir.filePath("expansion.ics");
+    QVERIFY(writeFile(path, fixture()));
+    QVERIFY(m_parser.parseFile(path));
+    QCOMPARE(m_parser.calendar()->rules().size(), RULES);
+
+    m_parser.setExpansionThreads(1);
+    const QList<QiCalEvent*> events = m_parser.eventsRange(utc(2024, 1, 1, 0, 0), utc(2024, 7, 1, 0, 0));
+    QVERIFY(events.size() > 10000);
+    for (int i = 1; i < events.size(); i++)
+    {
+        QVERIFY(events.at(i - 1)->dtStart() <= events.at(i)->dtStart());
+    }
+
+    m_sequential = describe(events);
+}
+
+void TestExpansion::parallel_data()
+{
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("two") << 2;
+    QTest::newRow("three") << 3;
+    QTest::newRow("five") << 5;
+    QTest::newRow("more than the rules allow") << 16;
+    QTest::newRow("hardware") << 0;
+}
+
+// splitting rules across workers and merging their buffers yields exactly the sequential list,
+// including the order of occurrences that start at the same instant
+void TestExpansion::parallel()
+{
+    QFETCH(int, threads);
+
+    m_parser.setExpansionThreads(threads);
+    QCOMPARE(m_parser.expansionThreads(), threads);
+
+    const QList<QiCalEvent*> events = m_parser.eventsRange(utc(2024, 1, 1, 0, 0), utc(2024, 7, 1, 0, 0));
+    QCOMPARE(describe(events), m_sequential);
+}
+
+QTEST_GUILESS_MAIN(TestExpansion)
+
+#include "tst_expansion.moc"
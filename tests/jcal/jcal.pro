@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_jcal
+
+SOURCES += \
+    tst_jcal.cpp
@@ -0,0 +1,342 @@
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "qicaljcalwriter.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+// the jCal document as QJsonDocument reads it; a parse error fails the calling test
+QJsonArray parse(const QByteArray& json)
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError || !document.isArray())
+    {
+        qWarning("%s at %d", qPrintable(error.errorString()), error.offset);
+        return QJsonArray();
+    }
+
+    return document.array();
+}
+
+QJsonArray components(const QJsonArray& component, const QString& name)
+{
+    QJsonArray found;
+    for (const QJsonValue& child : component.at(2).toArray())
+    {
+        if (child.toArray().at(0).toString() == name)
+        {
+            found.append(child);
+        }
+    }
+
+    return found;
+}
+
+QJsonArray property(const QJsonArray& component, const QString& name)
+{
+    for (const QJsonValue& prop : component.at(1).toArray())
+    {
+        if (prop.toArray().at(0).toString() == name)
+        {
+            return prop.toArray();
+        }
+    }
+
+    return QJsonArray();
+}
+
+}
+
+class TestJCal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void structure();
+    void parameters();
+    void dateLists();
+    void recur();
+    void utcOffset_data();
+    void utcOffset();
+    void escaping_data();
+    void escaping();
+    void occurrences();
+
+private:
+    QiCalCalendar* m_calendar = nullptr;
+    QJsonArray m_document;
+};
+
+void TestJCal::initTestCase()
+{
+    m_calendar = new QiCalCalendar();
+    QiCalTimeZone* timeZone = new QiCalTimeZone();
+    centralEurope(timeZone);
+    m_calendar->addTimeZone(timeZone);
+
+    QiCalEvent* meeting = new QiCalEvent();
+    meeting->setUid("jcal-1@example.com");
+    meeting->setSummary("Planning");
+    meeting->setDtStart(utc(2024, 4, 2, 8, 0));
+    meeting->setDtEnd(utc(2024, 4, 2, 9, 30));
+    meeting->setSequence(3);
+    QiCalRule* weekly = new QiCalRule();
+    weekly->setFreq(QiCalRule::RR_WEEKLY);
+    weekly->setCount(10);
+    weekly->setDayList("TU,TH");
+    meeting->setRule(weekly);
+    weekly->setCalEvent(meeting);
+    meeting->setExDates({ utc(2024, 4, 4, 8, 0).toMSecsSinceEpoch(), utc(2024, 4, 11, 8, 0).toMSecsSinceEpoch() });
+    QiCalAlarm* alarm = new QiCalAlarm();
+    alarm->setAction(QiCalAlarm::ACT_DISPLAY);
+    alarm->setDescription("Reminder");
+    alarm->setTrigger("-PT15M");
+    meeting->addAlarm(alarm);
+    m_calendar->addEvent(meeting);
+
+    const QSharedPointer<const QiCalZoneTable> zone = timeZone->zoneTable();
+    QiCalEvent* standup = new QiCalEvent();
+    standup->setUid("jcal-2@example.com");
+    standup->setSummary("Standup");
+    standup->setZone(zone);
+    standup->setDtStart(zone->toDateTime(QDate(2024, 3, 29), QTime(9, 0)));
+    QiCalRule* monthly = new QiCalRule();
+    monthly->setFreq(QiCalRule::RR_MONTHLY);
+    monthly->setInterval(2);
+    monthly->setDayList("-1FR");
+    monthly->setMonthList("3,5");
+    monthly->setUntil(utc(2025, 1, 1, 0, 0));
+    standup->setRule(monthly);
+    monthly->setCalEvent(standup);
+    standup->setRDates({ zone->toDateTime(QDate(2024, 4, 3), QTime(9, 0)).toMSecsSinceEpoch(),
+                         zone->toDateTime(QDate(2024, 6, 3), QTime(9, 0)).toMSecsSinceEpoch() });
+    m_calendar->addEvent(standup);
+
+    QiCalJCalWriter writer;
+    QVERIFY(writer.writeCalendar(m_calendar));
+    m_document = parse(writer.buffer());
+    QVERIFY(!m_document.isEmpty());
+}
+
+void TestJCal::cleanupTestCase()
+{
+    delete m_calendar;
+}
+
+// [name, [properties], [components]] all the way down, with lowercase names
+void TestJCal::structure()
+{
+    QCOMPARE(m_document.size(), 3);
+    QCOMPARE(m_document.at(0).toString(), QString("vcalendar"));
+    QCOMPARE(property(m_document, "version"), QJsonArray({ "version", QJsonObject(), "text", "2.0" }));
+    QCOMPARE(property(m_document, "prodid").at(2).toString(), QString("text"));
+
+    const QJsonArray zones = components(m_document, "vtimezone");
+    QCOMPARE(zones.size(), 1);
+    const QJsonArray zone = zones.at(0).toArray();
+    QCOMPARE(property(zone, "tzid"), QJsonArray({ "tzid", QJsonObject(), "text", "Europe/Prague" }));
+    QCOMPARE(components(zone, "standard").size(), 1);
+    QCOMPARE(components(zone, "daylight").size(), 1);
+
+    const QJsonArray events = components(m_document, "vevent");
+    QCOMPARE(events.size(), 2);
+    for (const QJsonValue& value : events)
+    {
+        const QJsonArray event = value.toArray();
+        QCOMPARE(event.size(), 3);
+        QVERIFY(event.at(1).isArray());
+        QVERIFY(event.at(2).isArray());
+        for (const QJsonValue& prop : event.at(1).toArray())
+        {
+            QVERIFY(prop.toArray().size() >= 4);
+            QCOMPARE(prop.toArray().at(0).toString(), prop.toArray().at(0).toString().toLower());
+            QVERIFY(prop.toArray().at(1).isObject());
+        }
+    }
+
+    const QJsonArray meeting = events.at(0).toArray();
+    QCOMPARE(property(meeting, "sequence"), QJsonArray({ "sequence", QJsonObject(), "integer", 3 }));
+    QCOMPARE(property(meeting, "dtstart"), QJsonArray({ "dtstart", QJsonObject(), "date-time", "2024-04-02T08:00:00Z" }));
+
+    const QJsonArray alarms = components(meeting, "valarm");
+    QCOMPARE(alarms.size(), 1);
+    QCOMPARE(property(alarms.at(0).toArray(), "trigger"), QJsonArray({ "trigger", QJsonObject(), "duration", "-PT15M" }));
+}
+
+// TZID travels as a property parameter and the value stays in local time
+void TestJCal::parameters()
+{
+    const QJsonArray standup = components(m_document, "vevent").at(1).toArray();
+    const QJsonObject tzid({ { "tzid", "Europe/Prague" } });
+
+    QCOMPARE(property(standup, "dtstart"), QJsonArray({ "dtstart", tzid, "date-time", "2024-03-29T09:00:00" }));
+    QCOMPARE(property(standup, "uid").at(1).toObject(), QJsonObject());
+}
+
+// several RDATE/EXDATE values share one property, one array element each
+void TestJCal::dateLists()
+{
+    const QJsonArray events = components(m_document, "vevent");
+
+    QCOMPARE(property(events.at(0).toArray(), "exdate"),
+             QJsonArray({ "exdate", QJsonObject(), "date-time", "2024-04-04T08:00:00Z", "2024-04-11T08:00:00Z" }));
+    QCOMPARE(property(events.at(1).toArray(), "rdate"),
+             QJsonArray({ "rdate", QJsonObject({ { "tzid", "Europe/Prague" } }), "date-time",
+                          "2024-04-03T09:00:00", "2024-06-03T09:00:00" }));
+    QVERIFY(property(events.at(0).toArray(), "rdate").isEmpty());
+}
+
+// recur values are objects; a single BYxxx value is a scalar, several are an array
+void TestJCal::recur()
+{
+    const QJsonArray events = components(m_document, "vevent");
+
+    const QJsonArray weekly = property(events.at(0).toArray(), "rrule");
+    QCOMPARE(weekly.at(2).toString(), QString("recur"));
+    QCOMPARE(weekly.at(3).toObject(), QJsonObject({ { "freq", "WEEKLY" }, { "count", 10 }, { "byday", QJsonArray({ "TU", "TH" }) } }));
+
+    const QJsonArray monthly = property(events.at(1).toArray(), "rrule");
+    QCOMPARE(monthly.at(3).toObject(), QJsonObject({ { "freq", "MONTHLY" }, { "until", "2025-01-01T00:00:00Z" }, { "interval", 2 },
+                                                     { "byday", "-1FR" }, { "bymonth", QJsonArray({ 3, 5 }) } }));
+
+    const QJsonArray daylight = components(components(m_document, "vtimezone").at(0).toArray(), "daylight").at(0).toArray();
+    QCOMPARE(property(daylight, "rrule").at(3).toObject(), QJsonObject({ { "freq", "YEARLY" }, { "byday", "-1SU" }, { "bymonth", 3 } }));
+}
+
+void TestJCal::utcOffset_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("positive") << 7200 << "+02:00";
+    QTest::newRow("half hour") << 19800 << "+05:30";
+    QTest::newRow("negative") << -12600 << "-03:30";
+    QTest::newRow("zero") << 0 << "+00:00";
+    QTest::newRow("seconds") << -(3 * 3600 + 25 * 60 + 45) << "-03:25:45";
+}
+
+void TestJCal::utcOffset()
+{
+    QFETCH(int, offset);
+    QFETCH(QString, expected);
+
+    QiCalCalendar calendar;
+    QiCalTimeZone* timeZone = new QiCalTimeZone();
+    timeZone->setTzId("Custom/Fixed");
+    QiCalTzInfo* standard = new QiCalTzInfo();
+    standard->setOffsetFrom(offset);
+    standard->setOffsetTo(offset);
+    standard->setDtStart(QDateTime(QDate(1970, 1, 1), QTime(0, 0)));
+    timeZone->setStandard(standard);
+    calendar.addTimeZone(timeZone);
+
+    QiCalJCalWriter writer;
+    QVERIFY(writer.writeCalendar(&calendar));
+    const QJsonArray document = parse(writer.buffer());
+    const QJsonArray observance = components(components(document, "vtimezone").at(0).toArray(), "standard").at(0).toArray();
+
+    QCOMPARE(property(observance, "tzoffsetfrom"), QJsonArray({ "tzoffsetfrom", QJsonObject(), "utc-offset", expected }));
+    QCOMPARE(property(observance, "tzoffsetto").at(3).toString(), expected);
+    QCOMPARE(property(observance, "dtstart").at(3).toString(), QString("1970-01-01T00:00:00"));
+}
+
+void TestJCal::escaping_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("quotes") << "say \"hi\" \\ bye" << "say \"hi\" \\ bye";
+    QTest::newRow("whitespace") << "a\nb\rc\td" << "a\nb\rc\td";
+    QTest::newRow("controls") << QString::fromUtf8("\x01\x1f\x7f") << QString::fromUtf8("\x01\x1f\x7f");
+    QTest::newRow("non-ascii") << QString::fromUtf8("Überprüfung – 会議") << QString::fromUtf8("Überprüfung – 会議");
+    QTest::newRow("surrogate pair") << QString::fromUtf8("party \xF0\x9F\x8E\x89") << QString::fromUtf8("party \xF0\x9F\x8E\x89");
+    QTest::newRow("lone high surrogate") << (QString("a") + QChar(0xd83c) + "b") << (QString("a") + QChar(QChar::ReplacementCharacter) + "b");
+    QTest::newRow("lone low surrogate") << (QString("a") + QChar(0xdf89)) << (QString("a") + QChar(QChar::ReplacementCharacter));
+}
+
+// whatever the text holds, the output is valid UTF-8 JSON that decodes back to it
+void TestJCal::escaping()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, expected);
+
+    QiCalCalendar calendar;
+    QiCalEvent* event = new QiCalEvent();
+    event->setUid("jcal-escape@example.com");
+    event->setSummary(text);
+    event->setDtStart(utc(2024, 1, 1, 9, 0));
+    calendar.addEvent(event);
+
+    QiCalJCalWriter writer;
+    QVERIFY(writer.writeCalendar(&calendar));
+    for (char c : writer.buffer())
+    {
+        QVERIFY(uchar(c) >= 0x20);
+    }
+
+    const QJsonArray document = parse(writer.buffer());
+    QVERIFY(!document.isEmpty());
+    QCOMPARE(property(components(document, "vevent").at(0).toArray(), "summary").at(3).toString(), expected);
+}
+
+// expanded instances carry RECURRENCE-ID and the master's alarms, but no rule of their own
+void TestJCal::occurrences()
+{
+    QiCalEvent* master = m_calendar->events().at(0);
+    QiCalEvent* standupMaster = m_calendar->events().at(1);
+
+    QList<QiCalEvent*> instances;
+    for (const QDateTime& start : { utc(2024, 4, 2, 8, 0), utc(2024, 4, 9, 8, 0) })
+    {
+        QiCalEvent* instance = new QiCalEvent(m_calendar);
+        instance->setMasterEvent(master);
+        instance->setUid(master->uid());
+        instance->setSummary(master->summary());
+        instance->setDtStart(start);
+        instances.append(instance);
+    }
+
+    const QSharedPointer<const QiCalZoneTable> zone = standupMaster->zone();
+    QiCalEvent* standup = new QiCalEvent(m_calendar);
+    standup->setMasterEvent(standupMaster);
+    standup->setUid(standupMaster->uid());
+    standup->setZone(zone);
+    standup->setDtStart(zone->toDateTime(QDate(2024, 5, 31), QTime(9, 0)));
+    instances.append(standup);
+
+    QiCalJCalWriter writer;
+    QVERIFY(writer.writeOccurrences(m_calendar, instances));
+    const QJsonArray document = parse(writer.buffer());
+
+    QCOMPARE(components(document, "vtimezone").size(), 1);
+    const QJsonArray events = components(document, "vevent");
+    QCOMPARE(events.size(), 3);
+
+    const QStringList starts = { "2024-04-02T08:00:00Z", "2024-04-09T08:00:00Z", "2024-05-31T09:00:00" };
+    for (int i = 0; i < events.size(); i++)
+    {
+        const QJsonArray event = events.at(i).toArray();
+        QCOMPARE(property(event, "dtstart").at(3).toString(), starts.at(i));
+        QCOMPARE(property(event, "recurrence-id").at(3).toString(), starts.at(i));
+        QVERIFY(property(event, "rrule").isEmpty());
+        QVERIFY(property(event, "rdate").isEmpty());
+        QVERIFY(property(event, "exdate").isEmpty());
+        QCOMPARE(components(event, "valarm").size(), i < 2 ? 1 : 0);
+    }
+
+    QCOMPARE(property(events.at(2).toArray(), "recurrence-id").at(1).toObject(), QJsonObject({ { "tzid", "Europe/Prague" } }));
+    QCOMPARE(property(events.at(0).toArray(), "uid").at(3).toString(), QString("jcal-1@example.com"));
+}
+
+QTEST_GUILESS_MAIN(TestJCal)
+
+#include "tst_jcal.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_recurrence
+
+SOURCES += \
+    tst_recurrence.cpp
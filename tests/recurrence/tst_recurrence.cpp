@@ -0,0 +1,343 @@
+#include <QtTest>
+#include <QMetaEnum>
+
+#include "qicalevent.h"
+#include "qicalrecurrence.h"
+#include "qicalrule.h"
+
+namespace
+{
+
+const char* const STAMP_FORMAT = "yyyyMMddThhmmss";
+
+QDateTime utc(const QString& stamp)
+{
+    QDateTime dateTime = QDateTime::fromString(stamp, STAMP_FORMAT);
+    dateTime.setTimeSpec(Qt::UTC);
+    return dateTime;
+}
+
+QStringList stamps(const QList<QDateTime>& dateTimes)
+{
+    QStringList result;
+    for (const QDateTime& dateTime : dateTimes)
+    {
+        result.append(dateTime.toString(STAMP_FORMAT));
+    }
+
+    return result;
+}
+
+// applies an RRULE value ("FREQ=...;BYDAY=...") through the same setters the parser uses
+void applyRule(QiCalRule* rule, const QString& rrule)
+{
+    for (const QString& part : rrule.split(';'))
+    {
+        const QString name = part.section('=', 0, 0);
+        const QString value = part.section('=', 1);
+        if (name == "FREQ")
+        {
+            const QByteArray key = "RR_" + value.toLatin1();
+            rule->setFreq(QiCalRule::Freq(QMetaEnum::fromType<QiCalRule::Freq>().keyToValue(key.constData())));
+        }
+        else if (name == "UNTIL")
+        {
+            rule->setUntil(utc(value));
+        }
+        else if (name == "COUNT")
+        {
+            rule->setCount(value.toInt());
+        }
+        else if (name == "INTERVAL")
+        {
+            rule->setInterval(value.toInt());
+        }
+        else if (name == "BYSECOND")
+        {
+            rule->setSecondList(value);
+        }
+        else if (name == "BYMINUTE")
+        {
+            rule->setMinuteList(value);
+        }
+        else if (name == "BYHOUR")
+        {
+            rule->setHourList(value);
+        }
+        else if (name == "BYDAY")
+        {
+            rule->setDayList(value);
+        }
+        else if (name == "BYMONTHDAY")
+        {
+            rule->setMonthDayList(value);
+        }
+        else if (name == "BYYEARDAY")
+        {
+            rule->setYearDayList(value);
+        }
+        else if (name == "BYWEEKNO")
+        {
+            rule->setWeekList(value);
+        }
+        else if (name == "BYMONTH")
+        {
+            rule->setMonthList(value);
+        }
+        else if (name == "BYSETPOS")
+        {
+            rule->setSetposList(value);
+        }
+        else if (name == "WKST")
+        {
+            rule->setWkst(value);
+        }
+        else
+        {
+            QFAIL(qPrintable("unknown rule part " + name));
+        }
+    }
+}
+
+QVector<qint64> msecs(const QStringList& stampList)
+{
+    QVector<qint64> result;
+    for (const QString& stamp : stampList)
+    {
+        result.append(utc(stamp).toMSecsSinceEpoch());
+    }
+
+    return result;
+}
+
+}
+
+class TestRecurrence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void expansion_data();
+    void expansion();
+    void randomAccess_data();
+    void randomAccess();
+    void exceptionDates();
+    void iteration();
+};
+
+// expected lists are the RFC 5545 examples, cross-checked against python-dateutil
+void TestRecurrence::expansion_data()
+{
+    QTest::addColumn<QString>("rrule");
+    QTest::addColumn<QString>("dtStart");
+    QTest::addColumn<QString>("from");
+    QTest::addColumn<QString>("to");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("daily count")
+        << "FREQ=DAILY;COUNT=5" << "19970902T090000" << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970902T090000", "19970903T090000", "19970904T090000", "19970905T090000",
+                        "19970906T090000" };
+    QTest::newRow("weekly until")
+        << "FREQ=WEEKLY;UNTIL=19971007T000000;WKST=SU;BYDAY=TU,TH" << "19970902T090000"
+        << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970902T090000", "19970904T090000", "19970909T090000", "19970911T090000",
+                        "19970916T090000", "19970918T090000", "19970923T090000", "19970925T090000",
+                        "19970930T090000", "19971002T090000" };
+    QTest::newRow("biweekly wkst")
+        << "FREQ=WEEKLY;INTERVAL=2;COUNT=4;BYDAY=TU,SU;WKST=SU" << "19970805T090000"
+        << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970805T090000", "19970817T090000", "19970819T090000", "19970831T090000" };
+    QTest::newRow("monthly ordinal")
+        << "FREQ=MONTHLY;COUNT=6;BYDAY=-2MO" << "19970922T090000" << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970922T090000", "19971020T090000", "19971117T090000", "19971222T090000",
+                        "19980119T090000", "19980216T090000" };
+    QTest::newRow("monthly negative day")
+        << "FREQ=MONTHLY;BYMONTHDAY=-3" << "19970928T090000" << "19970901T000000" << "19980101T000000"
+        << QStringList{ "19970928T090000", "19971029T090000", "19971128T090000", "19971229T090000" };
+    QTest::newRow("monthly 31st")
+        << "FREQ=MONTHLY;COUNT=5" << "20000131T090000" << "20000101T000000" << "20011231T000000"
+        << QStringList{ "20000131T090000", "20000331T090000", "20000531T090000", "20000731T090000",
+                        "20000831T090000" };
+    QTest::newRow("leap day")
+        << "FREQ=YEARLY;COUNT=3" << "20000229T090000" << "20000101T000000" << "20101231T000000"
+        << QStringList{ "20000229T090000", "20040229T090000", "20080229T090000" };
+    QTest::newRow("yearday")
+        << "FREQ=YEARLY;INTERVAL=3;COUNT=6;BYYEARDAY=1,100,200" << "19970101T090000"
+        << "19970101T000000" << "20301231T000000"
+        << QStringList{ "19970101T090000", "19970410T090000", "19970719T090000", "20000101T090000",
+                        "20000409T090000", "20000718T090000" };
+    QTest::newRow("weekno")
+        << "FREQ=YEARLY;BYWEEKNO=20;BYDAY=MO" << "19970512T090000" << "19970101T000000" << "20001231T000000"
+        << QStringList{ "19970512T090000", "19980511T090000", "19990517T090000", "20000515T090000" };
+    QTest::newRow("weekno edges")
+        << "FREQ=YEARLY;BYWEEKNO=1,-1;BYDAY=MO,SU" << "20081229T090000" << "20080101T000000" << "20110101T000000"
+        << QStringList{ "20081229T090000", "20090104T090000", "20091228T090000", "20100103T090000",
+                        "20100104T090000", "20100110T090000", "20101227T090000" };
+    QTest::newRow("weekno 53")
+        << "FREQ=YEARLY;BYWEEKNO=53,-53;BYDAY=TH" << "20200102T090000" << "20200101T000000" << "20220101T000000"
+        << QStringList{ "20200102T090000", "20201231T090000" };
+    QTest::newRow("friday 13th")
+        << "FREQ=MONTHLY;BYDAY=FR;BYMONTHDAY=13" << "19980213T090000" << "19970101T000000" << "20001231T000000"
+        << QStringList{ "19980213T090000", "19980313T090000", "19981113T090000", "19990813T090000",
+                        "20001013T090000" };
+    QTest::newRow("setpos third")
+        << "FREQ=MONTHLY;COUNT=3;BYDAY=TU,WE,TH;BYSETPOS=3" << "19970904T090000"
+        << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970904T090000", "19971007T090000", "19971106T090000" };
+    QTest::newRow("setpos second last")
+        << "FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-2" << "19970929T090000"
+        << "19970101T000000" << "19980201T000000"
+        << QStringList{ "19970929T090000", "19971030T090000", "19971127T090000", "19971230T090000",
+                        "19980129T090000" };
+    QTest::newRow("setpos with hours")
+        << "FREQ=YEARLY;BYMONTH=1;BYDAY=-1MO,2TU;BYHOUR=8,20;BYSETPOS=1,-1" << "19980106T080000"
+        << "19980101T000000" << "20010201T000000"
+        << QStringList{ "19980106T080000", "19980113T080000", "19980126T200000", "19990112T080000",
+                        "19990125T200000", "20000111T080000", "20000131T200000", "20010109T080000",
+                        "20010129T200000" };
+    QTest::newRow("hourly until")
+        << "FREQ=HOURLY;INTERVAL=3;UNTIL=19970902T170000" << "19970902T090000"
+        << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970902T090000", "19970902T120000", "19970902T150000" };
+    QTest::newRow("minutely count")
+        << "FREQ=MINUTELY;INTERVAL=15;COUNT=6" << "19970902T090000" << "19970101T000000" << "19991231T000000"
+        << QStringList{ "19970902T090000", "19970902T091500", "19970902T093000", "19970902T094500",
+                        "19970902T100000", "19970902T101500" };
+    QTest::newRow("window")
+        << "FREQ=DAILY;INTERVAL=3" << "19970902T090000" << "20150101T000000" << "20150115T000000"
+        << QStringList{ "20150101T090000", "20150104T090000", "20150107T090000", "20150110T090000",
+                        "20150113T090000" };
+}
+
+void TestRecurrence::expansion()
+{
+    QFETCH(QString, rrule);
+    QFETCH(QString, dtStart);
+    QFETCH(QString, from);
+    QFETCH(QString, to);
+    QFETCH(QStringList, expected);
+
+    QiCalRule rule;
+    applyRule(&rule, rrule);
+
+    QiCalRecurrence recurrence(&rule, utc(dtStart));
+    QCOMPARE(stamps(recurrence.between(utc(from), utc(to))), expected);
+}
+
+void TestRecurrence::randomAccess_data()
+{
+    QTest::addColumn<QString>("rrule");
+    QTest::addColumn<QString>("dtStart");
+
+    QTest::newRow("daily count") << "FREQ=DAILY;COUNT=5" << "19970902T090000";
+    QTest::newRow("weekly until") << "FREQ=WEEKLY;UNTIL=19971007T000000;WKST=SU;BYDAY=TU,TH" << "19970902T090000";
+    QTest::newRow("monthly 31st") << "FREQ=MONTHLY;COUNT=12" << "20000131T090000";
+    QTest::newRow("yearday") << "FREQ=YEARLY;INTERVAL=3;COUNT=6;BYYEARDAY=1,100,200" << "19970101T090000";
+    QTest::newRow("setpos") << "FREQ=MONTHLY;COUNT=20;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-2" << "19970929T090000";
+    QTest::newRow("sub-daily") << "FREQ=HOURLY;INTERVAL=7;COUNT=40;BYDAY=MO,WE" << "19970901T030000";
+    QTest::newRow("unbounded") << "FREQ=WEEKLY;INTERVAL=2;BYDAY=TU,SU;WKST=SU" << "19970805T090000";
+}
+
+// occurrenceAt, indexOf, isOccurrence and lastOccurrence must agree with plain expansion
+void TestRecurrence::randomAccess()
+{
+    QFETCH(QString, rrule);
+    QFETCH(QString, dtStart);
+
+    QiCalRule rule;
+    applyRule(&rule, rrule);
+
+    QiCalRecurrence recurrence(&rule, utc(dtStart));
+    const QList<QDateTime> all = recurrence.between(utc(dtStart), utc(dtStart).addYears(10));
+    QVERIFY(!all.isEmpty());
+
+    for (int i = 0; i < all.size(); i++)
+    {
+        QCOMPARE(recurrence.occurrenceAt(i), all[i]);
+        QCOMPARE(recurrence.indexOf(all[i]), qint64(i));
+        QVERIFY(recurrence.isOccurrence(all[i]));
+        QVERIFY(!recurrence.isOccurrence(all[i].addSecs(1)));
+    }
+
+    if (rule.count() > 0 || rule.until().isValid())
+    {
+        QCOMPARE(recurrence.lastOccurrence(), all.last());
+        QVERIFY(!recurrence.occurrenceAt(all.size()).isValid());
+    }
+    else
+    {
+        QVERIFY(!recurrence.lastOccurrence().isValid());
+    }
+}
+
+// RDATE adds occurrences (also before DTSTART and duplicates of rule instances), EXDATE removes them
+void TestRecurrence::exceptionDates()
+{
+    QiCalEvent event;
+    event.setDtStart(utc("20200106T100000"));
+    event.setRDates(msecs({ "20200104T090000", "20200108T100000", "20200301T120000" }));
+    event.setExDates(msecs({ "20200113T100000", "20200301T120000" }));
+
+    QiCalRule rule;
+    applyRule(&rule, "FREQ=WEEKLY;COUNT=6;BYDAY=MO,WE");
+    rule.setCalEvent(&event);
+
+    QiCalRecurrence recurrence(&rule);
+    const QList<QDateTime> all = recurrence.between(utc("20200101T000000"), utc("20210101T000000"));
+    QCOMPARE(stamps(all),
+             QStringList({ "20200104T090000", "20200106T100000", "20200108T100000", "20200115T100000",
+                           "20200120T100000", "20200122T100000" }));
+
+    // random access answers for the recurrence set, not for the bare RRULE
+    for (int i = 0; i < all.size(); i++)
+    {
+        QCOMPARE(recurrence.occurrenceAt(i), all[i]);
+        QCOMPARE(recurrence.indexOf(all[i]), qint64(i));
+        QVERIFY(rule.isOccurrence(all[i]));
+    }
+    QVERIFY(!recurrence.occurrenceAt(all.size()).isValid());
+    QVERIFY(!rule.isOccurrence(utc("20200113T100000")));
+    QVERIFY(!rule.isOccurrence(utc("20200301T120000")));
+    QCOMPARE(recurrence.lastOccurrence(), all.last());
+
+    // an excluded last instance gives way to the one before it, a later RDATE extends the series
+    event.setRDates(msecs({ "20200104T090000" }));
+    event.setExDates(msecs({ "20200122T100000" }));
+    QCOMPARE(QiCalRecurrence(&rule).lastOccurrence(), utc("20200120T100000"));
+    event.setRDates(msecs({ "20200104T090000", "20200301T120000" }));
+    QCOMPARE(QiCalRecurrence(&rule).lastOccurrence(), utc("20200301T120000"));
+    QCOMPARE(QiCalRecurrence(&rule).indexOf(utc("20200301T120000")), qint64(6));
+    QCOMPARE(QiCalRecurrence(&rule).occurrenceAt(6), utc("20200301T120000"));
+}
+
+// the lazy cursor must produce the same sequence as between(), also after skipTo
+void TestRecurrence::iteration()
+{
+    QiCalRule rule;
+    applyRule(&rule, "FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-2");
+
+    QiCalRecurrence recurrence(&rule, utc("19970929T090000"));
+    const QList<QDateTime> expected = recurrence.between(utc("19980101T000000"), utc("19991231T000000"));
+
+    recurrence.reset(utc("19980101T000000"));
+    recurrence.setLimit(utc("19991231T000000"));
+    QList<QDateTime> iterated;
+    while (recurrence.hasNext())
+    {
+        const QDateTime peeked = recurrence.peek();
+        const QDateTime next = recurrence.next();
+        QCOMPARE(next, peeked);
+        iterated.append(next);
+    }
+    QCOMPARE(iterated, expected);
+
+    recurrence.reset(utc("19980101T000000"));
+    recurrence.skipTo(expected[10]);
+    QVERIFY(recurrence.hasNext());
+    QCOMPARE(recurrence.next(), expected[10]);
+}
+
+QTEST_GUILESS_MAIN(TestRecurrence)
+
+#include "tst_recurrence.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_reload
+
+SOURCES += \
+    tst_reload.cpp
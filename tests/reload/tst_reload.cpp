@@ -0,0 +1,251 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "qicalendar.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+QByteArray timeZone(const char* summerOffset)
+{
+    return QByteArray("BEGIN:VTIMEZONE\r\n"
+                      "TZID:Europe/Prague\r\n"
+                      "BEGIN:STANDARD\r\n"
+                      "DTSTART:19701025T030000\r\n"
+                      "TZOFFSETFROM:") + summerOffset + "\r\n"
+            "TZOFFSETTO:+0100\r\n"
+            "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n"
+            "END:STANDARD\r\n"
+            "BEGIN:DAYLIGHT\r\n"
+            "DTSTART:19700329T020000\r\n"
+            "TZOFFSETFROM:+0100\r\n"
+            "TZOFFSETTO:" + summerOffset + "\r\n"
+            "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"
+            "END:DAYLIGHT\r\n"
+            "END:VTIMEZONE\r\n";
+}
+
+QByteArray zonedEvent(const char* uid)
+{
+    return QByteArray("BEGIN:VEVENT\r\n"
+                      "UID:") + uid + "\r\n"
+            "DTSTART;TZID=Europe/Prague:20240701T090000\r\n"
+            "DTEND;TZID=Europe/Prague:20240701T100000\r\n"
+            "SUMMARY:Zoned\r\n"
+            "RRULE:FREQ=WEEKLY;COUNT=4\r\n"
+            "END:VEVENT\r\n";
+}
+
+QByteArray utcEvent(const char* uid, const char* summary)
+{
+    return QByteArray("BEGIN:VEVENT\r\n"
+                      "UID:") + uid + "\r\n"
+            "DTSTART:20240702T120000Z\r\n"
+            "DTEND:20240702T130000Z\r\n"
+            "SUMMARY:" + summary + "\r\n"
+            "END:VEVENT\r\n";
+}
+
+QByteArray calendar(const QByteArray& components)
+{
+    return "BEGIN:VCALENDAR\r\n"
+           "VERSION:2.0\r\n"
+           "PRODID:-//qiCalendar//tests//EN\r\n" + components + "END:VCALENDAR\r\n";
+}
+
+QiCalEvent* findEvent(QiCalendarParser& parser, const QString& uid)
+{
+    for (QiCalEvent* event : parser.calendar()->events())
+    {
+        if (event->uid() == uid)
+        {
+            return event;
+        }
+    }
+
+    return nullptr;
+}
+
+}
+
+class TestReload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void unchanged();
+    void modifiedEvent();
+    void addedAndRemoved();
+    void changedTimeZone();
+    void missingFile();
+    void truncatedArchive();
+    void afterSnapshot();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_path;
+    QiCalendarParser m_parser;
+    QiCalEvent* m_zoned = nullptr;
+    QiCalEvent* m_first = nullptr;
+    QiCalEvent* m_second = nullptr;
+};
+
+void TestReload::init()
+{
+    QVERIFY(m_dir.isValid());
+    m_path = m_dir.filePath("reload.ics");
+
+    QVERIFY(writeFile(m_path, calendar(timeZone("+0200") + zonedEvent("zoned") + utcEvent("first", "First") + utcEvent("second", "Second"))));
+    QVERIFY(m_parser.parseFile(m_path));
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+
+    m_zoned = findEvent(m_parser, "zoned");
+    m_first = findEvent(m_parser, "first");
+    m_second = findEvent(m_parser, "second");
+    QVERIFY(m_zoned != nullptr && m_first != nullptr && m_second != nullptr);
+}
+
+// unchanged blocks keep their objects and nothing is reported
+void TestReload::unchanged()
+{
+    QiCalChangeReport report;
+    QVERIFY(m_parser.reloadFile(m_path, &report));
+
+    QVERIFY(report.added.isEmpty());
+    QVERIFY(report.updated.isEmpty());
+    QVERIFY(report.removed.isEmpty());
+    QVERIFY(report.timeZones.isEmpty());
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+    QCOMPARE(findEvent(m_parser, "zoned"), m_zoned);
+    QCOMPARE(findEvent(m_parser, "first"), m_first);
+    QCOMPARE(findEvent(m_parser, "second"), m_second);
+}
+
+// a changed block is parsed again and applied to the existing object
+void TestReload::modifiedEvent()
+{
+    QVERIFY(writeFile(m_path, calendar(timeZone("+0200") + zonedEvent("zoned") + utcEvent("first", "First, moved") + utcEvent("second", "Second"))));
+
+    QiCalChangeReport report;
+    QVERIFY(m_parser.reloadFile(m_path, &report));
+
+    QVERIFY(report.added.isEmpty());
+    QVERIFY(report.removed.isEmpty());
+    QCOMPARE(report.updated, QList<QiCalEvent*>{ m_first });
+    QCOMPARE(m_first->summary(), QString("First, moved"));
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+    QCOMPARE(findEvent(m_parser, "first"), m_first);
+}
+
+void TestReload::addedAndRemoved()
+{
+    QVERIFY(writeFile(m_path, calendar(timeZone("+0200") + zonedEvent("zoned") + utcEvent("first", "First") + utcEvent("third", "Third"))));
+
+    QiCalChangeReport report;
+    QVERIFY(m_parser.reloadFile(m_path, &report));
+
+    QVERIFY(report.updated.isEmpty());
+    QCOMPARE(report.removed, QStringList{ "second" });
+    QCOMPARE(report.added.size(), 1);
+    QCOMPARE(report.added.at(0)->uid(), QString("third"));
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+    QVERIFY(findEvent(m_parser, "second") == nullptr);
+    QCOMPARE(findEvent(m_parser, "first"), m_first);
+}
+
+// events in a changed VTIMEZONE are resolved again even though their own lines did not change
+void TestReload::changedTimeZone()
+{
+    QCOMPARE(m_zoned->dtStart(), QDateTime(QDate(2024, 7, 1), QTime(7, 0), Qt::UTC));
+
+    QVERIFY(writeFile(m_path, calendar(timeZone("+0300") + zonedEvent("zoned") + utcEvent("first", "First") + utcEvent("second", "Second"))));
+
+    QiCalChangeReport report;
+    QVERIFY(m_parser.reloadFile(m_path, &report));
+
+    QCOMPARE(report.timeZones, QStringList{ "Europe/Prague" });
+    QCOMPARE(report.updated, QList<QiCalEvent*>{ m_zoned });
+    QCOMPARE(m_parser.calendar()->timeZones().size(), 1);
+    QCOMPARE(m_zoned->dtStart(), QDateTime(QDate(2024, 7, 1), QTime(6, 0), Qt::UTC));
+    QCOMPARE(m_zoned->zone()->offsetAtUtc(QDateTime(QDate(2024, 7, 1), QTime(6, 0), Qt::UTC).toMSecsSinceEpoch() / 1000), 10800);
+    QVERIFY(m_zoned->rule() != nullptr);
+    QCOMPARE(m_zoned->rule()->calEvent(), m_zoned);
+}
+
+void TestReload::missingFile()
+{
+    QiCalChangeReport report;
+    QVERIFY(!m_parser.reloadFile(m_dir.filePath("missing.ics"), &report));
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+    QCOMPARE(findEvent(m_parser, "first"), m_first);
+}
+
+// the VTIMEZONE change is read before the stream breaks off; none of it may be applied
+void TestReload::truncatedArchive()
+{
+    QByteArray filler;
+    for (int i = 0; i < 400; i++)
+    {
+        const QByteArray uid = "filler-" + QByteArray::number(i);
+        filler += utcEvent(uid.constData(), "Filler");
+    }
+
+    const QString path = m_dir.filePath("reload.ics.gz");
+    QVERIFY(writeFile(path, gzip(calendar(timeZone("+0200") + zonedEvent("zoned") + utcEvent("first", "First") + filler))));
+
+    QiCalendarParser parser;
+    QVERIFY(parser.parseFile(path));
+    QCOMPARE(parser.calendar()->timeZones().size(), 1);
+    QiCalTimeZone* zone = parser.calendar()->timeZones().first();
+    QiCalEvent* zoned = findEvent(parser, "zoned");
+    QVERIFY(zoned != nullptr);
+    QCOMPARE(zoned->dtStart(), QDateTime(QDate(2024, 7, 1), QTime(7, 0), Qt::UTC));
+
+    QByteArray damaged = gzip(calendar(timeZone("+0300") + zonedEvent("zoned") + filler + utcEvent("third", "Third")));
+    damaged.chop(damaged.size() / 3);
+    QVERIFY(writeFile(path, damaged));
+
+    QiCalChangeReport report;
+    QVERIFY(!parser.reloadFile(path, &report));
+    QCOMPARE(parser.calendar()->timeZones(), QList<QiCalTimeZone*>{ zone });
+    QCOMPARE(parser.calendar()->events().size(), 402);
+    QCOMPARE(findEvent(parser, "zoned"), zoned);
+    QCOMPARE(zoned->dtStart(), QDateTime(QDate(2024, 7, 1), QTime(7, 0), Qt::UTC));
+    QVERIFY(findEvent(parser, "first") != nullptr);
+    QVERIFY(findEvent(parser, "third") == nullptr);
+
+    // the next clean read applies the change
+    QVERIFY(writeFile(path, gzip(calendar(timeZone("+0300") + zonedEvent("zoned") + utcEvent("first", "First") + filler))));
+    QVERIFY(parser.reloadFile(path, &report));
+    QCOMPARE(report.timeZones, QStringList{ "Europe/Prague" });
+    QCOMPARE(report.updated, QList<QiCalEvent*>{ zoned });
+    QCOMPARE(parser.calendar()->timeZones().size(), 1);
+    QCOMPARE(zoned->dtStart(), QDateTime(QDate(2024, 7, 1), QTime(6, 0), Qt::UTC));
+}
+
+// a calendar served from a snapshot is materialized before it is reloaded
+void TestReload::afterSnapshot()
+{
+    const QString snapshotPath = m_dir.filePath("reload.snapshot");
+    QiCalendarParser writer;
+    QVERIFY(writer.loadFile(m_path, snapshotPath));
+
+    QiCalendarParser parser;
+    QVERIFY(parser.loadFile(m_path, snapshotPath));
+    QVERIFY(parser.snapshot() != nullptr);
+
+    QVERIFY(writeFile(m_path, calendar(timeZone("+0200") + zonedEvent("zoned") + utcEvent("first", "First, moved") + utcEvent("second", "Second"))));
+    QVERIFY(parser.reloadFile(m_path));
+    QVERIFY(parser.snapshot() == nullptr);
+    QCOMPARE(parser.calendar()->events().size(), 3);
+    QCOMPARE(findEvent(parser, "first")->summary(), QString("First, moved"));
+}
+
+QTEST_GUILESS_MAIN(TestReload)
+
+#include "tst_reload.moc"
@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_roundtrip
+
+SOURCES += \
+    tst_roundtrip.cpp
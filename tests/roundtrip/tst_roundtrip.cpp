@@ -0,0 +1,265 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "qicalendar.h"
+#include "qicalrecurrence.h"
+#include "qicalwriter.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+QList<QDateTime> expand(const QiCalEvent* event)
+{
+    QiCalRecurrence recurrence(event->rule());
+    return recurrence.between(utc(2024, 1, 1, 0, 0), utc(2025, 1, 1, 0, 0));
+}
+
+}
+
+class TestRoundTrip : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void folding();
+    void text();
+    void recurrence();
+    void allDay();
+    void zoned();
+    void rewrite();
+    void quotedParameters();
+
+private:
+    QTemporaryDir m_dir;
+    QiCalCalendar* m_calendar = nullptr;
+    QiCalendarParser m_parser;
+    QByteArray m_written;
+};
+
+void TestRoundTrip::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    m_calendar = new QiCalCalendar();
+    QiCalTimeZone* timeZone = new QiCalTimeZone();
+    centralEurope(timeZone);
+    m_calendar->addTimeZone(timeZone);
+
+    QiCalEvent* meeting = new QiCalEvent();
+    meeting->setUid("roundtrip-1@example.com");
+    meeting->setSummary(QString::fromUtf8("Quartalsplanung: Überprüfung der Ziele, Prioritäten; Budget für 2025 – bitte vorbereiten"));
+    meeting->setDescription("Agenda:\n1. Review, plan; decide\\approve\n2. Next steps");
+    meeting->setLocation("Room 4: Building B");
+    meeting->setDtStart(utc(2024, 4, 2, 8, 0));
+    meeting->setDtEnd(utc(2024, 4, 2, 9, 30));
+    meeting->setStatus(QiCalEvent::STAT_CONFIRMED);
+    meeting->setTransp(QiCalEvent::TRANS_TRANSPARENT);
+    meeting->setSequence(3);
+    QiCalRule* weekly = new QiCalRule();
+    weekly->setFreq(QiCalRule::RR_WEEKLY);
+    weekly->setCount(10);
+    weekly->setDayList("TU,TH");
+    meeting->setRule(weekly);
+    weekly->setCalEvent(meeting);
+    meeting->setExDates({ utc(2024, 4, 4, 8, 0).toMSecsSinceEpoch() });
+    meeting->setRDates({ utc(2024, 4, 6, 10, 0).toMSecsSinceEpoch() });
+    QiCalAlarm* alarm = new QiCalAlarm();
+    alarm->setAction(QiCalAlarm::ACT_DISPLAY);
+    alarm->setDescription("Reminder");
+    alarm->setTrigger("-PT15M");
+    meeting->addAlarm(alarm);
+    m_calendar->addEvent(meeting);
+
+    QiCalEvent* holiday = new QiCalEvent();
+    holiday->setUid("roundtrip-2@example.com");
+    holiday->setSummary("Labour Day");
+    holiday->setAllDay(true);
+    holiday->setDtStart(QDateTime(QDate(2024, 5, 1), QTime(0, 0)));
+    holiday->setDtEnd(QDateTime(QDate(2024, 5, 2), QTime(0, 0)));
+    m_calendar->addEvent(holiday);
+
+    const QSharedPointer<const QiCalZoneTable> zone = timeZone->zoneTable();
+    QiCalEvent* standup = new QiCalEvent();
+    standup->setUid("roundtrip-3@example.com");
+    standup->setSummary("Standup");
+    standup->setZone(zone);
+    standup->setDtStart(zone->toDateTime(QDate(2024, 3, 29), QTime(9, 0)));
+    standup->setDtEnd(zone->toDateTime(QDate(2024, 3, 29), QTime(9, 15)));
+    QiCalRule* daily = new QiCalRule();
+    daily->setFreq(QiCalRule::RR_DAILY);
+    daily->setCount(5);
+    standup->setRule(daily);
+    daily->setCalEvent(standup);
+    standup->setExDates({ zone->toDateTime(QDate(2024, 3, 30), QTime(9, 0)).toMSecsSinceEpoch() });
+    m_calendar->addEvent(standup);
+
+    const QString path = m_dir.filePath("roundtrip.ics");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QiCalWriter writer(&file);
+    QVERIFY(writer.writeCalendar(m_calendar));
+    file.close();
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    m_written = file.readAll();
+    file.close();
+
+    QVERIFY(m_parser.parseFile(path));
+    QVERIFY(m_parser.calendar() != nullptr);
+    QCOMPARE(m_parser.calendar()->events().size(), 3);
+    QCOMPARE(m_parser.calendar()->timeZones().size(), 1);
+}
+
+void TestRoundTrip::cleanupTestCase()
+{
+    delete m_calendar;
+}
+
+// content lines are folded at 75 octets without splitting UTF-8 sequences
+void TestRoundTrip::folding()
+{
+    QVERIFY(m_written.endsWith("END:VCALENDAR\r\n"));
+
+    bool folded = false;
+    for (const QByteArray& line : m_written.split('\n'))
+    {
+        if (line.isEmpty())
+        {
+            continue;
+        }
+
+        QVERIFY(line.endsWith('\r'));
+        QVERIFY(line.size() - 1 <= QiCalWriter::FOLD_OCTETS);
+
+        if (line.startsWith(' '))
+        {
+            folded = true;
+            QVERIFY(line.size() > 1);
+            QVERIFY((uchar(line.at(1)) & 0xC0) != 0x80);
+        }
+    }
+    QVERIFY(folded);
+}
+
+void TestRoundTrip::text()
+{
+    const QiCalEvent* original = m_calendar->events().at(0);
+    const QiCalEvent* parsed = m_parser.calendar()->events().at(0);
+
+    QCOMPARE(parsed->uid(), original->uid());
+    QCOMPARE(parsed->summary(), original->summary());
+    QCOMPARE(parsed->description(), original->description());
+    QCOMPARE(parsed->location(), original->location());
+    QCOMPARE(parsed->status(), original->status());
+    QCOMPARE(parsed->transp(), original->transp());
+    QCOMPARE(parsed->sequence(), original->sequence());
+
+    QCOMPARE(parsed->alarms().size(), 1);
+    QCOMPARE(parsed->alarms().at(0)->action(), QiCalAlarm::ACT_DISPLAY);
+    QCOMPARE(parsed->alarms().at(0)->description(), QString("Reminder"));
+    QCOMPARE(parsed->alarms().at(0)->triggerOffset(), qint64(-900));
+}
+
+void TestRoundTrip::recurrence()
+{
+    const QiCalEvent* original = m_calendar->events().at(0);
+    const QiCalEvent* parsed = m_parser.calendar()->events().at(0);
+
+    QCOMPARE(parsed->dtStart(), original->dtStart());
+    QCOMPARE(parsed->dtEnd(), original->dtEnd());
+    QCOMPARE(parsed->exDates(), original->exDates());
+    QCOMPARE(parsed->rDates(), original->rDates());
+    QVERIFY(parsed->rule() != nullptr);
+    QCOMPARE(expand(parsed), expand(original));
+    QCOMPARE(expand(parsed).size(), 10);
+}
+
+void TestRoundTrip::allDay()
+{
+    const QiCalEvent* parsed = m_parser.calendar()->events().at(1);
+
+    QVERIFY(m_written.contains("DTSTART;VALUE=DATE:20240501\r\n"));
+    QVERIFY(parsed->isAllDay());
+    QCOMPARE(parsed->dtStart().date(), QDate(2024, 5, 1));
+    QCOMPARE(parsed->dtEnd().date(), QDate(2024, 5, 2));
+}
+
+void TestRoundTrip::zoned()
+{
+    const QiCalEvent* original = m_calendar->events().at(2);
+    const QiCalEvent* parsed = m_parser.calendar()->events().at(2);
+
+    QVERIFY(m_written.contains("DTSTART;TZID=Europe/Prague:20240329T090000\r\n"));
+    QVERIFY(!parsed->zone().isNull());
+    QCOMPARE(parsed->zone()->tzId(), QString("Europe/Prague"));
+    QCOMPARE(parsed->dtStart(), original->dtStart());
+    QCOMPARE(parsed->dtStart().offsetFromUtc(), 3600);
+    QCOMPARE(parsed->exDates(), original->exDates());
+
+    // the series crosses the spring transition and stays at 09:00 local time
+    const QList<QDateTime> occurrences = expand(parsed);
+    QCOMPARE(occurrences, expand(original));
+    QCOMPARE(occurrences.size(), 4);
+    QCOMPARE(occurrences.last(), utc(2024, 4, 2, 7, 0));
+}
+
+// whatever the parser reads back is written out unchanged
+void TestRoundTrip::rewrite()
+{
+    QiCalWriter writer;
+    QVERIFY(writer.writeCalendar(m_parser.calendar()));
+    QCOMPARE(writer.buffer(), m_written);
+}
+
+// zone names with ':' ';' or ',' are written as quoted parameter values and read back intact
+void TestRoundTrip::quotedParameters()
+{
+    QiCalCalendar calendar;
+    QiCalTimeZone* timeZone = new QiCalTimeZone();
+    centralEurope(timeZone);
+    timeZone->setTzId("(UTC+01:00) Amsterdam, Berlin; Rome");
+    calendar.addTimeZone(timeZone);
+
+    const QSharedPointer<const QiCalZoneTable> zone = timeZone->zoneTable();
+    QiCalEvent* event = new QiCalEvent();
+    event->setUid("roundtrip-4@example.com");
+    event->setSummary("Sync");
+    event->setZone(zone);
+    event->setDtStart(zone->toDateTime(QDate(2024, 1, 5), QTime(9, 0)));
+    event->setDtEnd(zone->toDateTime(QDate(2024, 1, 5), QTime(10, 0)));
+    event->setExDates({ zone->toDateTime(QDate(2024, 1, 12), QTime(9, 0)).toMSecsSinceEpoch() });
+    calendar.addEvent(event);
+
+    const QString path = m_dir.filePath("quoted.ics");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QiCalWriter writer(&file);
+    QVERIFY(writer.writeCalendar(&calendar));
+    file.close();
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray written = file.readAll();
+    file.close();
+    QVERIFY(written.contains("DTSTART;TZID=\"(UTC+01:00) Amsterdam, Berlin; Rome\":20240105T090000\r\n"));
+
+    QiCalendarParser parser;
+    QVERIFY(parser.parseFile(path));
+    QCOMPARE(parser.calendar()->events().size(), 1);
+
+    const QiCalEvent* parsed = parser.calendar()->events().first();
+    QVERIFY(!parsed->zone().isNull());
+    QCOMPARE(parsed->zone()->tzId(), QString("(UTC+01:00) Amsterdam, Berlin; Rome"));
+    QCOMPARE(parsed->dtStart(), utc(2024, 1, 5, 8, 0));
+    QCOMPARE(parsed->dtStart().offsetFromUtc(), 3600);
+    QCOMPARE(parsed->exDates(), event->exDates());
+}
+
+QTEST_GUILESS_MAIN(TestRoundTrip)
+
+#include "tst_roundtrip.moc"
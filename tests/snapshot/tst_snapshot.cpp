@@ -0,0 +1,325 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <cstddef>
+#include <cstring>
+
+#include "qicalendar.h"
+#include "qicalsnapshot.h"
+#include "qicalwriter.h"
+#include "testutil.h"
+
+using namespace TestUtil;
+
+namespace
+{
+
+QiCalRule* yearlyRule(int month, const QString& day)
+{
+    QiCalRule* rule = new QiCalRule();
+    rule->setFreq(QiCalRule::RR_YEARLY);
+    rule->setMonthList(QString::number(month));
+    rule->setDayList(day);
+    return rule;
+}
+
+QiCalCalendar* sampleCalendar()
+{
+    QiCalCalendar* calendar = new QiCalCalendar();
+    calendar->setProdId("-//qiCalendar//tests//EN");
+    calendar->setVersion("2.0");
+
+    QiCalTimeZone* timeZone = new QiCalTimeZone();
+    timeZone->setTzId("Europe/Prague");
+    QiCalTzInfo* standard = new QiCalTzInfo();
+    standard->setOffsetFrom(7200);
+    standard->setOffsetTo(3600);
+    standard->setTzName("CET");
+    standard->setDtStart(QDateTime(QDate(1970, 10, 25), QTime(3, 0)));
+    standard->setRule(yearlyRule(10, "-1SU"));
+    timeZone->setStandard(standard);
+    QiCalTzInfo* daylight = new QiCalTzInfo();
+    daylight->setOffsetFrom(3600);
+    daylight->setOffsetTo(7200);
+    daylight->setTzName("CEST");
+    daylight->setDtStart(QDateTime(QDate(1970, 3, 29), QTime(2, 0)));
+    daylight->setRule(yearlyRule(3, "-1SU"));
+    daylight->setRDates({ QDateTime(QDate(1969, 4, 6), QTime(2, 0), Qt::UTC).toMSecsSinceEpoch() });
+    timeZone->setDayLight(daylight);
+    calendar->addTimeZone(timeZone);
+
+    const QSharedPointer<const QiCalZoneTable> zone = timeZone->zoneTable();
+    QiCalEvent* meeting = new QiCalEvent();
+    meeting->setUid("snapshot-1@example.com");
+    meeting->setSummary("Planning; review");
+    meeting->setZone(zone);
+    meeting->setDtStart(zone->toDateTime(QDate(2024, 3, 29), QTime(9, 0)));
+    meeting->setDtEnd(zone->toDateTime(QDate(2024, 3, 29), QTime(10, 0)));
+    meeting->setDtStamp(utc(2024, 1, 1, 12, 0));
+    QiCalRule* rule = new QiCalRule();
+    rule->setFreq(QiCalRule::RR_WEEKLY);
+    rule->setInterval(2);
+    rule->setCount(10);
+    rule->setDayList("MO,FR");
+    meeting->setRule(rule);
+    rule->setCalEvent(meeting);
+    calendar->addRule(rule);
+    meeting->setExDates({ meeting->dtStart().addDays(14).toMSecsSinceEpoch() });
+    QiCalAlarm* alarm = new QiCalAlarm();
+    alarm->setAction(QiCalAlarm::ACT_DISPLAY);
+    alarm->setTrigger("-PT15M");
+    meeting->addAlarm(alarm);
+    calendar->addEvent(meeting);
+
+    QiCalEvent* holiday = new QiCalEvent();
+    holiday->setUid("snapshot-2@example.com");
+    holiday->setSummary("Holiday");
+    holiday->setAllDay(true);
+    holiday->setDtStart(QDateTime(QDate(2024, 6, 1), QTime(0, 0)));
+    holiday->setDtEnd(QDateTime(QDate(2024, 6, 2), QTime(0, 0)));
+    calendar->addEvent(holiday);
+
+    return calendar;
+}
+
+QByteArray written(const QiCalCalendar* calendar)
+{
+    QiCalWriter writer;
+    writer.writeCalendar(calendar);
+    return writer.buffer();
+}
+
+}
+
+class TestSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void roundTrip();
+    void eventsBetween();
+    void staleness();
+    void corruption_data();
+    void corruption();
+    void truncation();
+    void fuzz();
+    void lazyLoad();
+
+private:
+    quint32 eventField(int index, size_t field) const;
+
+    QTemporaryDir m_dir;
+    QiCalCalendar* m_calendar = nullptr;
+    QString m_source;
+    QString m_path;
+    QByteArray m_image;
+};
+
+void TestSnapshot::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    m_calendar = sampleCalendar();
+    m_source = m_dir.filePath("calendar.ics");
+    m_path = m_dir.filePath("calendar.snapshot");
+
+    QVERIFY(writeFile(m_source, written(m_calendar)));
+    QVERIFY(QiCalSnapshot::save(m_calendar, m_path, m_source));
+
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    m_image = file.readAll();
+    QVERIFY(m_image.size() > int(sizeof(QiCalSnapshot::Header)));
+}
+
+void TestSnapshot::cleanupTestCase()
+{
+    delete m_calendar;
+}
+
+quint32 TestSnapshot::eventField(int index, size_t field) const
+{
+    const QiCalSnapshot::Header* header = reinterpret_cast<const QiCalSnapshot::Header*>(m_image.constData());
+    return header->events.offset + quint32(index * sizeof(QiCalSnapshot::EventRecord) + field);
+}
+
+void TestSnapshot::roundTrip()
+{
+    QiCalSnapshot snapshot;
+    QVERIFY(snapshot.open(m_path));
+    QVERIFY(!snapshot.isStale(m_source));
+    QCOMPARE(snapshot.eventCount(), 2);
+    QCOMPARE(snapshot.string(snapshot.event(0).uid), QString("snapshot-1@example.com"));
+
+    QScopedPointer<QiCalCalendar> restored(snapshot.toCalendar());
+    QVERIFY(!restored.isNull());
+    QCOMPARE(written(restored.data()), written(m_calendar));
+
+    const QiCalEvent* meeting = restored->events().at(0);
+    QVERIFY(!meeting->zone().isNull());
+    QCOMPARE(meeting->zone()->transitions().size(), m_calendar->events().at(0)->zone()->transitions().size());
+    QVERIFY(restored->events().at(1)->isAllDay());
+}
+
+void TestSnapshot::eventsBetween()
+{
+    QiCalSnapshot snapshot;
+    QVERIFY(snapshot.open(m_path));
+
+    QCOMPARE(snapshot.eventsBetween(utc(2024, 5, 15, 0, 0), utc(2024, 7, 1, 0, 0)), QVector<int>({ 0, 1 }));
+    QCOMPARE(snapshot.eventsBetween(utc(2024, 6, 10, 0, 0), utc(2024, 7, 1, 0, 0)), QVector<int>());
+    QCOMPARE(snapshot.eventsBetween(utc(2024, 1, 1, 0, 0), utc(2024, 3, 1, 0, 0)), QVector<int>());
+}
+
+void TestSnapshot::staleness()
+{
+    const QString source = m_dir.filePath("stale.ics");
+    const QString path = m_dir.filePath("stale.snapshot");
+    QVERIFY(writeFile(source, written(m_calendar)));
+    QVERIFY(QiCalSnapshot::save(m_calendar, path, source));
+
+    QiCalSnapshot snapshot;
+    QVERIFY(snapshot.open(path));
+    QVERIFY(!snapshot.isStale(source));
+
+    QVERIFY(writeFile(source, written(m_calendar) + "\r\n"));
+    QVERIFY(snapshot.isStale(source));
+    QVERIFY(snapshot.isStale(m_dir.filePath("missing.ics")));
+}
+
+// each row overwrites one 32-bit field with a value that points outside its table or enum
+void TestSnapshot::corruption_data()
+{
+    typedef QiCalSnapshot S;
+    const S::Header* header = reinterpret_cast<const S::Header*>(m_image.constData());
+
+    QTest::addColumn<quint32>("offset");
+    QTest::addColumn<quint32>("value");
+
+    QTest::newRow("magic") << quint32(offsetof(S::Header, magic)) << quint32(0x21212121);
+    QTest::newRow("version") << quint32(offsetof(S::Header, version)) << S::VERSION - 1;
+    QTest::newRow("size") << quint32(offsetof(S::Header, size)) << quint32(m_image.size() + 8);
+    QTest::newRow("event count") << quint32(offsetof(S::Header, events) + offsetof(S::Table, count)) << quint32(0x7fffffff);
+    QTest::newRow("misaligned table") << quint32(offsetof(S::Header, dates) + offsetof(S::Table, offset)) << header->dates.offset + 4;
+    QTest::newRow("string table") << quint32(offsetof(S::Header, strings) + offsetof(S::Table, offset)) << quint32(m_image.size());
+    QTest::newRow("prodid") << quint32(offsetof(S::Header, prodId) + offsetof(S::StringRef, length)) << quint32(0x7fffffff);
+    QTest::newRow("uid") << eventField(0, offsetof(S::EventRecord, uid) + offsetof(S::StringRef, offset)) << header->strings.count;
+    QTest::newRow("summary") << eventField(1, offsetof(S::EventRecord, summary) + offsetof(S::StringRef, length)) << quint32(0xfffffff0);
+    QTest::newRow("exdates") << eventField(0, offsetof(S::EventRecord, exDates) + offsetof(S::ListRef, count)) << header->dates.count + 1;
+    QTest::newRow("alarms") << eventField(0, offsetof(S::EventRecord, alarms) + offsetof(S::ListRef, first)) << header->alarms.count;
+    QTest::newRow("rule") << eventField(0, offsetof(S::EventRecord, rule)) << header->rules.count;
+    QTest::newRow("zone") << eventField(0, offsetof(S::EventRecord, zone)) << quint32(0x80000000);
+    QTest::newRow("status") << eventField(1, offsetof(S::EventRecord, status)) << quint32(QiCalEvent::STAT_CANCELLED + 1);
+    QTest::newRow("transp") << eventField(1, offsetof(S::EventRecord, transp)) << quint32(0xffffffff);
+    QTest::newRow("alarm action")
+        << quint32(header->alarms.offset + offsetof(S::AlarmRecord, action)) << quint32(QiCalAlarm::ACT_EMAIL + 1);
+    QTest::newRow("alarm related")
+        << quint32(header->alarms.offset + offsetof(S::AlarmRecord, related)) << quint32(QiCalAlarm::REL_END + 1);
+    QTest::newRow("rule freq")
+        << quint32(header->rules.offset + offsetof(S::RuleRecord, freq)) << quint32(QiCalRule::RR_YEARLY + 1);
+    QTest::newRow("rule byday")
+        << quint32(header->rules.offset + offsetof(S::RuleRecord, byDay) + offsetof(S::StringRef, offset)) << quint32(0xffffffff);
+    QTest::newRow("zone transitions")
+        << quint32(header->zones.offset + offsetof(S::ZoneRecord, transitions) + offsetof(S::ListRef, count))
+        << header->transitions.count + 1;
+    QTest::newRow("zone observances")
+        << quint32(header->zones.offset + offsetof(S::ZoneRecord, tzInfos) + offsetof(S::ListRef, first)) << header->tzInfos.count;
+    QTest::newRow("observance rdates")
+        << quint32(header->tzInfos.offset + sizeof(S::TzInfoRecord) + offsetof(S::TzInfoRecord, rDates) + offsetof(S::ListRef, count))
+        << header->dates.count + 1;
+    QTest::newRow("observance rule")
+        << quint32(header->tzInfos.offset + offsetof(S::TzInfoRecord, rule)) << quint32(-2);
+}
+
+void TestSnapshot::corruption()
+{
+    QFETCH(quint32, offset);
+    QFETCH(quint32, value);
+
+    QVERIFY(offset + sizeof(value) <= quint32(m_image.size()));
+    QByteArray image = m_image;
+    std::memcpy(image.data() + offset, &value, sizeof(value));
+
+    const QString path = m_dir.filePath("corrupt.snapshot");
+    QVERIFY(writeFile(path, image));
+
+    QiCalSnapshot snapshot;
+    QVERIFY(!snapshot.open(path));
+    QVERIFY(!snapshot.isValid());
+    QCOMPARE(snapshot.eventCount(), 0);
+}
+
+void TestSnapshot::truncation()
+{
+    const QString path = m_dir.filePath("truncated.snapshot");
+    for (int size : { 0, 4, int(sizeof(QiCalSnapshot::Header)) - 1, m_image.size() / 2, m_image.size() - 8 })
+    {
+        QVERIFY(writeFile(path, m_image.left(size)));
+
+        QiCalSnapshot snapshot;
+        QVERIFY(!snapshot.open(path));
+    }
+}
+
+// any snapshot that passes open() must be safe to read in full
+void TestSnapshot::fuzz()
+{
+    const QString path = m_dir.filePath("fuzz.snapshot");
+    int rejected = 0;
+
+    for (int offset = 0; offset + 4 <= m_image.size(); offset += 4)
+    {
+        for (quint32 value : { quint32(0x7fffffff), quint32(0xfffffff0), quint32(0x00001000) })
+        {
+            QByteArray image = m_image;
+            std::memcpy(image.data() + offset, &value, sizeof(value));
+            QVERIFY(writeFile(path, image));
+
+            QiCalSnapshot snapshot;
+            if (!snapshot.open(path))
+            {
+                rejected++;
+                continue;
+            }
+
+            for (int i = 0; i < snapshot.eventCount(); i++)
+            {
+                snapshot.string(snapshot.event(i).uid);
+            }
+            delete snapshot.toCalendar();
+        }
+    }
+
+    QVERIFY(rejected > 0);
+}
+
+// loadFile keeps a fresh snapshot mapped and only builds objects when calendar() is asked for
+void TestSnapshot::lazyLoad()
+{
+    const QString source = m_dir.filePath("lazy.ics");
+    const QString path = m_dir.filePath("lazy.snapshot");
+    QVERIFY(writeFile(source, written(m_calendar)));
+
+    QiCalendarParser first;
+    QVERIFY(first.loadFile(source, path));
+    QVERIFY(first.snapshot() == nullptr);
+    QCOMPARE(first.calendar()->events().size(), 2);
+    QVERIFY(QFile::exists(path));
+
+    QiCalendarParser second;
+    QVERIFY(second.loadFile(source, path));
+    QVERIFY(second.snapshot() != nullptr);
+    QCOMPARE(second.snapshot()->eventCount(), 2);
+
+    QiCalCalendar* calendar = second.calendar();
+    QVERIFY(calendar != nullptr);
+    QVERIFY(second.snapshot() == nullptr);
+    QCOMPARE(written(calendar), written(first.calendar()));
+}
+
+QTEST_GUILESS_MAIN(TestSnapshot)
+
+#include "tst_snapshot.moc"
@@ -0,0 +1,22 @@
+# Shared settings for the unit tests. Every test compiles the library sources itself,
+# so `qmake tests/tests.pro && make check` works without installing qiCalendar first.
+
+QT       -= gui
+QT       += testlib concurrent
+
+CONFIG   += console testcase
+CONFIG   -= app_bundle
+
+DEFINES += QICALENDAR_LIBRARY QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += $$PWD/../src $$PWD
+
+SOURCES += $$files($$PWD/../src/*.cpp)
+HEADERS += $$files($$PWD/../src/*.h) $$PWD/testutil.h
+
+LIBS += -lz
+
+zstd {
+    DEFINES += QICAL_WITH_ZSTD
+    LIBS += -lzstd
+}
@@ -0,0 +1,16 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    recurrence \
+    dst \
+    timezone \
+    roundtrip \
+    snapshot \
+    diff \
+    reload \
+    conflicts \
+    decompressor \
+    civil \
+    jcal \
+    batch \
+    expansion
@@ -0,0 +1,89 @@
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+
+#include <cstring>
+
+#include <zlib.h>
+
+#include "qicaltimezone.h"
+#include "qicalutil_p.h"
+
+// Fixtures shared by the unit tests. Not part of the library.
+namespace TestUtil
+{
+
+inline QDateTime utc(int year, int month, int day, int hour, int minute)
+{
+    return QDateTime(QDate(year, month, day), QTime(hour, minute), Qt::UTC);
+}
+
+// a wall clock time as seconds on the local time line, the unit zone tables work in
+inline qint64 wall(int year, int month, int day, int hour, int minute)
+{
+    return QiCalUtil::localSeconds(QDate(year, month, day), QTime(hour, minute));
+}
+
+inline bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+inline QByteArray gzip(const QByteArray& data)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 16 selects the gzip wrapper
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+    QByteArray out(int(deflateBound(&stream, uLong(data.size()))), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = uInt(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(int(stream.total_out));
+    deflateEnd(&stream);
+
+    return out;
+}
+
+// the Central European VTIMEZONE as published by most clients: CET +01:00, CEST +02:00 from the
+// last Sunday of March 02:00 to the last Sunday of October 03:00
+inline void centralEurope(QiCalTimeZone* timeZone)
+{
+    timeZone->setTzId("Europe/Prague");
+
+    QiCalTzInfo* standard = new QiCalTzInfo();
+    standard->setOffsetFrom(7200);
+    standard->setOffsetTo(3600);
+    standard->setTzName("CET");
+    standard->setDtStart(QDateTime(QDate(1970, 10, 25), QTime(3, 0)));
+    QiCalRule* standardRule = new QiCalRule();
+    standardRule->setFreq(QiCalRule::RR_YEARLY);
+    standardRule->setMonthList("10");
+    standardRule->setDayList("-1SU");
+    standard->setRule(standardRule);
+    timeZone->setStandard(standard);
+
+    QiCalTzInfo* daylight = new QiCalTzInfo();
+    daylight->setOffsetFrom(3600);
+    daylight->setOffsetTo(7200);
+    daylight->setTzName("CEST");
+    daylight->setDtStart(QDateTime(QDate(1970, 3, 29), QTime(2, 0)));
+    QiCalRule* daylightRule = new QiCalRule();
+    daylightRule->setFreq(QiCalRule::RR_YEARLY);
+    daylightRule->setMonthList("3");
+    daylightRule->setDayList("-1SU");
+    daylight->setRule(daylightRule);
+    timeZone->setDayLight(daylight);
+}
+
+}
+
+#endif // TESTUTIL_H
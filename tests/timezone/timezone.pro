@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_timezone
+
+SOURCES += \
+    tst_timezone.cpp
@@ -0,0 +1,216 @@
+#include <QtTest>
+
+#include "qicalrule.h"
+#include "qicaltimezone.h"
+#include "qicalutil_p.h"
+#include "qicalzoneregistry.h"
+#include "qicalzonetable.h"
+#include "testutil.h"
+
+using namespace QiCalUtil;
+using namespace TestUtil;
+
+namespace
+{
+
+QiCalTzInfo* observance(int offsetFrom, int offsetTo, const QDateTime& dtStart)
+{
+    QiCalTzInfo* info = new QiCalTzInfo();
+    info->setOffsetFrom(offsetFrom);
+    info->setOffsetTo(offsetTo);
+    info->setDtStart(dtStart);
+    return info;
+}
+
+QiCalRule* lastSundayOf(int month)
+{
+    QiCalRule* rule = new QiCalRule();
+    rule->setFreq(QiCalRule::RR_YEARLY);
+    rule->setMonthList(QString::number(month));
+    rule->setDayList("-1SU");
+    return rule;
+}
+
+}
+
+class TestTimeZone : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void ruleObservances();
+    void rDateObservances();
+    void mixedObservances();
+    void fixedOffset();
+    void fromTransitions();
+    void registrySharing();
+    void editInvalidates();
+};
+
+void TestTimeZone::ruleObservances()
+{
+    QiCalTimeZone timeZone;
+    centralEurope(&timeZone);
+    timeZone.setHorizon(2000, 2030);
+
+    const QSharedPointer<const QiCalZoneTable> table = timeZone.zoneTable();
+    QCOMPARE(table->tzId(), QString("Europe/Prague"));
+    QCOMPARE(table->initialOffset(), 3600);
+    QCOMPARE(table->transitions().size(), 62);
+
+    qint32 offset = table->initialOffset();
+    for (const QiCalZoneTable::Transition& transition : table->transitions())
+    {
+        const QDate date = QDateTime::fromMSecsSinceEpoch(transition.utc * 1000, Qt::UTC).date();
+        QCOMPARE(transition.offsetBefore, offset);
+        QCOMPARE(transition.offsetAfter, offset == 3600 ? 7200 : 3600);
+        QCOMPARE(transition.localStart, transition.utc + transition.offsetBefore);
+        QCOMPARE(date.month(), offset == 3600 ? 3 : 10);
+        QCOMPARE(date.dayOfWeek(), int(Qt::Sunday));
+        QVERIFY(date.addDays(7).month() != date.month());
+        QCOMPARE(transition.utc % SECS_PER_DAY, qint64(3600));
+        offset = transition.offsetAfter;
+    }
+
+    QCOMPARE(table->transitions().first().utc, wall(2000, 3, 26, 1, 0));
+    QCOMPARE(table->transitions().last().utc, wall(2030, 10, 27, 1, 0));
+}
+
+// observances without RRULE list their onsets as DTSTART plus RDATE, in the wall clock of TZOFFSETFROM
+void TestTimeZone::rDateObservances()
+{
+    QiCalTimeZone timeZone;
+    timeZone.setTzId("Custom/RDATE");
+
+    QiCalTzInfo* standard = observance(7200, 3600, QDateTime(QDate(2023, 10, 29), QTime(3, 0)));
+    standard->setRDates({ wall(2024, 10, 27, 3, 0) * 1000 });
+    timeZone.setStandard(standard);
+
+    QiCalTzInfo* daylight = observance(3600, 7200, QDateTime(QDate(2023, 3, 26), QTime(2, 0)));
+    daylight->setRDates({ wall(2024, 3, 31, 2, 0) * 1000 });
+    timeZone.setDayLight(daylight);
+
+    timeZone.setHorizon(2020, 2030);
+    const QSharedPointer<const QiCalZoneTable> table = timeZone.zoneTable();
+
+    QCOMPARE(table->initialOffset(), 3600);
+    QCOMPARE(table->transitions().size(), 4);
+    QCOMPARE(table->transitions()[0].utc, wall(2023, 3, 26, 1, 0));
+    QCOMPARE(table->transitions()[1].utc, wall(2023, 10, 29, 1, 0));
+    QCOMPARE(table->transitions()[2].utc, wall(2024, 3, 31, 1, 0));
+    QCOMPARE(table->transitions()[3].utc, wall(2024, 10, 27, 1, 0));
+    QCOMPARE(table->offsetAtUtc(wall(2024, 7, 1, 0, 0)), 7200);
+    QCOMPARE(table->offsetAtUtc(wall(2024, 12, 1, 0, 0)), 3600);
+}
+
+// a recurring STANDARD next to a DAYLIGHT that only lists its onsets
+void TestTimeZone::mixedObservances()
+{
+    QiCalTimeZone timeZone;
+    timeZone.setTzId("Custom/Mixed");
+
+    QiCalTzInfo* standard = observance(7200, 3600, QDateTime(QDate(1970, 10, 25), QTime(3, 0)));
+    standard->setRule(lastSundayOf(10));
+    timeZone.setStandard(standard);
+
+    QiCalTzInfo* daylight = observance(3600, 7200, QDateTime(QDate(2024, 3, 31), QTime(2, 0)));
+    daylight->setRDates({ wall(2025, 3, 30, 2, 0) * 1000 });
+    timeZone.setDayLight(daylight);
+
+    timeZone.setHorizon(2024, 2025);
+    const QSharedPointer<const QiCalZoneTable> table = timeZone.zoneTable();
+
+    QCOMPARE(table->initialOffset(), 3600);
+    QCOMPARE(table->transitions().size(), 4);
+    QCOMPARE(table->transitions()[0].utc, wall(2024, 3, 31, 1, 0));
+    QCOMPARE(table->transitions()[1].utc, wall(2024, 10, 27, 1, 0));
+    QCOMPARE(table->transitions()[2].utc, wall(2025, 3, 30, 1, 0));
+    QCOMPARE(table->transitions()[3].utc, wall(2025, 10, 26, 1, 0));
+}
+
+void TestTimeZone::fixedOffset()
+{
+    QiCalTimeZone timeZone;
+    timeZone.setTzId("Custom/Fixed");
+    timeZone.setStandard(observance(19800, 19800, QDateTime(QDate(1970, 1, 1), QTime(0, 0))));
+
+    const QSharedPointer<const QiCalZoneTable> table = timeZone.zoneTable();
+    QVERIFY(table->isFixed());
+    QCOMPARE(table->offsetAtUtc(wall(2024, 7, 1, 0, 0)), 19800);
+    QCOMPARE(table->toUtc(wall(2024, 7, 1, 12, 0)), wall(2024, 7, 1, 6, 30));
+    QCOMPARE(table->toLocal(wall(2024, 7, 1, 6, 30)), wall(2024, 7, 1, 12, 0));
+}
+
+// precompiled tables (as stored in snapshots) answer like the zone they were taken from
+void TestTimeZone::fromTransitions()
+{
+    QiCalTimeZone timeZone;
+    centralEurope(&timeZone);
+    timeZone.setHorizon(2020, 2030);
+    const QSharedPointer<const QiCalZoneTable> compiled = timeZone.zoneTable();
+
+    const QSharedPointer<const QiCalZoneTable> copy = QiCalZoneTable::fromTransitions(
+                compiled->tzId(), compiled->fromYear(), compiled->toYear(), compiled->initialOffset(),
+                compiled->transitions().constData(), compiled->transitions().size());
+
+    QCOMPARE(copy->transitions().size(), compiled->transitions().size());
+    for (qint64 local = wall(2024, 3, 31, 0, 0); local < wall(2024, 3, 31, 4, 0); local += 900)
+    {
+        QCOMPARE(copy->toUtc(local), compiled->toUtc(local));
+    }
+    for (qint64 local = wall(2024, 10, 27, 0, 0); local < wall(2024, 10, 27, 4, 0); local += 900)
+    {
+        QCOMPARE(copy->toUtc(local), compiled->toUtc(local));
+        QCOMPARE(copy->offsetAtLocal(local), compiled->offsetAtLocal(local));
+    }
+}
+
+// identical definitions share one table; the registry only keeps it while someone uses it
+void TestTimeZone::registrySharing()
+{
+    QiCalZoneRegistry* registry = QiCalZoneRegistry::instance();
+    registry->clear();
+
+    {
+        QiCalTimeZone first;
+        centralEurope(&first);
+        QiCalTimeZone second;
+        centralEurope(&second);
+
+        QCOMPARE(first.zoneTable().data(), second.zoneTable().data());
+        QCOMPARE(registry->count(), 1);
+
+        second.setTzId("Europe/Vienna");
+        QVERIFY(first.zoneTable().data() != second.zoneTable().data());
+        QCOMPARE(registry->count(), 2);
+    }
+
+    QCOMPARE(registry->count(), 0);
+}
+
+// editing an observance (or its rule) after the table was built recompiles it and drops the fingerprint
+void TestTimeZone::editInvalidates()
+{
+    QiCalTimeZone timeZone;
+    centralEurope(&timeZone);
+    timeZone.setFingerprint("parsed");
+
+    const QSharedPointer<const QiCalZoneTable> before = timeZone.zoneTable();
+    QCOMPARE(before->toUtc(wall(2024, 7, 1, 12, 0)), wall(2024, 7, 1, 10, 0));
+    QCOMPARE(before->toUtc(wall(2024, 4, 15, 12, 0)), wall(2024, 4, 15, 10, 0));
+
+    timeZone.dayLight()->setOffsetTo(10800);
+    QVERIFY(timeZone.fingerprint().isEmpty());
+    QCOMPARE(timeZone.zoneTable()->toUtc(wall(2024, 7, 1, 12, 0)), wall(2024, 7, 1, 9, 0));
+
+    timeZone.setFingerprint("parsed");
+    timeZone.zoneTable();
+    timeZone.dayLight()->rule()->setMonthList("4");
+    QVERIFY(timeZone.fingerprint().isEmpty());
+    QCOMPARE(timeZone.zoneTable()->toUtc(wall(2024, 4, 15, 12, 0)), wall(2024, 4, 15, 11, 0));
+    QCOMPARE(before->toUtc(wall(2024, 4, 15, 12, 0)), wall(2024, 4, 15, 10, 0));
+}
+
+QTEST_GUILESS_MAIN(TestTimeZone)
+
+#include "tst_timezone.moc"